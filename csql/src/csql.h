@@ -1,12 +1,29 @@
+#pragma once
+
+#include <chrono>
 #include <memory>
 
+#include "generic/appender.h"
 #include "generic/database.h"
+#include "generic/hardware_counters.h"
+#include "generic/metrics.h"
+#include "generic/prepared_statement.h"
+#include "generic/trace.h"
 #include "sql/parser.h"
 
 namespace csql {
 
 using TableIterator = storage::TableIterator;
 using QueryPlan = storage::QueryPlan;
+using Appender = storage::Appender;
+using PreparedStatement = storage::PreparedStatement;
+using TraceLevel = storage::TraceLevel;
+using TraceEvent = storage::TraceEvent;
+using Tracer = storage::Tracer;
+using MetricsSnapshot = storage::MetricsSnapshot;
+using HardwareCounters = storage::HardwareCounters;
+using MemoryTracker = storage::MemoryTracker;
+using MemoryLimitExceeded = storage::MemoryLimitExceeded;
 
 class Database {
  public:
@@ -17,9 +34,39 @@ class Database {
   std::shared_ptr<QueryPlan> plan(const std::string& sql) {
     return db_->plan(sql);
   }
+  std::shared_ptr<QueryPlan> profile(const std::string& sql) {
+    return db_->profile(sql);
+  }
+  std::shared_ptr<PreparedStatement> prepare(const std::string& sql) {
+    return db_->prepare(sql);
+  }
+  std::shared_ptr<Appender> appender(const std::string& tableName, size_t batchSize = 1024) {
+    return db_->appender(tableName, batchSize);
+  }
   void exportTableToCSV(const std::string& tableName, const std::string& filename) {
     db_->exportTableToCSV(tableName, filename);
   }
+  MetricsSnapshot metrics() const {
+    return db_->metrics();
+  }
+  void exportMetrics(const std::string& filename) const {
+    db_->exportMetrics(filename);
+  }
+  void setSlowQueryLog(const std::string& filename, std::chrono::nanoseconds threshold) {
+    db_->setSlowQueryLog(filename, threshold);
+  }
+  void disableSlowQueryLog() {
+    db_->disableSlowQueryLog();
+  }
+  std::shared_ptr<const MemoryTracker> memory() const {
+    return db_->memory();
+  }
+  void setMemoryLimit(size_t bytes) {
+    db_->setMemoryLimit(bytes);
+  }
+  void setQueryMemoryLimit(size_t bytes) {
+    db_->setQueryMemoryLimit(bytes);
+  }
 
  private:
   std::shared_ptr<storage::Database> db_;
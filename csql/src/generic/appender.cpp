@@ -0,0 +1,141 @@
+#include "appender.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "column.h"
+#include "sql/column_type.h"
+#include "table.h"
+#include "table_locks.h"
+#include "trace.h"
+
+namespace csql {
+namespace storage {
+
+Appender::Appender(std::shared_ptr<StorageTable> table, size_t batchSize)
+    : table_(table),
+      batchSize_(std::max<size_t>(batchSize, 1)),
+      pending_(table->getColumns().size()) {}
+
+Appender::~Appender() {
+  size_t rows = rows_.size();
+  try {
+    flush();
+  } catch (const std::exception& error) {
+    // Rows the caller ended are lost, which must not go unnoticed even untraced
+    std::cerr << "csql: Appender lost " << rows << " rows of " << table_->getName() << ": "
+              << error.what() << std::endl;
+    CSQL_TRACE(TraceLevel::kError, "Appender lost " << rows << " rows of " << table_->getName()
+                                                    << ": " << error.what());
+  }
+  for (auto& row : rows_) {
+    discard(row);
+  }
+  discard(row_);  // never ended
+}
+
+void Appender::discard(std::vector<void*>& values) {
+  const auto& columns = table_->getColumns();
+  for (size_t i = 0; i < values.size(); i++) {
+    freeValue(columns[i]->type().data_type, values[i]);
+  }
+  values.clear();
+}
+
+const Column& Appender::nextColumn(DataType type) {
+  const auto& columns = table_->getColumns();
+  if (row_.size() >= columns.size()) {
+    throw std::runtime_error("Too many values for table: " + table_->getName());
+  }
+  const Column& column = *columns[row_.size()];
+  if (type != DataType::UNKNOWN && column.type().data_type != type) {
+    throw std::runtime_error("Invalid type for column " + column.getName() + ", expected " +
+                             to_string(column.type()));
+  }
+  return column;
+}
+
+Appender& Appender::append(int32_t value) {
+  nextColumn(DataType::INT32);
+  row_.push_back(new int32_t(value));
+  return *this;
+}
+
+Appender& Appender::append(bool value) {
+  nextColumn(DataType::BOOL);
+  row_.push_back(new bool(value));
+  return *this;
+}
+
+Appender& Appender::append(std::string_view value) {
+  nextColumn(DataType::STRING);
+  row_.push_back(new std::string(value));
+  return *this;
+}
+
+Appender& Appender::append(const char* value) {
+  return append(std::string_view(value));
+}
+
+Appender& Appender::append(const std::vector<uint8_t>& value) {
+  const Column& column = nextColumn(DataType::BYTES);
+  size_t length = column.type().length;
+  uint8_t* bytes = new uint8_t[length]();
+  std::memcpy(bytes, value.data(), std::min(length, value.size()));
+  row_.push_back(bytes);
+  return *this;
+}
+
+Appender& Appender::appendNull() {
+  nextColumn(DataType::UNKNOWN);
+  row_.push_back(nullptr);
+  return *this;
+}
+
+Appender& Appender::appendDefault() {
+  const Column& column = nextColumn(DataType::UNKNOWN);
+  if (column.takesSequenceValue()) {
+    rowPending_.push_back(row_.size());
+    row_.push_back(nullptr);
+  } else {
+    row_.push_back(column.createValue());
+  }
+  return *this;
+}
+
+void Appender::endRow() {
+  while (row_.size() < table_->getColumns().size()) {
+    appendDefault();
+  }
+  for (size_t column : rowPending_) {
+    pending_[column].push_back(rows_.size());
+  }
+  rowPending_.clear();
+  rows_.push_back(std::move(row_));
+  row_.clear();
+  if (rows_.size() == batchSize_) {
+    flush();
+  }
+}
+
+void Appender::flush() {
+  if (rows_.empty()) return;
+  TableLocks locks;
+  locks.write(table_);
+  locks.acquire();
+  auto cells = table_->allocateRows(rows_.size());
+  for (size_t row = 0; row < rows_.size(); row++) {
+    cells[row]->values = std::move(rows_[row]);
+  }
+  auto pending = std::move(pending_);
+  rows_.clear();
+  pending_.assign(table_->getColumns().size(), {});
+  table_->insert(cells, pending);  // a rejected batch frees its values with its cells
+}
+
+}  // namespace storage
+}  // namespace csql
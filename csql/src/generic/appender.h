@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "memory/cell.h"
+#include "table.h"
+
+namespace csql {
+namespace storage {
+
+class StorageTable;
+
+// Writes typed values straight into a StorageTable, bypassing the SQL front end.
+// Values are appended column by column; endRow() fills the remaining columns with their
+// defaults (or AUTOINCREMENT values) and rows are inserted in batches of `batchSize`, each
+// holding the table exclusively while it is written. Call flush() after the last row to see
+// its errors: the destructor flushes what is left too, but can only report a failure, on
+// std::cerr and as a kError trace event.
+class Appender {
+ public:
+  Appender(std::shared_ptr<StorageTable> table, size_t batchSize = 1024);
+  Appender(const Appender&) = delete;
+  Appender& operator=(const Appender&) = delete;
+  ~Appender();
+
+  Appender& append(int32_t value);
+  Appender& append(bool value);
+  Appender& append(std::string_view value);
+  Appender& append(const char* value);
+  Appender& append(const std::vector<uint8_t>& value);
+  Appender& appendNull();
+  Appender& appendDefault();
+
+  void endRow();
+  // Inserts finished rows, an unfinished row is kept. A batch the table rejects is dropped.
+  void flush();
+
+ private:
+  const Column& nextColumn(DataType type);
+  void discard(std::vector<void*>& values);
+
+  std::shared_ptr<StorageTable> table_;
+  size_t batchSize_;
+
+  std::vector<std::vector<void*>> rows_;      // values of the finished rows of the batch
+  std::vector<std::vector<size_t>> pending_;  // rows waiting for AUTOINCREMENT values
+  std::vector<void*> row_;                    // values of the unfinished row
+  std::vector<size_t> rowPending_;            // same, columns of the unfinished row
+};
+
+}  // namespace storage
+}  // namespace csql
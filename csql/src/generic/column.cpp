@@ -1,8 +1,23 @@
 #include "column.h"
 
+#include <algorithm>
+#include <utility>
+
+#include "memory/allocations.h"
 #include "row.h"
 #include "table.h"
 
+namespace {
+
+template <typename T, typename... Args>
+void* newValue(csql::storage::Arena* arena, Args&&... args) {
+  if (arena) return arena->create<T>(std::forward<Args>(args)...);
+  csql::storage::countAllocation(sizeof(T));
+  return new T(std::forward<Args>(args)...);
+}
+
+}  // namespace
+
 namespace csql {
 namespace storage {
 
@@ -16,6 +31,9 @@ std::shared_ptr<Column> Column::create(std::shared_ptr<ColumnDefinition> columnD
   column->is_key_ = columnDefinition->column_constraints->count(ConstraintType::Key) > 0;
   column->is_unique_ = columnDefinition->column_constraints->count(ConstraintType::Unique) > 0;
   column->default_value_ = columnDefinition->default_value;
+  if (column->is_autoincrement_ && column->column_type_.data_type == DataType::INT32) {
+    column->sequence_ = std::make_shared<Sequence>();
+  }
   return column;
 }
 
@@ -61,6 +79,10 @@ bool Column::isUnique() const {
   return is_unique_;
 }
 
+bool Column::takesSequenceValue() const {
+  return sequence_ && !default_value_;
+}
+
 int32_t Column::maxValue() const {
   if (column_type_.data_type != DataType::INT32) {
     throw std::runtime_error("Invalid type, expected INT32");
@@ -69,6 +91,13 @@ int32_t Column::maxValue() const {
   if (!table) {
     throw std::runtime_error("Table not found");
   }
+  auto storageTable = std::dynamic_pointer_cast<StorageTable>(table);
+  if (storageTable && storageTable->isLeadingKey(*this)) {  // last key is the largest
+    auto cell = storageTable->storage_->back();
+    size_t index = storageTable->key_columns_.front();
+    if (!cell || cell->isNull(index)) return 0;
+    return std::max(0, cell->get<int32_t>(index));
+  }
   auto iter = table->getIterator();
   int32_t max = 0;
   while (iter->hasValue()) {
@@ -83,23 +112,35 @@ int32_t Column::maxValue() const {
 
 void* Column::createValue() const {
   if (default_value_) return createValue(default_value_);
-  if (column_type_.data_type == DataType::INT32 && is_autoincrement_) {
-    return new int32_t(maxValue() + 1);
+  if (sequence_) {
+    return new int32_t(sequence_->next());
   }
   return nullptr;
 }
 
-void* Column::createValue(std::shared_ptr<Expr> value) const {
+void* Column::createValue(std::shared_ptr<Expr> value, Arena* arena) const {
+  if (value->type == kExprParameter) {
+    if (!value->expr) {
+      throw std::runtime_error("Parameter is not bound: " + std::to_string(value->ival));
+    }
+    value = value->expr;
+  }
   if (value->type == kExprLiteralNull) return nullptr;
   if (column_type_.data_type == DataType::INT32 && value->type == kExprLiteralInt) {
-    return new int32_t(value->ival);
+    return newValue<int32_t>(arena, value->ival);
   } else if (column_type_.data_type == DataType::BOOL && value->type == kExprLiteralBool) {
-    return new bool(value->ival);
+    return newValue<bool>(arena, value->ival);
   } else if (column_type_.data_type == DataType::STRING && value->type == kExprLiteralString) {
-    return new std::string(value->name);
+    return newValue<std::string>(arena, value->name);
   } else if (column_type_.data_type == DataType::BYTES &&
              (value->type == kExprLiteralBytes || value->type == kExprLiteralString)) {
-    uint8_t* bytes = new uint8_t[column_type_.length];
+    uint8_t* bytes;
+    if (arena) {
+      bytes = static_cast<uint8_t*>(arena->allocate(column_type_.length, 1));
+    } else {
+      countAllocation(column_type_.length);
+      bytes = new uint8_t[column_type_.length];
+    }
     for (size_t i = 0; i < column_type_.length; i++) {
       bytes[i] = value->name[i];
     }
@@ -116,6 +157,16 @@ std::shared_ptr<ITable> Column::table() const {
   return table_.lock();
 }
 
+bool Column::isFrom(const std::string& tableName) const {
+  for (const Column* column = this; column; column = column->reffered_column_.get()) {
+    auto table = column->table_.lock();
+    if (table && table->getName() == tableName) {
+      return true;
+    }
+  }
+  return false;
+}
+
 std::shared_ptr<Expr> Column::refferedExpr() const {
   return reffered_expr_;
 }
@@ -134,6 +185,9 @@ std::shared_ptr<Column> Column::clone(std::shared_ptr<ITable> table, const std::
   column->is_key_ = is_key_;
   column->is_unique_ = is_unique_;
   column->default_value_ = default_value_;
+  if (sequence_) {
+    column->sequence_ = std::make_shared<Sequence>();  // seeded by the owning table
+  }
 
   column->table_ = table;
   column->reffered_column_ = shared_from_this();
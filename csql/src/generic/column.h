@@ -3,7 +3,9 @@
 #include <memory>
 #include <ostream>
 
+#include "../memory/arena.h"
 #include "../memory/cell.h"
+#include "../memory/sequence.h"
 #include "../sql/statements/create.h"
 #include "generic/table.h"
 #include "sql/expr.h"
@@ -28,16 +30,20 @@ class Column : public std::enable_shared_from_this<Column> {
   bool isAutoincrement() const;
   bool isKey() const;
   bool isUnique() const;
+  bool takesSequenceValue() const;  // missing values come from the AUTOINCREMENT counter
 
   int32_t maxValue() const;
 
   void* createValue() const;
-  void* createValue(std::shared_ptr<Expr> value) const;
+  // Allocated in `arena` when given, on the heap otherwise.
+  void* createValue(std::shared_ptr<Expr> value, Arena* arena = nullptr) const;
 
   std::shared_ptr<Column> clone(std::shared_ptr<ITable> table, const std::string& name = "");
   std::shared_ptr<Column> refferedColumn() const;
   std::shared_ptr<Expr> refferedExpr() const;
   std::shared_ptr<ITable> table() const;
+  // Whether the column is, or was cloned from, a column of the table named `tableName`.
+  bool isFrom(const std::string& tableName) const;
 
   const ColumnType& type() const;
   friend std::ostream& operator<<(std::ostream& stream, const Column& column);
@@ -52,6 +58,7 @@ class Column : public std::enable_shared_from_this<Column> {
   bool is_key_ = false;
   bool is_unique_ = false;
   std::shared_ptr<Expr> default_value_;
+  std::shared_ptr<Sequence> sequence_;  // AUTOINCREMENT counter
 
   std::weak_ptr<ITable> table_;
   std::shared_ptr<Column> reffered_column_;
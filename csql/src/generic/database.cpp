@@ -1,58 +1,111 @@
 #include "database.h"
 
-#include <iostream>
+#include <algorithm>
+#include <fstream>
 #include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
 
+#include "appender.h"
+#include "index_advisor.h"
+#include "memory/arena.h"
+#include "metrics.h"
+#include "planning/expression_simplifier.h"
 #include "planning/planning.h"
+#include "prepared_statement.h"
 #include "row.h"
+#include "slow_query_log.h"
 #include "sql/expr.h"
 #include "sql/parser.h"
 #include "sql/statements/create.h"
 #include "sql/statements/delete.h"
+#include "sql/statements/explain.h"
 #include "sql/statements/insert.h"
 #include "sql/statements/select.h"
 #include "sql/statements/statement.h"
 #include "sql/statements/update.h"
+#include "statement_statistics.h"
 #include "table.h"
+#include "table_locks.h"
+#include "trace.h"
 
 namespace csql {
 namespace storage {
 
 std::shared_ptr<TableIterator> Database::execute(const std::string& sql) {
-  std::shared_ptr<SQLParserResult> result = std::make_shared<SQLParserResult>();
-  SQLParser::parse(sql, result);
-  if (!result->isValid()) {
-    throw std::runtime_error(result->errorMsg());
+  TraceSpan span(TraceLevel::kInfo, "execute");
+  uint64_t start = Tracer::now();
+  std::string key;
+  std::vector<std::shared_ptr<Expr>> literals;
+  if (PlanCache::normalize(sql, key, literals)) {
+    std::shared_ptr<TableLocks> locks;
+    auto entry = cached(key, literals, locks);
+    return execute(entry, literals, sql, start, locks);
+  }
+
+  std::shared_ptr<SQLParserResult> result;
+  {
+    ArenaScope scope(std::make_shared<Arena>());  // values created while executing stay apart
+    result = parse(sql);
   }
+  std::string normalized = PlanCache::normalize(sql);
 
-  std::cout << *result;
   for (auto stmt : result->getStatements()) {
+    CSQL_TRACE(TraceLevel::kDebug, SQLParserResult(stmt));
+    auto locks = lock(stmt);
+    if (stmt->is(kStmtSelect)) {
+      auto queryPlan = plan(stmt);
+      PhaseTimer timer(metrics_, MetricsPhase::kExecute);
+      return holding(timer.stop(kStmtSelect, execute(queryPlan)->getIterator(),
+                                completion(kStmtSelect, start, sql, normalized, {}, queryPlan)),
+                     locks);
+    }
+    PhaseTimer timer(metrics_, MetricsPhase::kExecute);
+    size_t rows = 0;
     if (stmt->is(kStmtCreate)) {
       create(std::dynamic_pointer_cast<CreateStatement>(stmt));
     } else if (stmt->is(kStmtInsert)) {
-      insert(std::dynamic_pointer_cast<InsertStatement>(stmt));
-    } else if (stmt->is(kStmtSelect)) {
-      return execute(plan(stmt))->getIterator();
+      rows = insert(std::dynamic_pointer_cast<InsertStatement>(stmt));
     } else if (stmt->is(kStmtDelete)) {
-      delete_(std::dynamic_pointer_cast<DeleteStatement>(stmt));
+      rows = delete_(std::dynamic_pointer_cast<DeleteStatement>(stmt));
+    } else if (stmt->is(kStmtAnalyze)) {
+      analyze(std::dynamic_pointer_cast<AnalyzeStatement>(stmt));
+    } else if (stmt->is(kStmtExplain)) {
+      auto rows = explain(std::dynamic_pointer_cast<ExplainStatement>(stmt))->getIterator();
+      return timer.stop(kStmtExplain, rows);
       // } else if (stmt->is(kStmtUpdate)) {
       //   return update(std::dynamic_pointer_cast<UpdateStatement>(stmt));
     } else {
-      std::cout << "Unknown statement" << std::endl;
+      CSQL_TRACE(TraceLevel::kWarning, "Unknown statement: " << *stmt);
+      continue;
     }
+    timer.stop(stmt->type());
+    complete(stmt->type(), start, rows, sql, normalized, {}, nullptr);
+    start = Tracer::now();  // the next statement
   }
 
   return nullptr;
 }
 
 std::shared_ptr<QueryPlan> Database::plan(std::shared_ptr<SQLStatement> statement) {
+  TraceSpan span(TraceLevel::kInfo, "plan");
+  PhaseTimer timer(metrics_, MetricsPhase::kPlan);
   if (statement->is(kStmtSelect)) {
     auto select = std::dynamic_pointer_cast<SelectStatement>(statement);
-    return QueryPlan::create(Expr::makeSelect(select), shared_from_this());
+    auto result = QueryPlan::create(Expr::makeSelect(select), shared_from_this())->optimize();
+    IndexAdvisor::instrument(*result);
+    timer.stop(kStmtSelect);
+    return result;
   } else if (statement->is(kStmtCreate)) {
     auto create = std::dynamic_pointer_cast<CreateStatement>(statement);
     auto db = shared_from_this();
-    return QueryPlan::create(create->sourceRef, db);
+    auto result = QueryPlan::create(create->sourceRef, db)->optimize();
+    IndexAdvisor::instrument(*result);
+    timer.stop(kStmtCreate);
+    return result;
   } else if (statement->is(kStmtInsert)) {
     throw std::runtime_error("INSERT not supported for planning");
   } else if (statement->is(kStmtDelete)) {
@@ -63,66 +116,291 @@ std::shared_ptr<QueryPlan> Database::plan(std::shared_ptr<SQLStatement> statemen
 }
 
 std::shared_ptr<QueryPlan> Database::plan(const std::string& sql) {
-  std::shared_ptr<SQLParserResult> result = std::make_shared<SQLParserResult>();
-  SQLParser::parse(sql, result);
-
-  if (!result->isValid()) {
-    throw std::runtime_error(result->errorMsg());
-  }
+  // Not the cached plan, which is shared and rebound to the literals of every execution.
+  ArenaScope scope(std::make_shared<Arena>());
+  auto result = parse(sql);
 
   if (result->getStatements().size() != 1) {
     throw std::runtime_error("Only one statement is supported for planning");
   }
+  auto locks = lock(result->getStatement(0));
   return plan(result->getStatement(0));
 }
 
-std::shared_ptr<ITable> Database::execute(std::shared_ptr<QueryPlan> plan) {
+std::shared_ptr<QueryPlan> Database::profile(const std::string& sql) {
+  ArenaScope scope(std::make_shared<Arena>());
+  auto result = parse(sql);
+  if (result->getStatements().size() != 1 || !result->getStatement(0)->is(kStmtSelect)) {
+    throw std::runtime_error("Only a single SELECT is supported for profiling");
+  }
+  auto locks = lock(result->getStatement(0));
+  auto queryPlan = plan(result->getStatement(0));  // not the cached one, which is shared
+  profile(queryPlan);
+  return queryPlan;
+}
+
+void Database::profile(std::shared_ptr<QueryPlan> plan) {
+  auto it = execute(plan, true)->getIterator();
+  while (it->hasValue()) {
+    **it;  // rows are evaluated when read
+    ++(*it);
+  }
+}
+
+std::shared_ptr<CachedPlan> Database::cached(const std::string& key,
+                                             const std::vector<std::shared_ptr<Expr>>& literals,
+                                             std::shared_ptr<TableLocks>& locks) {
+  auto entry = planCache_->acquire(key);
+  if (entry) {
+    locks = lock(entry->statement);  // the same tables as the statement replanned below
+    if (isCurrent(*entry)) {
+      return entry;
+    }
+  }
+
+  ArenaScope scope(std::make_shared<Arena>());
+  auto result = parse(key);
+
+  entry = std::make_shared<CachedPlan>();
+  entry->key = key;
+  entry->statement = result->getStatement(0);
+  if (!locks) {
+    locks = lock(entry->statement);
+  }
+  entry->parameters = result->getParameters();
+  // The plan is estimated with the literals of its first execution and kept for the others.
+  for (size_t i = 0; i < entry->parameters.size() && i < literals.size(); i++) {
+    entry->parameters[i]->expr = literals[i];
+  }
+  replan(*entry);
+  return entry;
+}
+
+void Database::replan(CachedPlan& entry) {
+  if (entry.statement->is(kStmtSelect)) {
+    entry.plan = plan(entry.statement);  // raises before the tables of the last plan go
+  }
+  entry.tables.clear();
+  if (entry.plan) {
+    collectTables(entry.plan, entry);
+  } else if (entry.statement->is(kStmtInsert)) {
+    addTable(std::dynamic_pointer_cast<InsertStatement>(entry.statement)->tableRef, entry);
+  } else if (entry.statement->is(kStmtDelete)) {
+    addTable(std::dynamic_pointer_cast<DeleteStatement>(entry.statement)->tableRef, entry);
+  }
+}
+
+bool Database::isCurrent(const CachedPlan& entry) const {
+  for (const auto& version : entry.tables) {
+    auto table = version.table.lock();
+    if (!table || findTable(version.name) != table ||
+        table->statsVersion() != version.statsVersion) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void Database::collectTables(std::shared_ptr<QueryPlan> plan, CachedPlan& entry) const {
+  if (!plan) return;
+  if (plan->type_ == QueryType::kStepProject) {
+    addTable(plan->query_, entry);
+  }
+  collectTables(plan->left_, entry);
+  collectTables(plan->right_, entry);
+}
+
+void Database::addTable(std::shared_ptr<Expr> tableRef, CachedPlan& entry) const {
+  auto table = std::dynamic_pointer_cast<StorageTable>(getTable(tableRef));
+  entry.tables.push_back(CachedPlan::TableVersion{table->getName(), table, table->statsVersion()});
+}
+
+std::shared_ptr<TableIterator> Database::execute(std::shared_ptr<CachedPlan> entry,
+                                                const std::vector<std::shared_ptr<Expr>>& literals,
+                                                const std::string& sql, uint64_t start,
+                                                std::shared_ptr<TableLocks> locks) {
+  if (entry->parameters.size() != literals.size()) {
+    throw std::runtime_error("Literal count mismatch for cached statement");
+  }
+  for (size_t i = 0; i < literals.size(); i++) {
+    entry->parameters[i]->expr = literals[i];
+  }
+  CSQL_TRACE(TraceLevel::kDebug, SQLParserResult(entry->statement));
+
+  std::shared_ptr<TableIterator> iterator;
+  PhaseTimer timer(metrics_, MetricsPhase::kExecute);
+  try {
+    size_t rows = 0;
+    if (entry->statement->is(kStmtSelect)) {
+      iterator = timer.stop(kStmtSelect, execute(entry->plan)->getIterator(),
+                            completion(kStmtSelect, start, sql, entry->key, literals, entry->plan));
+    } else if (entry->statement->is(kStmtInsert)) {
+      rows = insert(std::dynamic_pointer_cast<InsertStatement>(entry->statement));
+      timer.stop(kStmtInsert);
+    } else if (entry->statement->is(kStmtDelete)) {
+      rows = delete_(std::dynamic_pointer_cast<DeleteStatement>(entry->statement));
+      timer.stop(kStmtDelete);
+    }
+    if (!iterator) {
+      complete(entry->statement->type(), start, rows, sql, entry->key, literals, nullptr);
+    }
+  } catch (...) {
+    planCache_->release(entry);
+    throw;
+  }
+  if (!iterator) {
+    planCache_->release(entry);
+    return nullptr;
+  }
+  // The entry goes back to the cache once the caller is done with the rows.
+  auto cache = planCache_;
+  return holding(std::shared_ptr<TableIterator>(
+                     iterator.get(),
+                     [iterator, entry, cache](TableIterator*) { cache->release(entry); }),
+                 locks);
+}
+
+std::shared_ptr<PreparedStatement> Database::prepare(const std::string& sql) {
+  ArenaScope scope(std::make_shared<Arena>());
+  auto result = parse(sql);
+  if (result->getStatements().size() != 1) {
+    throw std::runtime_error("Only one statement is supported for prepare");
+  }
+
+  auto prepared = std::make_shared<CachedPlan>();
+  prepared->statement = result->getStatement(0);
+  prepared->parameters = result->getParameters();
+  if (prepared->statement->is(kStmtSelect)) {
+    auto locks = lock(prepared->statement);
+    replan(*prepared);
+  } else if (!prepared->statement->is(kStmtInsert) && !prepared->statement->is(kStmtDelete)) {
+    throw std::runtime_error("Only SELECT, INSERT and DELETE can be prepared");
+  }
+  return std::make_shared<PreparedStatement>(shared_from_this(), sql, prepared);
+}
+
+std::shared_ptr<ITable> Database::execute(std::shared_ptr<QueryPlan> plan, bool profile) {
+  if (!MemoryTracker::query()) {  // the operators built below charge the query
+    MemoryScope scope(MemoryTracker::create(
+        "query", memory_, queryMemoryLimit_.load(std::memory_order_relaxed)));
+    return execute(plan, profile);
+  }
+  if (!profile) {
+    return executeStep(plan, false);
+  }
+  plan->actual_ = std::make_shared<OperatorStats>();
+  return ProfiledTable::create(executeStep(plan, true), plan->actual_);
+}
+
+std::shared_ptr<ITable> Database::executeStep(std::shared_ptr<QueryPlan> plan, bool profile) {
   if (plan->type_ == QueryType::kStepFilter) {
-    auto table = execute(plan->left_);
-    std::cout << "Executing plan: " << plan->toString() << std::endl;
+    auto table = execute(plan->left_, profile);
+    CSQL_TRACE(TraceLevel::kTrace, "Executing plan: " << plan->toString());
     if (!plan->query_) {
       throw std::runtime_error("Where clause not found");
     }
     if (!table) {
       throw std::runtime_error("Table not found");
     }
-    return table->filter(plan->query_);
-  } else if (plan->type_ == QueryType::kStepJoin) {
-    auto left = execute(plan->left_);
-    auto right = execute(plan->right_);
-    std::cout << "Executing plan: " << plan->toString() << std::endl;
+    return FilteredTable::create(table, ExpressionSimplifier(true).simplify(plan->query_),
+                                 plan->filtered_);
+  } else if (plan->type_ == QueryType::kStepJoin || plan->type_ == QueryType::kStepHashJoin) {
+    auto left = execute(plan->left_, profile);
+    auto right = execute(plan->right_, profile);
+    CSQL_TRACE(TraceLevel::kTrace, "Executing plan: " << plan->toString());
     if (!left || !right) {
       throw std::runtime_error("Table not found");
     }
-    return JoinTable::create(left, right, plan->query_->on, plan->query_->opType);
+    JoinStrategy strategy = JoinStrategy::kNestedLoop;
+    if (plan->type_ == QueryType::kStepHashJoin) {
+      strategy = plan->buildLeft_ ? JoinStrategy::kHashBuildLeft : JoinStrategy::kHashBuildRight;
+    }
+    return JoinTable::create(left, right, ExpressionSimplifier(true).simplify(plan->query_->on),
+                             plan->query_->opType, strategy, plan->required_);
   } else if (plan->type_ == QueryType::kStepProject) {
-    std::cout << "Executing plan: " << plan->toString() << std::endl;
+    CSQL_TRACE(TraceLevel::kTrace, "Executing plan: " << plan->toString());
     if (plan->query_->type == kExprTableRef) {
       return getTable(plan->query_);
     }
     throw std::runtime_error("Unsupported query type");
   } else if (plan->type_ == QueryType::kStepEval) {
-    auto left = execute(plan->left_);
-    std::cout << "Executing plan: " << plan->toString() << std::endl;
+    auto left = execute(plan->left_, profile);
+    CSQL_TRACE(TraceLevel::kTrace, "Executing plan: " << plan->toString());
     if (!left) {
       throw std::runtime_error("Table not found");
     }
-    return EvaluatedTable::create(left, plan->query_->select->selectList);
+    return EvaluatedTable::create(
+        left, ExpressionSimplifier(true).simplify(plan->query_->select->selectList));
   } else if (plan->type_ == QueryType::kStepFullScan) {
-    auto left = execute(plan->left_);  // Return table itself
-    std::cout << "Executing plan: " << plan->toString() << std::endl;
+    auto left = execute(plan->left_, profile);  // Return table itself
+    CSQL_TRACE(TraceLevel::kTrace, "Executing plan: " << plan->toString());
     if (!left) {
       throw std::runtime_error("Table not found");
     }
     return left;
   } else if (plan->type_ == QueryType::kStepRangeScan) {
-    std::cout << "Executing plan: " << plan->toString() << std::endl;
-    throw std::runtime_error("Range scan not supported");
+    auto table = std::dynamic_pointer_cast<StorageTable>(executeStep(plan->left_, profile));
+    CSQL_TRACE(TraceLevel::kTrace, "Executing plan: " << plan->toString());
+    if (!table) {
+      throw std::runtime_error("Table not found");
+    }
+    return table->range(plan->query_);
   } else {
     throw std::runtime_error("Unsupported query type");
   }
 }
 
+std::shared_ptr<SQLParserResult> Database::parse(const std::string& sql) {
+  PhaseTimer timer(metrics_, MetricsPhase::kParse);
+  std::shared_ptr<SQLParserResult> result = std::make_shared<SQLParserResult>();
+  SQLParser::parse(sql, result);
+  if (!result->isValid()) {
+    metrics_->parse_errors.fetch_add(1, std::memory_order_relaxed);
+    throw std::runtime_error(result->errorMsg());
+  }
+  if (!result->getStatements().empty()) {
+    timer.stop(result->getStatement(0)->type());
+  }
+  return result;
+}
+
+MetricsSnapshot Database::metrics() const {
+  auto snapshot = MetricsSnapshot::of(*metrics_);
+  for (const auto& table : storedTables()) {
+    TableLocks locks;
+    locks.read(table);
+    locks.acquire();
+    snapshot.tables.push_back(MetricsSnapshot::Table{table->getName(), table->getRowsCount(),
+                                                     table->rowsScanned(), table->uniqueProbes(),
+                                                     table->memory()->current()});
+    snapshot.rows_scanned += table->rowsScanned();
+    snapshot.unique_probes += table->uniqueProbes();
+  }
+  snapshot.memory_bytes = memory_->current();
+  snapshot.memory_peak_bytes = memory_->peak();
+  return snapshot;
+}
+
+void Database::exportMetrics(const std::string& filename) const {
+  std::ofstream file(filename);
+  if (!file) {
+    throw std::runtime_error("Cannot open file: " + filename);
+  }
+  metrics().writePrometheus(file);
+}
+
+std::shared_ptr<const MemoryTracker> Database::memory() const {
+  return memory_;
+}
+
+void Database::setMemoryLimit(size_t bytes) {
+  memory_->setLimit(bytes);
+}
+
+void Database::setQueryMemoryLimit(size_t bytes) {
+  queryMemoryLimit_.store(bytes, std::memory_order_relaxed);
+}
+
 std::shared_ptr<ITable> Database::getTable(std::shared_ptr<Expr> tableRef) const {
   if (tableRef->type == kExprOperator && tableRef->opType == kOpParenthesis) {
     return getTable(tableRef->expr);
@@ -131,40 +409,252 @@ std::shared_ptr<ITable> Database::getTable(std::shared_ptr<Expr> tableRef) const
     throw std::runtime_error("Unsupported expression type on getTable: " +
                              std::to_string(tableRef->type));
   }
-  if (tables_.count(tableRef->name) == 0) {
+  if (auto table = systemTable(tableRef->name)) {
+    return table;
+  }
+  auto table = findTable(tableRef->name);
+  if (!table) {
     throw std::runtime_error("Table not found: " + tableRef->name);
   }
-  return tables_.at(tableRef->name);
+  return table;
+}
+
+std::shared_ptr<StorageTable> Database::findTable(const std::string& name) const {
+  std::shared_lock<std::shared_mutex> lock(tablesMutex_);
+  auto it = tables_.find(name);
+  return it == tables_.end() ? nullptr : it->second;
+}
+
+std::vector<std::shared_ptr<StorageTable>> Database::storedTables() const {
+  std::shared_lock<std::shared_mutex> lock(tablesMutex_);
+  std::vector<std::shared_ptr<StorageTable>> tables;
+  tables.reserve(tables_.size());
+  for (const auto& [name, table] : tables_) {
+    tables.push_back(table);
+  }
+  return tables;
+}
+
+std::shared_ptr<TableLocks> Database::lock(std::shared_ptr<SQLStatement> statement) const {
+  auto locks = std::make_shared<TableLocks>();
+  if (statement->is(kStmtSelect)) {
+    readTables(*std::dynamic_pointer_cast<SelectStatement>(statement), *locks);
+  } else if (statement->is(kStmtCreate)) {
+    readTables(std::dynamic_pointer_cast<CreateStatement>(statement)->sourceRef, *locks);
+  } else if (statement->is(kStmtInsert)) {
+    locks->write(findTable(std::dynamic_pointer_cast<InsertStatement>(statement)->tableRef->name));
+  } else if (statement->is(kStmtDelete)) {
+    locks->write(findTable(std::dynamic_pointer_cast<DeleteStatement>(statement)->tableRef->name));
+  } else if (statement->is(kStmtAnalyze)) {
+    auto tableRef = std::dynamic_pointer_cast<AnalyzeStatement>(statement)->tableRef;
+    if (tableRef) {
+      locks->write(findTable(tableRef->name));
+    } else {
+      for (const auto& table : storedTables()) {
+        locks->write(table);
+      }
+    }
+  } else if (statement->is(kStmtExplain)) {
+    readTables(*std::dynamic_pointer_cast<ExplainStatement>(statement)->select, *locks);
+  }
+  locks->acquire();
+  return locks;
+}
+
+void Database::readTables(const SelectStatement& select, TableLocks& locks) const {
+  readTables(select.fromSource, locks);
+  readTables(select.whereClause, locks);
+  if (select.selectList) {
+    for (const auto& expr : *select.selectList) {
+      readTables(expr, locks);
+    }
+  }
+}
+
+void Database::readTables(std::shared_ptr<Expr> expr, TableLocks& locks) const {
+  if (!expr) return;
+  if (expr->type == kExprTableRef) {
+    locks.read(findTable(expr->name));  // unknown names fail later, when planned
+  }
+  readTables(expr->expr, locks);
+  readTables(expr->expr2, locks);
+  readTables(expr->on, locks);
+  if (expr->select) {
+    readTables(*expr->select, locks);
+  }
+}
+
+std::shared_ptr<TableIterator> Database::holding(std::shared_ptr<TableIterator> rows,
+                                                 std::shared_ptr<TableLocks> locks) {
+  if (!rows) return rows;
+  return std::shared_ptr<TableIterator>(rows.get(), [rows, locks](TableIterator*) mutable {
+    rows = nullptr;  // done with the tables before they are unlocked
+    locks = nullptr;
+  });
 }
 
 std::shared_ptr<ITable> Database::create(std::shared_ptr<CreateStatement> createStatement) {
-  if (tables_.count(createStatement->tableName) > 0) {
+  if (findTable(createStatement->tableName) || isSystemTable(createStatement->tableName)) {
     throw std::runtime_error("Table already exists: " + createStatement->tableName);
   }
+  std::shared_ptr<StorageTable> table;
   if (createStatement->type == CreateType::kCreateTable) {
     if (createStatement->columns->empty()) {
       throw std::runtime_error("No columns specified");
     }
-    tables_[createStatement->tableName] = StorageTable::create(createStatement);
-    return tables_[createStatement->tableName];
+    table = StorageTable::create(createStatement);
   } else if (createStatement->type == CreateType::kCreateTableAsSelect) {
     auto refTable = execute(plan(createStatement));
-    return tables_[createStatement->tableName] = StorageTable::create(createStatement, refTable);
+    table = StorageTable::create(createStatement, refTable);
   } else {
     throw std::runtime_error("Unsupported create type");
   }
+  table->setMemoryParent(memory_);
+  std::unique_lock<std::shared_mutex> lock(tablesMutex_);
+  if (!tables_.emplace(createStatement->tableName, table).second) {  // created meanwhile
+    throw std::runtime_error("Table already exists: " + createStatement->tableName);
+  }
+  return table;
 }
 
-std::shared_ptr<ITable> Database::insert(std::shared_ptr<InsertStatement> insertStatement) {
+size_t Database::insert(std::shared_ptr<InsertStatement> insertStatement) {
+  if (isSystemTable(insertStatement->tableRef->name)) {
+    throw std::runtime_error("Table is read-only: " + insertStatement->tableRef->name);
+  }
   getTable(insertStatement->tableRef)->insert(insertStatement);
-  return nullptr;
+  return insertStatement->rows.size();
 }
 
-std::shared_ptr<ITable> Database::delete_(std::shared_ptr<DeleteStatement> deleteStatement) {
-  getTable(deleteStatement->tableRef)->delete_(deleteStatement);
+size_t Database::delete_(std::shared_ptr<DeleteStatement> deleteStatement) {
+  if (isSystemTable(deleteStatement->tableRef->name)) {
+    throw std::runtime_error("Table is read-only: " + deleteStatement->tableRef->name);
+  }
+  auto table = std::dynamic_pointer_cast<StorageTable>(getTable(deleteStatement->tableRef));
+  size_t before = table->getRowsCount();
+  table->delete_(deleteStatement);
+  return before - table->getRowsCount();
+}
+
+void Database::setSlowQueryLog(const std::string& filename, std::chrono::nanoseconds threshold) {
+  if (auto replaced = slowQueryLog_.exchange(std::make_shared<SlowQueryLog>(filename, threshold))) {
+    replaced->close();
+  }
+}
+
+void Database::disableSlowQueryLog() {
+  if (auto slowQueryLog = slowQueryLog_.exchange(nullptr)) {
+    slowQueryLog->close();  // even while a statement finishing elsewhere still holds it
+  }
+}
+
+std::vector<StatementStatistics::Entry> Database::statementStatistics() const {
+  return statementStatistics_->entries();
+}
+
+std::vector<IndexAdvisor::Advice> Database::adviseIndexes() const {
+  return indexAdvisor_->advise();
+}
+
+bool Database::isSystemTable(const std::string& name) {
+  return name == StatementStatistics::kTableName || name == IndexAdvisor::kTableName;
+}
+
+std::shared_ptr<StorageTable> Database::systemTable(const std::string& name) const {
+  if (name == StatementStatistics::kTableName) {
+    return statementStatistics_->toTable();
+  } else if (name == IndexAdvisor::kTableName) {
+    return indexAdvisor_->toTable();
+  }
   return nullptr;
 }
 
+void Database::complete(StatementType type, uint64_t start, uint64_t rows, const std::string& sql,
+                        const std::string& normalized,
+                        const std::vector<std::shared_ptr<Expr>>& parameters,
+                        std::shared_ptr<QueryPlan> plan) const {
+  StatementStatistics::Usage usage{Tracer::now() - start, rows, 0, 0};
+  if (plan) {
+    countScans(*plan, usage);
+    indexAdvisor_->observe(*plan);
+  } else if (type == kStmtDelete) {
+    usage.full_scans = 1;
+  }
+  statementStatistics_->record(normalized, usage);
+  if (auto slowQueryLog = slowQueryLog_.load()) {
+    slowQueryLog->report(start, rows, sql, parameters, plan);
+  }
+}
+
+std::function<void(uint64_t rows)> Database::completion(
+    StatementType type, uint64_t start, const std::string& sql, const std::string& normalized,
+    const std::vector<std::shared_ptr<Expr>>& parameters, std::shared_ptr<QueryPlan> plan) const {
+  return [db = shared_from_this(), type, start, sql, normalized, parameters, plan](uint64_t rows) {
+    db->complete(type, start, rows, sql, normalized, parameters, plan);
+  };
+}
+
+void Database::countScans(const QueryPlan& plan, StatementStatistics::Usage& usage) {
+  if (plan.type_ == QueryType::kStepRangeScan) {
+    usage.range_scans++;
+    return;  // over the table below
+  }
+  if (plan.type_ == QueryType::kStepProject) {
+    usage.full_scans++;
+  }
+  if (plan.left_) countScans(*plan.left_, usage);
+  if (plan.right_) countScans(*plan.right_, usage);
+}
+
+void Database::analyze(std::shared_ptr<AnalyzeStatement> analyzeStatement) {
+  if (analyzeStatement->tableRef) {
+    auto table = findTable(analyzeStatement->tableRef->name);
+    if (!table) {
+      throw std::runtime_error("Table not found: " + analyzeStatement->tableRef->name);
+    }
+    table->analyze();
+    return;
+  }
+  for (const auto& table : storedTables()) {
+    table->analyze();
+  }
+}
+
+std::shared_ptr<ITable> Database::explain(std::shared_ptr<ExplainStatement> explainStatement) {
+  auto queryPlan = plan(explainStatement->select);
+  if (explainStatement->analyze) {
+    profile(queryPlan);
+  }
+  std::vector<std::string> lines;
+  size_t width = 1;
+  std::string text = queryPlan->explain();
+  for (size_t start = 0, end; start < text.size(); start = end + 1) {
+    end = text.find('\n', start);
+    lines.push_back(text.substr(start, end - start));
+    width = std::max(width, lines.back().size());
+  }
+
+  auto noConstraints = std::make_shared<std::unordered_set<ConstraintType>>();
+  auto createStatement = std::make_shared<CreateStatement>(CreateType::kCreateTable);
+  createStatement->tableName = "explain";
+  createStatement->columns = std::make_shared<std::vector<std::shared_ptr<ColumnDefinition>>>();
+  createStatement->columns->push_back(std::make_shared<ColumnDefinition>(
+      "line", ColumnType(DataType::INT32),
+      std::make_shared<std::unordered_set<ConstraintType>>(
+          std::unordered_set<ConstraintType>{ConstraintType::Key}),
+      nullptr));
+  createStatement->columns->push_back(std::make_shared<ColumnDefinition>(
+      "plan", ColumnType(DataType::STRING, width), noConstraints, nullptr));
+  auto table = StorageTable::create(createStatement);
+  {
+    Appender appender(table);
+    for (size_t i = 0; i < lines.size(); i++) {
+      appender.append(static_cast<int32_t>(i)).append(lines[i]).endRow();
+    }
+    appender.flush();
+  }
+  return table;
+}
+
 // std::shared_ptr<TableIterator> Database::update(std::shared_ptr<UpdateStatement> updateStatement)
 // {
 
@@ -175,12 +665,24 @@ std::shared_ptr<ITable> Database::delete_(std::shared_ptr<DeleteStatement> delet
 //   return nullptr;
 // }
 
+std::shared_ptr<Appender> Database::appender(const std::string& tableName, size_t batchSize) {
+  auto table = findTable(tableName);
+  if (!table) {
+    throw std::runtime_error("Table not found: " + tableName);
+  }
+  return std::make_shared<Appender>(table, batchSize);
+}
+
 void Database::exportTableToCSV(const std::string& tableName, const std::string& filename) {
   // export table to csv
-  if (tables_.count(tableName) == 0) {
+  auto table = findTable(tableName);
+  if (!table) {
     throw std::runtime_error("Table not found: " + tableName);
   }
-  tables_[tableName]->exportToCSV(filename);
+  TableLocks locks;
+  locks.read(table);
+  locks.acquire();
+  table->exportToCSV(filename);
 }
 
 }  // namespace storage
@@ -1,19 +1,44 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
 #include <memory>
+#include <shared_mutex>
+#include <string>
 #include <unordered_map>
+#include <vector>
 
+#include "appender.h"
+#include "index_advisor.h"
 #include "generic/planning/planning.h"
+#include "metrics.h"
+#include "plan_cache.h"
+#include "prepared_statement.h"
 #include "row.h"
+#include "slow_query_log.h"
+#include "sql/parser_result.h"
+#include "sql/statements/analyze.h"
 #include "sql/statements/create.h"
 #include "sql/statements/delete.h"
+#include "sql/statements/explain.h"
 #include "sql/statements/insert.h"
 #include "sql/statements/select.h"
 #include "sql/statements/update.h"
+#include "statement_statistics.h"
 #include "table.h"
+#include "table_locks.h"
 
 namespace csql {
 namespace storage {
+// Safe to use from many threads at once. Statements lock the tables they touch, see
+// TableLocks: queries share them until their rows are released, on any thread, writes wait
+// for those and hold them exclusively. A thread changing a table that one of its own open
+// queries reads gets an error instead of waiting for itself, so release the rows first. So
+// does a statement that would wait for a thread waiting for it, such as two threads each
+// keeping rows open while writing the other's table; rows count as held by the thread that
+// ran their query.
 class Database : public std::enable_shared_from_this<Database> {
  public:
   Database() = default;
@@ -21,22 +46,118 @@ class Database : public std::enable_shared_from_this<Database> {
 
   std::shared_ptr<TableIterator> execute(const std::string& sql);
   std::shared_ptr<QueryPlan> plan(const std::string& sql);
+  // Plans and runs a single SELECT, reading all of its rows; the plan returned carries what
+  // every step did, see QueryPlan::explain and QueryPlan::toMermaid.
+  std::shared_ptr<QueryPlan> profile(const std::string& sql);
+  // Parses a single SELECT, INSERT or DELETE with ? placeholders, see PreparedStatement.
+  std::shared_ptr<PreparedStatement> prepare(const std::string& sql);
+
+  std::shared_ptr<Appender> appender(const std::string& tableName, size_t batchSize = 1024);
 
   void exportTableToCSV(const std::string& tableName, const std::string& filename);
 
+  MetricsSnapshot metrics() const;
+  // Writes metrics() to `filename` in the Prometheus text format.
+  void exportMetrics(const std::string& filename) const;
+
+  // Statements run through execute() or a PreparedStatement that take `threshold` or longer,
+  // until their last row is read, are appended to `filename` with their plan.
+  void setSlowQueryLog(const std::string& filename, std::chrono::nanoseconds threshold);
+  // Returns once the entries logged so far are written.
+  void disableSlowQueryLog();
+
+  // Calls, time, rows and scans by statement fingerprint, also queryable as the table
+  // StatementStatistics::kTableName.
+  std::vector<StatementStatistics::Entry> statementStatistics() const;
+  // Indexes the queries run so far would have profited from, also queryable as the table
+  // IndexAdvisor::kTableName.
+  std::vector<IndexAdvisor::Advice> adviseIndexes() const;
+
+  // Bytes held by the tables and the running queries, which are charged to a child tracker
+  // each. Statements that would go over a limit fail with MemoryLimitExceeded and leave the
+  // database as it was; MemoryTracker::kUnlimited lifts a limit.
+  std::shared_ptr<const MemoryTracker> memory() const;
+  void setMemoryLimit(size_t bytes);
+  // Limit for each query, on the rows and hash tables its operators hold at once.
+  void setQueryMemoryLimit(size_t bytes);
+
   friend class QueryPlan;
+  friend class JoinOrder;
+  friend class PredicatePushdown;
+  friend class PreparedStatement;
 
  private:
   std::shared_ptr<ITable> getTable(std::shared_ptr<Expr> tableRef) const;
+  // Stored table named `name`, nullptr when there is none.
+  std::shared_ptr<StorageTable> findTable(const std::string& name) const;
+  std::vector<std::shared_ptr<StorageTable>> storedTables() const;
+  // Locks the stored tables `statement` reads and writes, to hold until it is done.
+  std::shared_ptr<TableLocks> lock(std::shared_ptr<SQLStatement> statement) const;
+  void readTables(const SelectStatement& select, TableLocks& locks) const;
+  void readTables(std::shared_ptr<Expr> expr, TableLocks& locks) const;
+  // `rows` keeping `locks` until the caller releases them.
+  static std::shared_ptr<TableIterator> holding(std::shared_ptr<TableIterator> rows,
+                                                std::shared_ptr<TableLocks> locks);
+  // Read-only tables answered by the engine, built as of now whenever they are looked up;
+  // nullptr for other names.
+  std::shared_ptr<StorageTable> systemTable(const std::string& name) const;
+  static bool isSystemTable(const std::string& name);
+  // Parses `sql` and records the latency, throws when it is not valid.
+  std::shared_ptr<SQLParserResult> parse(const std::string& sql);
   std::shared_ptr<QueryPlan> plan(std::shared_ptr<SQLStatement> statement);
-  std::shared_ptr<ITable> execute(std::shared_ptr<QueryPlan> plan);
+  // With `profile` every step counts what it does into QueryPlan::actual_.
+  std::shared_ptr<ITable> execute(std::shared_ptr<QueryPlan> plan, bool profile = false);
+  std::shared_ptr<ITable> executeStep(std::shared_ptr<QueryPlan> plan, bool profile);
+  // Runs the plan to its last row.
+  void profile(std::shared_ptr<QueryPlan> plan);
+
+  // Cached entry for a normalized statement, parsed and planned on a miss, and the locks of
+  // its statement.
+  std::shared_ptr<CachedPlan> cached(const std::string& key,
+                                     const std::vector<std::shared_ptr<Expr>>& literals,
+                                     std::shared_ptr<TableLocks>& locks);
+  bool isCurrent(const CachedPlan& entry) const;
+  // Plans the entry's statement with the values its parameters hold, against the tables as
+  // they are now.
+  void replan(CachedPlan& entry);
+  void collectTables(std::shared_ptr<QueryPlan> plan, CachedPlan& entry) const;
+  void addTable(std::shared_ptr<Expr> tableRef, CachedPlan& entry) const;
+  std::shared_ptr<TableIterator> execute(std::shared_ptr<CachedPlan> entry,
+                                         const std::vector<std::shared_ptr<Expr>>& literals,
+                                         const std::string& sql, uint64_t start,
+                                         std::shared_ptr<TableLocks> locks);
+  // Records a statement started at `start` (Tracer::now) that is done now in the statement
+  // statistics and, when slow, in the slow query log. `normalized` is its fingerprinted text.
+  void complete(StatementType type, uint64_t start, uint64_t rows, const std::string& sql,
+                const std::string& normalized,
+                const std::vector<std::shared_ptr<Expr>>& parameters,
+                std::shared_ptr<QueryPlan> plan) const;
+  // complete() for a query, called once its rows are read.
+  std::function<void(uint64_t rows)> completion(
+      StatementType type, uint64_t start, const std::string& sql, const std::string& normalized,
+      const std::vector<std::shared_ptr<Expr>>& parameters,
+      std::shared_ptr<QueryPlan> plan) const;
+  static void countScans(const QueryPlan& plan, StatementStatistics::Usage& usage);
 
   std::shared_ptr<ITable> create(std::shared_ptr<CreateStatement> createStatement);
-  std::shared_ptr<ITable> insert(std::shared_ptr<InsertStatement> insertStatement);
-  std::shared_ptr<ITable> delete_(std::shared_ptr<DeleteStatement> deleteStatement);
+  // Both return the number of rows inserted or deleted.
+  size_t insert(std::shared_ptr<InsertStatement> insertStatement);
+  size_t delete_(std::shared_ptr<DeleteStatement> deleteStatement);
   std::shared_ptr<ITable> update(std::shared_ptr<UpdateStatement> updateStatement);
+  void analyze(std::shared_ptr<AnalyzeStatement> analyzeStatement);
+  // One row per line of QueryPlan::explain.
+  std::shared_ptr<ITable> explain(std::shared_ptr<ExplainStatement> explainStatement);
 
+  mutable std::shared_mutex tablesMutex_;  // guards tables_ itself, not the tables
   std::unordered_map<std::string, std::shared_ptr<StorageTable>> tables_;
+  std::shared_ptr<PlanCache> planCache_ = std::make_shared<PlanCache>();
+  std::shared_ptr<Metrics> metrics_ = std::make_shared<Metrics>();
+  std::atomic<std::shared_ptr<SlowQueryLog>> slowQueryLog_;
+  std::shared_ptr<StatementStatistics> statementStatistics_ =
+      std::make_shared<StatementStatistics>();
+  std::shared_ptr<IndexAdvisor> indexAdvisor_ = std::make_shared<IndexAdvisor>();
+  std::shared_ptr<MemoryTracker> memory_ = MemoryTracker::create("database");
+  std::atomic<size_t> queryMemoryLimit_{MemoryTracker::kUnlimited};
 };
 
 }  // namespace storage
@@ -3,6 +3,7 @@
 #include <vector>
 
 #include "column.h"
+#include "memory/arena.h"
 #include "memory/cell.h"
 #include "row.h"
 #include "sql/expr.h"
@@ -21,6 +22,7 @@ std::shared_ptr<EvaluatedTable> EvaluatedTable::create(
     std::shared_ptr<ITable> table,
     std::shared_ptr<std::vector<std::shared_ptr<Expr>>> expressions) {
   auto table_ = std::make_shared<EvaluatedTable>(table, expressions);
+  table_->memory_ = MemoryTracker::create("eval " + table->getName(), MemoryTracker::query());
   for (auto columnExpr : *expressions) {
     if (columnExpr->isType(kExprColumnRef)) {
       std::shared_ptr<Column> originalColumn = table->getColumn(columnExpr);
@@ -70,15 +72,20 @@ EvaluateIterator& EvaluateIterator::operator++() {
 
 std::shared_ptr<Row> EvaluateIterator::operator*() {
   auto row = *(*it_);
-  std::shared_ptr<Cell> cell = std::make_shared<Cell>();
+  const auto& arena = rows_.get();
+  ArenaScope scope(arena);  // for the intermediate results of the expressions
+  auto cell = makeNode<TrackedCell>();
   for (auto column : table_->getColumns()) {
     if (column->refferedExpr()) {  // expression
-      cell->values.push_back(column->createValue(row->evaluate(column->refferedExpr())));
+      cell->values.push_back(
+          column->createValue(row->evaluate(column->refferedExpr()), arena.get()));
     } else {
-      cell->values.push_back(column->createValue(row->getColumnValue(column->refferedColumn())));
+      cell->values.push_back(
+          column->createValue(row->getColumnValue(column->refferedColumn()), arena.get()));
     }
   }
-  return std::make_shared<Row>(table_, cell);
+  table_->charge(*cell);
+  return makeNode<Row>(table_, cell);
 }
 
 std::shared_ptr<Iterator> EvaluateIterator::getMemoryIterator() {
@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <chrono>
 #include <memory>
 #include <string>
 #include <vector>
@@ -10,59 +12,155 @@
 #include "sql/statements/select.h"
 #include "table.h"
 
+namespace {
+using namespace csql;
+
+bool divides(const Expr& expr) {
+  if (expr.type == kExprOperator && (expr.opType == kOpSlash || expr.opType == kOpPercentage)) {
+    return true;
+  }
+  return (expr.expr && divides(*expr.expr)) || (expr.expr2 && divides(*expr.expr2));
+}
+
+}  // namespace
+
 namespace csql {
 namespace storage {
 
-WhereClauseIterator::WhereClauseIterator(std::shared_ptr<TableIterator> tableIterator,
-                                         std::shared_ptr<Expr> whereClause)
-    : tableIterator_(tableIterator), whereClause_(whereClause) {
-  while (tableIterator_->hasValue()) {  // skip rows that don't match the where clause
-    auto row = *(*tableIterator_);
-    auto expr = row->evaluate(whereClause_);
+ConjunctOrder::ConjunctOrder(std::shared_ptr<Expr> whereClause) {
+  std::vector<std::shared_ptr<Expr>> pending = {whereClause};
+  while (!pending.empty()) {
+    auto expr = pending.back();
+    pending.pop_back();
+    if (expr->type == kExprOperator && (expr->opType == kOpAnd || expr->opType == kOpParenthesis)) {
+      if (expr->expr2) pending.push_back(expr->expr2);
+      pending.push_back(expr->expr);
+    } else {
+      conjuncts_.push_back(Conjunct{.expr = expr, .divides = divides(*expr)});
+    }
+  }
+}
+
+bool ConjunctOrder::accepts(Row& row) {
+  if (conjuncts_.size() == 1) {
+    auto expr = row.evaluate(conjuncts_[0].expr);
     if (expr->type != kExprLiteralBool) {
       throw std::runtime_error("Expected boolean expression");
     }
-    if (expr->ival) {
-      break;
+    return expr->ival;
+  }
+  bool sample = rows_ % kSampleInterval == 0;
+  if (++rows_ % kReorderInterval == 0) {
+    reorder();
+  }
+  for (auto& conjunct : conjuncts_) {
+    std::chrono::steady_clock::time_point start;
+    if (sample) start = std::chrono::steady_clock::now();
+    auto expr = row.evaluate(conjunct.expr);
+    if (sample) {
+      std::chrono::duration<double, std::nano> spent = std::chrono::steady_clock::now() - start;
+      conjunct.nanoseconds += spent.count();
+      conjunct.sampled++;
     }
-    ++(*tableIterator_);
+    conjunct.evaluated++;
+    // AND gives false for anything but two booleans, see Row::evaluate.
+    if (expr->type != kExprLiteralBool || !expr->ival) {
+      return false;
+    }
+    conjunct.passed++;
+  }
+  return true;
+}
+
+void ConjunctOrder::reorder() {
+  auto rank = [](const Conjunct& conjunct) {
+    if (conjunct.sampled == 0 || conjunct.evaluated == 0) return 0.0;
+    double cost = conjunct.nanoseconds / conjunct.sampled;
+    double rejected = 1 - static_cast<double>(conjunct.passed) / conjunct.evaluated;
+    return cost / std::max(rejected, 1e-3);
+  };
+  auto begin = conjuncts_.begin();
+  while (begin != conjuncts_.end()) {
+    auto end = std::find_if(begin, conjuncts_.end(), [](const Conjunct& c) { return c.divides; });
+    std::stable_sort(begin, end,
+                     [&](const Conjunct& a, const Conjunct& b) { return rank(a) < rank(b); });
+    begin = end == conjuncts_.end() ? end : end + 1;
   }
 }
 
+std::vector<std::shared_ptr<Expr>> ConjunctOrder::getConjuncts() const {
+  std::vector<std::shared_ptr<Expr>> exprs;
+  for (const auto& conjunct : conjuncts_) {
+    exprs.push_back(conjunct.expr);
+  }
+  return exprs;
+}
+
+WhereClauseIterator::WhereClauseIterator(std::shared_ptr<TableIterator> tableIterator,
+                                         std::shared_ptr<ConjunctOrder> conjuncts,
+                                         std::shared_ptr<FilterCounts> counts)
+    : tableIterator_(tableIterator), conjuncts_(conjuncts), counts_(counts) {
+  skipRejected();
+}
+
+WhereClauseIterator::~WhereClauseIterator() {
+  flushCounts();
+}
+
+void WhereClauseIterator::flushCounts() {
+  if (counts_ && examined_) {
+    counts_->examined.fetch_add(examined_, std::memory_order_relaxed);
+    counts_->passed.fetch_add(passed_, std::memory_order_relaxed);
+  }
+  examined_ = passed_ = 0;
+}
+
 bool WhereClauseIterator::hasValue() const {
   return tableIterator_->hasValue();
 }
 
 std::shared_ptr<Row> WhereClauseIterator::operator*() {
-  return tableIterator_->operator*();
+  return row_;
 }
 
 WhereClauseIterator& WhereClauseIterator::operator++() {
   ++(*tableIterator_);
-  while (tableIterator_->hasValue()) {
+  skipRejected();
+  return *this;
+}
+
+void WhereClauseIterator::skipRejected() {
+  row_ = nullptr;
+  while (tableIterator_->hasValue()) {  // skip rows that don't match the where clause
     auto row = *(*tableIterator_);
-    auto expr = row->evaluate(whereClause_);
-    if (expr->type != kExprLiteralBool) {
-      throw std::runtime_error("Expected boolean expression");
-    }
-    if (expr->ival) {
+    examined_++;
+    if (conjuncts_->accepts(*row)) {
+      passed_++;
+      row_ = row;  // handed out as is, so that the steps above reuse its memo
       break;
     }
     ++(*tableIterator_);
   }
-  return *this;
+  if (!row_) {
+    flushCounts();  // exhausted, before the rows are reported as read
+  }
 }
 
 std::shared_ptr<Iterator> WhereClauseIterator::getMemoryIterator() {
   return tableIterator_->getMemoryIterator();
 }
 
-FilteredTable::FilteredTable(std::shared_ptr<ITable> table, std::shared_ptr<Expr> whereClause)
-    : table_(table), whereClause_(whereClause) {}
+FilteredTable::FilteredTable(std::shared_ptr<ITable> table, std::shared_ptr<Expr> whereClause,
+                             std::shared_ptr<FilterCounts> counts)
+    : table_(table),
+      whereClause_(whereClause),
+      conjuncts_(std::make_shared<ConjunctOrder>(whereClause)),
+      counts_(counts) {}
 
 std::shared_ptr<FilteredTable> FilteredTable::create(std::shared_ptr<ITable> table,
-                                                     std::shared_ptr<Expr> whereClause) {
-  auto table_ = std::make_shared<FilteredTable>(table, whereClause);
+                                                     std::shared_ptr<Expr> whereClause,
+                                                     std::shared_ptr<FilterCounts> counts) {
+  auto table_ = std::make_shared<FilteredTable>(table, whereClause, counts);
   for (auto column : table->getColumns()) {
     table_->columns_.push_back(column);
   }
@@ -71,7 +169,7 @@ std::shared_ptr<FilteredTable> FilteredTable::create(std::shared_ptr<ITable> tab
 }
 
 std::shared_ptr<TableIterator> FilteredTable::getIterator() {
-  return std::make_shared<WhereClauseIterator>(table_->getIterator(), whereClause_);
+  return std::make_shared<WhereClauseIterator>(table_->getIterator(), conjuncts_, counts_);
 }
 
 }  // namespace storage
@@ -0,0 +1,108 @@
+#include "hardware_counters.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <cstring>
+
+namespace {
+
+#ifdef __linux__
+
+// The counters of one thread, opened as a group so that a single read() returns them all.
+class ThreadCounters {
+ public:
+  ThreadCounters() {
+    const uint64_t configs[kEvents] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                       PERF_COUNT_HW_CACHE_MISSES,
+                                       PERF_COUNT_HW_BRANCH_MISSES};
+    for (size_t i = 0; i < kEvents; i++) {
+      perf_event_attr attr;
+      std::memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = configs[i];
+      attr.read_format =
+          PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+      attr.disabled = leader_ < 0;  // the group starts counting with its leader
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      int fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, leader_, 0));
+      if (fd < 0) continue;  // not supported by this CPU or not permitted
+      if (leader_ < 0) leader_ = fd;
+      events_[members_++] = i;
+      fds_[i] = fd;
+    }
+    if (leader_ >= 0) {
+      ioctl(leader_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+  }
+  ~ThreadCounters() {
+    for (int fd : fds_) {
+      if (fd >= 0) close(fd);
+    }
+  }
+
+  bool read(csql::storage::HardwareCounts& counts) const {
+    if (leader_ < 0) return false;
+    // The number of members, the time the group was enabled and the time it was on the PMU,
+    // then the values of the members in order.
+    uint64_t values[3 + kEvents];
+    if (::read(leader_, values, sizeof(values)) < static_cast<ssize_t>(3 * sizeof(uint64_t))) {
+      return false;
+    }
+    uint64_t enabled = values[1];
+    uint64_t running = values[2];
+    if (running == 0) return false;  // never scheduled, nothing was counted
+    uint64_t* targets[kEvents] = {&counts.cycles, &counts.instructions, &counts.cache_misses,
+                                  &counts.branch_misses};
+    counts = csql::storage::HardwareCounts{};
+    counts.multiplexed = running < enabled;
+    for (size_t i = 0; i < members_ && i < values[0]; i++) {
+      uint64_t value = values[3 + i];
+      if (counts.multiplexed) {
+        value = static_cast<uint64_t>(static_cast<double>(value) * enabled / running);
+      }
+      *targets[events_[i]] = value;
+    }
+    return true;
+  }
+
+ private:
+  static constexpr size_t kEvents = 4;
+
+  int leader_ = -1;
+  int fds_[kEvents] = {-1, -1, -1, -1};
+  size_t events_[kEvents];  // the event of every group member, in the order they joined
+  size_t members_ = 0;
+};
+
+#endif
+
+}  // namespace
+
+namespace csql {
+namespace storage {
+
+std::atomic<bool> HardwareCounters::enabled_{false};
+
+void HardwareCounters::setEnabled(bool enabled) {
+  enabled_.store(enabled, std::memory_order_relaxed);
+}
+
+bool HardwareCounters::read(HardwareCounts& counts) {
+  if (!enabled()) return false;
+#ifdef __linux__
+  thread_local ThreadCounters counters;
+  return counters.read(counts);
+#else
+  return false;
+#endif
+}
+
+}  // namespace storage
+}  // namespace csql
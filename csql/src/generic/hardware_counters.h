@@ -0,0 +1,40 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace csql {
+namespace storage {
+
+// Counts of the CPU's performance monitoring unit for the calling thread, in user space.
+struct HardwareCounts {
+  uint64_t cycles = 0;
+  uint64_t instructions = 0;
+  uint64_t cache_misses = 0;  // last level cache
+  uint64_t branch_misses = 0;
+  // Whether the PMU was shared with other events, so that the counters only ran part of the
+  // time and the counts are extrapolated from that part.
+  bool multiplexed = false;
+};
+
+// Hardware counters read through Linux perf_event_open, for profiling. Off by default; once
+// enabled every thread opens its own counters on first use. Where they can not be opened
+// (another OS, a virtual machine without a PMU, perf_event_paranoid, seccomp) read() fails
+// and profiles go without them.
+class HardwareCounters {
+ public:
+  static void setEnabled(bool enabled);
+  static bool enabled() {
+    return enabled_.load(std::memory_order_relaxed);
+  }
+
+  // Totals of the calling thread so far, scaled up when the counters were multiplexed. False
+  // when not enabled or not available; counters the CPU lacks read as 0.
+  static bool read(HardwareCounts& counts);
+
+ private:
+  static std::atomic<bool> enabled_;
+};
+
+}  // namespace storage
+}  // namespace csql
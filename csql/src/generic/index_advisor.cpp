@@ -0,0 +1,241 @@
+#include "index_advisor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "appender.h"
+#include "column.h"
+#include "planning/planning.h"
+#include "sql/statements/create.h"
+#include "table.h"
+
+namespace {
+using namespace csql;
+
+// Steps to find a value in an ordered index over `rows` rows.
+double searchSteps(double rows) {
+  return rows < 2 ? 1 : std::ceil(std::log2(rows));
+}
+
+int32_t clamped(uint64_t value) {
+  return static_cast<int32_t>(
+      std::min<uint64_t>(value, std::numeric_limits<int32_t>::max()));
+}
+
+void conjuncts(const std::shared_ptr<Expr>& expr, std::vector<std::shared_ptr<Expr>>& result) {
+  if (!expr) return;
+  if (expr->type == kExprOperator && (expr->opType == kOpAnd || expr->opType == kOpParenthesis)) {
+    conjuncts(expr->expr, result);
+    conjuncts(expr->expr2, result);
+  } else {
+    result.push_back(expr);
+  }
+}
+
+// `column op value` as the simplifier leaves comparisons against constants.
+bool isSargable(const Expr& conjunct) {
+  if (conjunct.type != kExprOperator || !conjunct.expr || !conjunct.expr2) return false;
+  switch (conjunct.opType) {
+    case kOpEquals:
+    case kOpLess:
+    case kOpLessEq:
+    case kOpGreater:
+    case kOpGreaterEq:
+      break;
+    default:
+      return false;
+  }
+  return conjunct.expr->type == kExprColumnRef &&
+         ((conjunct.expr2->isLiteral() && conjunct.expr2->type != kExprLiteralNull) ||
+          conjunct.expr2->type == kExprParameter);
+}
+
+}  // namespace
+
+namespace csql {
+namespace storage {
+
+void IndexAdvisor::instrument(QueryPlan& plan) {
+  if (plan.type_ == QueryType::kStepFilter && !plan.filtered_) {
+    plan.filtered_ = std::make_shared<FilterCounts>();
+  }
+  if (plan.left_) instrument(*plan.left_);
+  if (plan.right_) instrument(*plan.right_);
+}
+
+void IndexAdvisor::observe(const QueryPlan& plan) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<const QueryPlan*> pending = {&plan};
+  while (!pending.empty()) {
+    const QueryPlan* step = pending.back();
+    pending.pop_back();
+    if (step->type_ == QueryType::kStepFilter) {
+      observeFilter(*step);
+    } else if (step->type_ == QueryType::kStepJoin) {
+      observeJoin(*step);
+    }
+    if (step->left_) pending.push_back(step->left_.get());
+    if (step->right_) pending.push_back(step->right_.get());
+  }
+}
+
+void IndexAdvisor::observeFilter(const QueryPlan& filter) {
+  if (!filter.filtered_) return;
+  uint64_t examined = filter.filtered_->examined.exchange(0, std::memory_order_relaxed);
+  uint64_t passed = filter.filtered_->passed.exchange(0, std::memory_order_relaxed);
+  // Only a full scan of a single table can be replaced by an index lookup
+  const QueryPlan* scan = filter.left_.get();
+  if (scan && scan->type_ == QueryType::kStepFullScan) scan = scan->left_.get();
+  if (examined == 0 || !scan || scan->type_ != QueryType::kStepProject) return;
+
+  struct Use {
+    bool equality = false;
+    double matches;  // rows the index would return
+  };
+  std::unordered_map<Candidate*, Use> uses;  // a column compared twice is looked up once
+  std::vector<std::shared_ptr<Expr>> parts;
+  conjuncts(filter.query_, parts);
+  for (const auto& conjunct : parts) {
+    if (!isSargable(*conjunct)) continue;
+    Candidate* candidate = this->candidate(filter, *conjunct->expr);
+    if (!candidate) continue;
+    // The rows it accepts are known when it is the whole clause, bounded below otherwise
+    double matches = parts.size() == 1
+                         ? passed
+                         : std::max<double>(passed, examined * filter.selectivity(conjunct));
+    auto [use, added] = uses.try_emplace(candidate, Use{false, matches});
+    use->second.equality |= conjunct->opType == kOpEquals;
+    use->second.matches = std::min(use->second.matches, matches);
+  }
+  for (const auto& [candidate, use] : uses) {
+    candidate->rows_examined += examined;
+    candidate->rows_passed += passed;
+    candidate->steps_before += examined;
+    candidate->ordered_steps += searchSteps(examined) + use.matches;
+    if (use.equality) {
+      candidate->equality_calls++;
+      candidate->unordered_steps += 1 + use.matches;
+    } else {
+      candidate->range_calls++;
+      candidate->unordered_steps += examined;  // hashing does not serve ranges
+    }
+  }
+}
+
+void IndexAdvisor::observeJoin(const QueryPlan& join) {
+  if (!join.query_ || !join.left_ || !join.right_) return;
+  const Cost& left = join.left_->getCost();
+  const Cost& right = join.right_->getCost();
+  const Cost& cost = join.getCost();
+  // The right side is scanned once per left row; an index on its key is probed instead
+  double perLeftRow = static_cast<double>(cost.amount) / std::max<size_t>(left.amount, 1);
+  std::vector<std::shared_ptr<Expr>> parts;
+  conjuncts(join.query_->on, parts);
+  for (const auto& conjunct : parts) {
+    if (conjunct->type != kExprOperator || conjunct->opType != kOpEquals || !conjunct->expr ||
+        !conjunct->expr2 || conjunct->expr->type != kExprColumnRef ||
+        conjunct->expr2->type != kExprColumnRef) {
+      continue;
+    }
+    Candidate* candidate = this->candidate(*join.right_, *conjunct->expr);
+    if (!candidate) candidate = this->candidate(*join.right_, *conjunct->expr2);
+    if (!candidate) continue;
+    double before = static_cast<double>(left.amount) * right.amount;
+    candidate->join_calls++;
+    candidate->rows_examined += static_cast<uint64_t>(before);
+    candidate->rows_passed += cost.amount;
+    candidate->steps_before += before;
+    candidate->ordered_steps += left.amount * (searchSteps(right.amount) + perLeftRow);
+    candidate->unordered_steps += left.amount * (1 + perLeftRow);
+  }
+}
+
+IndexAdvisor::Candidate* IndexAdvisor::candidate(const QueryPlan& plan, const Expr& column) {
+  auto source = plan.resolve(column);
+  if (!source.table) return nullptr;
+  const auto& stored = source.table->getColumns()[source.index];
+  if (source.table->isLeadingKey(*stored)) return nullptr;  // already a range scan
+  return &candidates_[{source.table->getName(), stored->getName()}];
+}
+
+std::vector<IndexAdvisor::Advice> IndexAdvisor::advise() const {
+  std::vector<Advice> advice;
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto& [name, candidate] : candidates_) {
+    bool ordered = candidate.range_calls > 0;
+    double after = ordered ? candidate.ordered_steps : candidate.unordered_steps;
+    if (after >= candidate.steps_before) continue;
+    uint64_t calls = candidate.equality_calls + candidate.range_calls + candidate.join_calls;
+    const auto& [table, column] = name;
+    advice.push_back(Advice{
+        table, column, ordered,
+        std::string("CREATE ") + (ordered ? "ORDERED" : "UNORDERED") + " INDEX " + table + "_" +
+            column + " ON " + table + " (" + column + ");",
+        calls, candidate.rows_examined, candidate.rows_passed,
+        static_cast<uint64_t>(candidate.steps_before / calls),
+        static_cast<uint64_t>(after / calls),
+        static_cast<uint64_t>(candidate.steps_before - after)});
+  }
+  std::stable_sort(advice.begin(), advice.end(),
+                   [](const Advice& a, const Advice& b) { return a.benefit > b.benefit; });
+  return advice;
+}
+
+void IndexAdvisor::clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  candidates_.clear();
+}
+
+std::shared_ptr<StorageTable> IndexAdvisor::toTable() const {
+  auto advice = advise();
+  size_t statementWidth = 1, nameWidth = 1;
+  for (const auto& entry : advice) {
+    statementWidth = std::max(statementWidth, entry.statement.size());
+    nameWidth = std::max({nameWidth, entry.table.size(), entry.column.size()});
+  }
+
+  auto createStatement = std::make_shared<CreateStatement>(CreateType::kCreateTable);
+  createStatement->tableName = kTableName;
+  createStatement->columns = std::make_shared<std::vector<std::shared_ptr<ColumnDefinition>>>();
+  auto addColumn = [&](const char* name, ColumnType type, bool key = false) {
+    auto constraints = std::make_shared<std::unordered_set<ConstraintType>>();
+    if (key) {
+      constraints->insert(ConstraintType::Key);
+    }
+    createStatement->columns->push_back(
+        std::make_shared<ColumnDefinition>(name, type, constraints, nullptr));
+  };
+  addColumn("statement", ColumnType(DataType::STRING, statementWidth), true);
+  addColumn("table_name", ColumnType(DataType::STRING, nameWidth));
+  addColumn("column_name", ColumnType(DataType::STRING, nameWidth));
+  addColumn("kind", ColumnType(DataType::STRING, 9));
+  for (const char* name : {"calls", "rows_examined", "rows_passed", "steps_before", "steps_after",
+                           "benefit"}) {
+    addColumn(name, ColumnType(DataType::INT32));
+  }
+  auto table = StorageTable::create(createStatement);
+  {
+    Appender appender(table);
+    for (const auto& entry : advice) {
+      appender.append(entry.statement)
+          .append(entry.table)
+          .append(entry.column)
+          .append(entry.ordered ? "ORDERED" : "UNORDERED")
+          .append(clamped(entry.calls))
+          .append(clamped(entry.rows_examined))
+          .append(clamped(entry.rows_passed))
+          .append(clamped(entry.steps_before))
+          .append(clamped(entry.steps_after))
+          .append(clamped(entry.benefit))
+          .endRow();
+    }
+    appender.flush();
+  }
+  return table;
+}
+
+}  // namespace storage
+}  // namespace csql
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "sql/expr.h"
+
+namespace csql {
+namespace storage {
+
+class StorageTable;
+struct QueryPlan;
+
+// Recommends indexes from the queries that ran: the columns their full scans were filtered
+// on, with the rows examined and accepted by the filters, and the keys of the nested loop
+// joins. The benefit of an index is the steps of the Cost model it would have saved over
+// that workload.
+class IndexAdvisor {
+ public:
+  // Name under which the advice can be queried, see toTable().
+  static constexpr const char* kTableName = "csql_index_advice";
+
+  struct Advice {
+    std::string table;
+    std::string column;
+    bool ordered;           // ORDERED INDEX for ranges, UNORDERED INDEX for equalities only
+    std::string statement;  // CREATE ... INDEX
+    uint64_t calls;         // executions of plan steps it would serve
+    uint64_t rows_examined;
+    uint64_t rows_passed;
+    // What-if: mean steps per call of the steps served, as planned and with the index.
+    uint64_t steps_before;
+    uint64_t steps_after;
+    uint64_t benefit;  // steps saved over all calls
+  };
+
+  // Gives the filter steps of `plan` the counters observe() reads, once it is planned.
+  static void instrument(QueryPlan& plan);
+  // Counts what a finished execution of `plan` read; takes the rows its filters counted
+  // since the last call.
+  void observe(const QueryPlan& plan);
+  // Indexes that would have saved steps, the most beneficial first.
+  std::vector<Advice> advise() const;
+  void clear();
+
+  // Snapshot of advise() as a table with the columns statement (KEY), table_name,
+  // column_name, kind, calls, rows_examined, rows_passed, steps_before, steps_after and
+  // benefit.
+  std::shared_ptr<StorageTable> toTable() const;
+
+ private:
+  struct Candidate {
+    uint64_t equality_calls = 0;
+    uint64_t range_calls = 0;
+    uint64_t join_calls = 0;
+    uint64_t rows_examined = 0;
+    uint64_t rows_passed = 0;
+    double steps_before = 0;  // summed over calls
+    double ordered_steps = 0;
+    double unordered_steps = 0;  // for equalities and joins, ranges keep steps_before
+  };
+
+  void observeFilter(const QueryPlan& filter);
+  void observeJoin(const QueryPlan& join);
+  // Candidate for the stored column `column` refers to below `plan`; nullptr when it is not
+  // one, or is the leading key its table is ordered by.
+  Candidate* candidate(const QueryPlan& plan, const Expr& column);
+
+  mutable std::mutex mutex_;
+  std::map<std::pair<std::string, std::string>, Candidate> candidates_;  // by table, column
+};
+
+}  // namespace storage
+}  // namespace csql
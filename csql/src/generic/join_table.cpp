@@ -2,6 +2,7 @@
 #include <string>
 
 #include "column.h"
+#include "memory/arena.h"
 #include "row.h"
 #include "sql/expr.h"
 #include "table.h"
@@ -10,32 +11,117 @@ namespace csql {
 namespace storage {
 
 JoinTable::JoinTable(std::shared_ptr<ITable> left, std::shared_ptr<ITable> right,
-                     std::shared_ptr<Expr> onClause, OperatorType joinType)
-    : left_(left), right_(right), onClause_(onClause), joinType_(joinType) {
+                     std::shared_ptr<Expr> onClause, OperatorType joinType,
+                     JoinStrategy strategy)
+    : left_(left), right_(right), onClause_(onClause), joinType_(joinType), strategy_(strategy) {
   name_ = left->getName() + "_" + right->getName();
 }
 
-std::shared_ptr<JoinTable> JoinTable::create(std::shared_ptr<ITable> left,
-                                             std::shared_ptr<ITable> right,
-                                             std::shared_ptr<Expr> onClause,
-                                             OperatorType joinType) {
-  auto table = std::make_shared<JoinTable>(left, right, onClause, joinType);
-  for (const auto& column : left->getColumns()) {
-    table->columns_.push_back(column->clone(table));
-  }
-  for (const auto& column : right->getColumns()) {
-    table->columns_.push_back(column->clone(table));
+std::shared_ptr<JoinTable> JoinTable::create(
+    std::shared_ptr<ITable> left, std::shared_ptr<ITable> right, std::shared_ptr<Expr> onClause,
+    OperatorType joinType, JoinStrategy strategy,
+    std::shared_ptr<std::vector<std::shared_ptr<Expr>>> columns) {
+  auto table = std::make_shared<JoinTable>(left, right, onClause, joinType, strategy);
+  table->memory_ = MemoryTracker::create("join " + table->name_, MemoryTracker::query());
+  size_t source = 0;
+  for (const auto& side : {left, right}) {
+    for (const auto& column : side->getColumns()) {
+      if (!columns || table->isReferenced(*column, *columns)) {
+        table->columns_.push_back(column->clone(table));
+        table->sources_.push_back(source);
+      }
+      source++;
+    }
   }
   return table;
 }
 
+bool JoinTable::isReferenced(const Column& column,
+                             const std::vector<std::shared_ptr<Expr>>& columns) const {
+  for (const auto& ref : columns) {
+    if (ref->name != column.getName()) continue;
+    if (ref->table.empty() || column.isFrom(ref->table)) return true;
+    // A qualifier no column comes from falls back to the first column of that name
+    bool qualified = false;
+    for (const auto& side : {left_, right_}) {
+      for (const auto& other : side->getColumns()) {
+        qualified = qualified || (other->getName() == ref->name && other->isFrom(ref->table));
+      }
+    }
+    if (!qualified) return true;
+  }
+  return false;
+}
+
 std::shared_ptr<TableIterator> JoinTable::getIterator() {
-  if (joinType_ == kOpInnerJoin) {
-    return std::make_shared<InnerJoinIterator>(
-        std::dynamic_pointer_cast<JoinTable>(shared_from_this()));
-  } else {
+  if (joinType_ != kOpInnerJoin) {
     throw std::runtime_error("Unsupported join type");
   }
+  auto self = std::dynamic_pointer_cast<JoinTable>(shared_from_this());
+  if (strategy_ != JoinStrategy::kNestedLoop) {
+    auto keys = equalityKeys();
+    if (!keys.empty()) {
+      return std::make_shared<HashJoinIterator>(self, strategy_ == JoinStrategy::kHashBuildLeft,
+                                                keys);
+    }
+  }
+  return std::make_shared<InnerJoinIterator>(self);
+}
+
+std::shared_ptr<Row> JoinTable::merge(std::shared_ptr<Row> left, std::shared_ptr<Row> right,
+                                      const std::shared_ptr<Arena>& arena) {
+  ArenaScope scope(arena);  // for the values read from the sides
+  auto cell = makeNode<TrackedCell>();
+  auto leftColumnsCount = left_->getColumns().size();
+  cell->values.reserve(columns_.size());
+  for (size_t i = 0; i < columns_.size(); i++) {
+    size_t source = sources_[i];
+    if (source < leftColumnsCount) {
+      cell->values.push_back(
+          columns_[i]->createValue(left->getColumnValue(source), arena.get()));
+    } else {
+      cell->values.push_back(columns_[i]->createValue(
+          right->getColumnValue(source - leftColumnsCount), arena.get()));
+    }
+  }
+  charge(*cell);
+  return makeNode<Row>(shared_from_this(), cell);
+}
+
+std::vector<std::pair<size_t, size_t>> JoinTable::equalityKeys() {
+  std::vector<std::pair<size_t, size_t>> keys;
+  std::vector<std::shared_ptr<Expr>> conjuncts = {onClause_};
+  auto leftColumnsCount = left_->getColumns().size();
+  // Columns are resolved the way a merged row resolves them, so the hash join matches
+  // exactly the pairs the ON clause accepts.
+  auto indexOf = [this](const std::shared_ptr<Expr>& expr) -> size_t {
+    auto column = getColumn(expr);
+    for (size_t i = 0; i < columns_.size(); i++) {
+      if (columns_[i] == column) return sources_[i];
+    }
+    throw std::runtime_error("Column not found: " + expr->toString());
+  };
+  while (!conjuncts.empty()) {
+    auto expr = conjuncts.back();
+    conjuncts.pop_back();
+    if (!expr || expr->type != kExprOperator) continue;
+    if (expr->opType == kOpAnd) {
+      conjuncts.push_back(expr->expr);
+      conjuncts.push_back(expr->expr2);
+    } else if (expr->opType == kOpParenthesis) {
+      conjuncts.push_back(expr->expr);
+    } else if (expr->opType == kOpEquals && expr->expr->type == kExprColumnRef &&
+               expr->expr2->type == kExprColumnRef) {
+      size_t first = indexOf(expr->expr);
+      size_t second = indexOf(expr->expr2);
+      if (first < leftColumnsCount && second >= leftColumnsCount) {
+        keys.emplace_back(first, second - leftColumnsCount);
+      } else if (second < leftColumnsCount && first >= leftColumnsCount) {
+        keys.emplace_back(second, first - leftColumnsCount);
+      }
+    }
+  }
+  return keys;
 }
 
 JoinTableIterator::JoinTableIterator(std::shared_ptr<JoinTable> table)
@@ -48,19 +134,7 @@ bool JoinTableIterator::hasValue() const {
 }
 
 std::shared_ptr<Row> JoinTableIterator::mergeRows() {
-  std::shared_ptr<Cell> cell = std::make_shared<Cell>();
-  auto leftColumnsCount = table_->left_->getColumns().size();
-  auto columns = table_->getColumns();
-  for (size_t i = 0; i < columns.size(); i++) {
-    if (i < leftColumnsCount) {
-      cell->values.push_back(columns[i]->createValue((*(*leftTableIterator_))->getColumnValue(i)));
-    } else {
-      cell->values.push_back(
-          columns[i]->createValue((*(*rightTableIterator_))->getColumnValue(i - leftColumnsCount)));
-    }
-  }
-
-  return std::make_shared<Row>(table_, cell);
+  return table_->merge(*(*leftTableIterator_), *(*rightTableIterator_), rows_.get());
 }
 
 std::shared_ptr<Row> JoinTableIterator::operator*() {
@@ -72,7 +146,9 @@ std::shared_ptr<Iterator> JoinTableIterator::getMemoryIterator() {
 }
 
 void JoinTableIterator::resetRight() {
-  rightTableIterator_ = table_->right_->getIterator();
+  if (leftTableIterator_->hasValue()) {  // past the last left row the join is done
+    rightTableIterator_ = table_->right_->getIterator();
+  }
 }
 
 bool JoinTableIterator::match() {
@@ -82,6 +158,7 @@ bool JoinTableIterator::match() {
 InnerJoinIterator::InnerJoinIterator(std::shared_ptr<JoinTable> table) : JoinTableIterator(table) {
   if (!hasValue()) {
     row_ = nullptr;
+    return;
   }
   row_ = mergeRows();
   if (!match()) {
@@ -119,5 +196,105 @@ InnerJoinIterator& InnerJoinIterator::operator++() {
 
   return *this;
 }
+
+// Equal keys encode to equal strings; NULL never matches, as in the ON clause.
+bool HashJoinIterator::joinKey(Row& row, const std::vector<size_t>& columns, std::string& key) {
+  key.clear();
+  for (size_t index : columns) {
+    auto value = row.getColumnValue(index);
+    if (value->type == kExprLiteralNull) {
+      return false;
+    }
+    key += static_cast<char>(value->type);
+    if (value->type == kExprLiteralInt || value->type == kExprLiteralBool) {
+      key.append(reinterpret_cast<const char*>(&value->ival), sizeof(value->ival));
+    } else {
+      size_t size = value->name.size();
+      key.append(reinterpret_cast<const char*>(&size), sizeof(size));
+      key += value->name;
+    }
+  }
+  return true;
+}
+
+HashJoinIterator::HashJoinIterator(std::shared_ptr<JoinTable> table, bool buildLeft,
+                                   const std::vector<std::pair<size_t, size_t>>& keys)
+    : table_(table), buildLeft_(buildLeft) {
+  for (const auto& [left, right] : keys) {
+    buildKeys_.push_back(buildLeft ? left : right);
+    probeKeys_.push_back(buildLeft ? right : left);
+  }
+
+  std::string key;
+  auto build = (buildLeft ? table_->left_ : table_->right_)->getIterator();
+  while (build->hasValue()) {
+    auto row = *(*build);
+    if (joinKey(*row, buildKeys_, key)) {
+      auto [bucket, added] = buckets_.try_emplace(key);
+      size_t bytes = sizeof(std::shared_ptr<Row>);
+      if (added) {  // the hash node with its key and bucket
+        bytes += 2 * sizeof(void*) + sizeof(bucket->first) + sizeof(bucket->second) + key.size();
+      }
+      table_->memory_->charge(bytes);
+      charged_ += bytes;
+      bucket->second.push_back(row);
+    }
+    ++(*build);
+  }
+
+  probe_ = (buildLeft ? table_->right_ : table_->left_)->getIterator();
+  findMatch();
+}
+
+HashJoinIterator::~HashJoinIterator() {
+  table_->memory_->release(charged_);
+}
+
+void HashJoinIterator::findMatch() {
+  std::string key;
+  row_ = nullptr;
+  while (probe_->hasValue()) {
+    auto probeRow = *(*probe_);
+    if (!matches_) {
+      auto bucket = joinKey(*probeRow, probeKeys_, key) ? buckets_.find(key) : buckets_.end();
+      if (bucket != buckets_.end()) {
+        matches_ = &bucket->second;
+        match_ = 0;
+      }
+    }
+    while (matches_ && match_ < matches_->size()) {
+      auto buildRow = (*matches_)[match_++];
+      auto row = buildLeft_ ? table_->merge(buildRow, probeRow, rows_.get())
+                            : table_->merge(probeRow, buildRow, rows_.get());
+      if (row->evaluate(table_->onClause_)->ival) {
+        row_ = row;
+        return;
+      }
+    }
+    matches_ = nullptr;
+    ++(*probe_);
+  }
+}
+
+bool HashJoinIterator::hasValue() const {
+  return row_ != nullptr;
+}
+
+HashJoinIterator& HashJoinIterator::operator++() {
+  if (!hasValue()) {
+    throw std::runtime_error("No more values");
+  }
+  findMatch();
+  return *this;
+}
+
+std::shared_ptr<Row> HashJoinIterator::operator*() {
+  return row_;
+}
+
+std::shared_ptr<Iterator> HashJoinIterator::getMemoryIterator() {
+  return nullptr;
+}
+
 }  // namespace storage
-}  // namespace csql
\ No newline at end of file
+}  // namespace csql
@@ -0,0 +1,293 @@
+#include "metrics.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <iomanip>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "memory/allocations.h"
+#include "trace.h"
+
+namespace {
+using namespace csql;
+
+const char* phaseName(storage::MetricsPhase phase) {
+  switch (phase) {
+    case storage::MetricsPhase::kParse:
+      return "parse";
+    case storage::MetricsPhase::kPlan:
+      return "plan";
+    default:
+      return "execute";
+  }
+}
+
+const char* statementName(StatementType type) {
+  switch (type) {
+    case kStmtSelect:
+      return "select";
+    case kStmtInsert:
+      return "insert";
+    case kStmtUpdate:
+      return "update";
+    case kStmtDelete:
+      return "delete";
+    case kStmtCreate:
+      return "create";
+    case kStmtDrop:
+      return "drop";
+    case kStmtAnalyze:
+      return "analyze";
+    case kStmtExplain:
+      return "explain";
+  }
+  return "unknown";
+}
+
+// `value` as a Prometheus label value.
+std::string labelValue(const std::string& value) {
+  std::string result;
+  for (char c : value) {
+    if (c == '\\' || c == '"') {
+      result += '\\';
+      result += c;
+    } else if (c == '\n') {
+      result += "\\n";
+    } else {
+      result += c;
+    }
+  }
+  return result;
+}
+
+void addAllocations(storage::Metrics& metrics, const storage::AllocationCount& before) {
+  auto after = storage::threadAllocations();
+  metrics.allocations.fetch_add(after.count - before.count, std::memory_order_relaxed);
+  metrics.allocated_bytes.fetch_add(after.bytes - before.bytes, std::memory_order_relaxed);
+}
+
+}  // namespace
+
+namespace csql {
+namespace storage {
+
+void LatencyHistogram::record(uint64_t nanoseconds) {
+  counts_[bucket(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+  count_.fetch_add(1, std::memory_order_relaxed);
+  sum_.fetch_add(nanoseconds, std::memory_order_relaxed);
+  uint64_t max = max_.load(std::memory_order_relaxed);
+  while (nanoseconds > max &&
+         !max_.compare_exchange_weak(max, nanoseconds, std::memory_order_relaxed)) {
+  }
+}
+
+uint64_t LatencyHistogram::count() const {
+  return count_.load(std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::sum() const {
+  return sum_.load(std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::max() const {
+  return max_.load(std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::percentile(double fraction) const {
+  uint64_t total = count();
+  if (total == 0) return 0;
+  uint64_t rank = static_cast<uint64_t>(std::ceil(fraction * total));
+  rank = rank == 0 ? 1 : rank;
+  uint64_t seen = 0;
+  for (size_t i = 0; i < kBuckets; i++) {
+    seen += counts_[i].load(std::memory_order_relaxed);
+    if (seen >= rank) {
+      return std::min(highest(i), max());
+    }
+  }
+  return max();  // recorded meanwhile
+}
+
+size_t LatencyHistogram::bucket(uint64_t value) {
+  if (value < kSubBuckets) return value;
+  size_t bits = std::bit_width(value);  // the leading bit is bits - 1
+  if (bits > kMaxBits) return kBuckets - 1;
+  size_t shift = bits - kSubBucketBits - 1;
+  return (shift + 1) * kSubBuckets + ((value >> shift) - kSubBuckets);
+}
+
+uint64_t LatencyHistogram::highest(size_t bucket) {
+  if (bucket < kSubBuckets) return bucket;
+  size_t shift = bucket / kSubBuckets - 1;
+  uint64_t lowest = static_cast<uint64_t>(bucket % kSubBuckets + kSubBuckets) << shift;
+  return lowest + (uint64_t{1} << shift) - 1;
+}
+
+LatencyHistogram& Metrics::latency(MetricsPhase phase, StatementType type) {
+  return latencies_[static_cast<size_t>(phase) * kStatementTypes + type];
+}
+
+const LatencyHistogram& Metrics::latency(MetricsPhase phase, StatementType type) const {
+  return latencies_[static_cast<size_t>(phase) * kStatementTypes + type];
+}
+
+PhaseTimer::PhaseTimer(std::shared_ptr<Metrics> metrics, MetricsPhase phase)
+    : metrics_(metrics), phase_(phase), start_(Tracer::now()) {
+  auto allocations = threadAllocations();
+  allocations_ = allocations.count;
+  bytes_ = allocations.bytes;
+}
+
+void PhaseTimer::stop(StatementType type) {
+  metrics_->latency(phase_, type).record(Tracer::now() - start_);
+  addAllocations(*metrics_, AllocationCount{allocations_, bytes_});
+}
+
+std::shared_ptr<TableIterator> PhaseTimer::stop(StatementType type,
+                                                std::shared_ptr<TableIterator> rows,
+                                                std::function<void(uint64_t rows)> done) {
+  addAllocations(*metrics_, AllocationCount{allocations_, bytes_});
+  return std::make_shared<MeteredIterator>(rows, metrics_, type, start_, std::move(done));
+}
+
+MeteredIterator::MeteredIterator(std::shared_ptr<TableIterator> it,
+                                 std::shared_ptr<Metrics> metrics, StatementType type,
+                                 uint64_t start, std::function<void(uint64_t rows)> done)
+    : it_(it), metrics_(metrics), type_(type), start_(start), done_(std::move(done)) {
+  if (it_->hasValue()) {
+    rows_++;
+  } else {
+    finish();
+  }
+}
+
+MeteredIterator::~MeteredIterator() {
+  finish();
+}
+
+bool MeteredIterator::hasValue() const {
+  return it_->hasValue();
+}
+
+MeteredIterator& MeteredIterator::operator++() {
+  auto before = threadAllocations();
+  ++(*it_);
+  addAllocations(*metrics_, before);
+  if (it_->hasValue()) {
+    rows_++;
+  } else {
+    finish();
+  }
+  return *this;
+}
+
+std::shared_ptr<Row> MeteredIterator::operator*() {
+  auto before = threadAllocations();
+  auto row = **it_;
+  addAllocations(*metrics_, before);
+  return row;
+}
+
+std::shared_ptr<Iterator> MeteredIterator::getMemoryIterator() {
+  return it_->getMemoryIterator();
+}
+
+void MeteredIterator::finish() {
+  if (finished_) return;
+  finished_ = true;
+  metrics_->latency(MetricsPhase::kExecute, type_).record(Tracer::now() - start_);
+  metrics_->rows_returned.fetch_add(rows_, std::memory_order_relaxed);
+  if (done_) {
+    done_(rows_);
+  }
+}
+
+MetricsSnapshot MetricsSnapshot::of(const Metrics& metrics) {
+  MetricsSnapshot snapshot;
+  for (size_t phase = 0; phase < Metrics::kPhases; phase++) {
+    for (size_t type = 0; type < Metrics::kStatementTypes; type++) {
+      auto& histogram = metrics.latency(static_cast<MetricsPhase>(phase),
+                                        static_cast<StatementType>(type));
+      if (histogram.count() == 0) continue;
+      snapshot.latencies.push_back(Latency{
+          static_cast<MetricsPhase>(phase), static_cast<StatementType>(type), histogram.count(),
+          histogram.sum(), histogram.max(), histogram.percentile(0.5), histogram.percentile(0.9),
+          histogram.percentile(0.99), histogram.percentile(0.999)});
+    }
+  }
+  snapshot.rows_returned = metrics.rows_returned.load(std::memory_order_relaxed);
+  snapshot.allocations = metrics.allocations.load(std::memory_order_relaxed);
+  snapshot.allocated_bytes = metrics.allocated_bytes.load(std::memory_order_relaxed);
+  snapshot.parse_errors = metrics.parse_errors.load(std::memory_order_relaxed);
+  return snapshot;
+}
+
+void MetricsSnapshot::writePrometheus(std::ostream& stream) const {
+  auto seconds = [](uint64_t nanoseconds) { return nanoseconds / 1e9; };
+  stream << std::setprecision(9);
+
+  stream << "# HELP csql_latency_seconds Latency of the phases of a statement.\n"
+         << "# TYPE csql_latency_seconds summary\n";
+  for (const auto& latency : latencies) {
+    std::string labels = std::string("phase=\"") + phaseName(latency.phase) +
+                         "\",statement=\"" + statementName(latency.type) + "\"";
+    const std::pair<const char*, uint64_t> quantiles[] = {
+        {"0.5", latency.p50_ns},
+        {"0.9", latency.p90_ns},
+        {"0.99", latency.p99_ns},
+        {"0.999", latency.p999_ns},
+    };
+    for (const auto& [quantile, value] : quantiles) {
+      stream << "csql_latency_seconds{" << labels << ",quantile=\"" << quantile << "\"} "
+             << seconds(value) << "\n";
+    }
+    stream << "csql_latency_seconds_sum{" << labels << "} " << seconds(latency.sum_ns) << "\n";
+    stream << "csql_latency_seconds_count{" << labels << "} " << latency.count << "\n";
+  }
+  stream << "# HELP csql_latency_max_seconds Slowest phase of a statement so far.\n"
+         << "# TYPE csql_latency_max_seconds gauge\n";
+  for (const auto& latency : latencies) {
+    stream << "csql_latency_max_seconds{phase=\"" << phaseName(latency.phase) << "\",statement=\""
+           << statementName(latency.type) << "\"} " << seconds(latency.max_ns) << "\n";
+  }
+
+  auto counter = [&](const char* name, const char* help, uint64_t value) {
+    stream << "# HELP " << name << " " << help << "\n"
+           << "# TYPE " << name << " counter\n"
+           << name << " " << value << "\n";
+  };
+  counter("csql_rows_returned_total", "Rows handed to the caller.", rows_returned);
+  counter("csql_allocations_total", "Allocations made by the engine.", allocations);
+  counter("csql_allocated_bytes_total", "Bytes allocated by the engine.", allocated_bytes);
+  counter("csql_parse_errors_total", "Statements that failed to parse.", parse_errors);
+  auto gauge = [&](const char* name, const char* help, uint64_t value) {
+    stream << "# HELP " << name << " " << help << "\n"
+           << "# TYPE " << name << " gauge\n"
+           << name << " " << value << "\n";
+  };
+  gauge("csql_memory_bytes", "Bytes held by the tables and running queries.", memory_bytes);
+  gauge("csql_memory_peak_bytes", "Highest csql_memory_bytes so far.", memory_peak_bytes);
+
+  auto perTable = [&](const char* name, const char* type, const char* help, auto value) {
+    stream << "# HELP " << name << " " << help << "\n"
+           << "# TYPE " << name << " " << type << "\n";
+    for (const auto& table : tables) {
+      stream << name << "{table=\"" << labelValue(table.name) << "\"} " << value(table) << "\n";
+    }
+  };
+  perTable("csql_rows_scanned_total", "counter", "Rows read from the storage of a table.",
+           [](const Table& table) { return table.rows_scanned; });
+  perTable("csql_unique_probes_total", "counter",
+           "Lookups made to check UNIQUE and KEY columns on insert.",
+           [](const Table& table) { return table.unique_probes; });
+  perTable("csql_table_rows", "gauge", "Rows stored in a table.",
+           [](const Table& table) { return table.rows; });
+  perTable("csql_table_memory_bytes", "gauge", "Bytes held by the rows of a table.",
+           [](const Table& table) { return table.memory_bytes; });
+}
+
+}  // namespace storage
+}  // namespace csql
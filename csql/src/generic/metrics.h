@@ -0,0 +1,155 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "sql/statements/statement.h"
+#include "table.h"
+
+namespace csql {
+namespace storage {
+
+enum class MetricsPhase {
+  kParse,
+  kPlan,
+  kExecute,  // until the last row is read or the rows are released, for a query
+};
+
+// Latency histogram in the manner of HdrHistogram: a value is bucketed by its power of two
+// and, within it, linearly into kSubBuckets, so that a bucket is never wider than
+// 1/kSubBuckets of the values it holds. Recording is a few relaxed atomic increments.
+class LatencyHistogram {
+ public:
+  static constexpr size_t kSubBucketBits = 5;
+  static constexpr size_t kSubBuckets = size_t{1} << kSubBucketBits;
+  static constexpr size_t kMaxBits = 40;  // ~18 minutes in nanoseconds, longer ones are clamped
+  static constexpr size_t kBuckets = (kMaxBits - kSubBucketBits + 1) * kSubBuckets;
+
+  void record(uint64_t nanoseconds);
+
+  uint64_t count() const;
+  uint64_t sum() const;
+  uint64_t max() const;
+  // Highest value of the bucket holding the given fraction of the values, 0 when empty.
+  uint64_t percentile(double fraction) const;
+
+ private:
+  static size_t bucket(uint64_t value);
+  static uint64_t highest(size_t bucket);
+
+  std::array<std::atomic<uint64_t>, kBuckets> counts_{};
+  std::atomic<uint64_t> count_{0};
+  std::atomic<uint64_t> sum_{0};
+  std::atomic<uint64_t> max_{0};
+};
+
+// Counters of a Database, kept up to date while statements run.
+class Metrics {
+ public:
+  static constexpr size_t kStatementTypes = kStmtExplain + 1;
+  static constexpr size_t kPhases = 3;
+
+  LatencyHistogram& latency(MetricsPhase phase, StatementType type);
+  const LatencyHistogram& latency(MetricsPhase phase, StatementType type) const;
+
+  std::atomic<uint64_t> rows_returned{0};
+  std::atomic<uint64_t> allocations{0};  // made by the engine, see threadAllocations()
+  std::atomic<uint64_t> allocated_bytes{0};
+  std::atomic<uint64_t> parse_errors{0};
+
+ private:
+  std::array<LatencyHistogram, kPhases * kStatementTypes> latencies_;
+};
+
+// Measures a phase from construction to stop(): its latency and the allocations made
+// meanwhile by the thread.
+class PhaseTimer {
+ public:
+  PhaseTimer(std::shared_ptr<Metrics> metrics, MetricsPhase phase);
+  void stop(StatementType type);
+  // For a query, whose phase goes on while `rows` are read: the latency is recorded by the
+  // MeteredIterator returned, which then calls `done` with the number of rows.
+  std::shared_ptr<TableIterator> stop(StatementType type, std::shared_ptr<TableIterator> rows,
+                                      std::function<void(uint64_t rows)> done = nullptr);
+
+ private:
+  std::shared_ptr<Metrics> metrics_;
+  MetricsPhase phase_;
+  uint64_t start_;
+  size_t allocations_;
+  size_t bytes_;
+};
+
+// Rows of a query handed to the caller: counts them, and the allocations made while
+// producing them, and records the execute latency once the last one is read or the iterator
+// is released.
+class MeteredIterator : public TableIterator {
+ public:
+  MeteredIterator(std::shared_ptr<TableIterator> it, std::shared_ptr<Metrics> metrics,
+                  StatementType type, uint64_t start,
+                  std::function<void(uint64_t rows)> done = nullptr);
+  virtual ~MeteredIterator();
+
+  bool hasValue() const override;
+  MeteredIterator& operator++() override;
+  std::shared_ptr<Row> operator*() override;
+  std::shared_ptr<Iterator> getMemoryIterator() override;
+
+ private:
+  void finish();
+
+  std::shared_ptr<TableIterator> it_;
+  std::shared_ptr<Metrics> metrics_;
+  StatementType type_;
+  uint64_t start_;
+  std::function<void(uint64_t rows)> done_;
+  uint64_t rows_ = 0;
+  bool finished_ = false;
+};
+
+// Point-in-time copy of the metrics of a Database.
+struct MetricsSnapshot {
+  struct Latency {
+    MetricsPhase phase;
+    StatementType type;
+    uint64_t count;
+    uint64_t sum_ns;
+    uint64_t max_ns;
+    uint64_t p50_ns;
+    uint64_t p90_ns;
+    uint64_t p99_ns;
+    uint64_t p999_ns;
+  };
+  struct Table {
+    std::string name;
+    size_t rows;
+    uint64_t rows_scanned;
+    uint64_t unique_probes;
+    size_t memory_bytes;
+  };
+
+  std::vector<Latency> latencies;  // the phases and statement types seen so far
+  std::vector<Table> tables;
+  uint64_t rows_scanned = 0;  // over all tables
+  uint64_t rows_returned = 0;
+  uint64_t unique_probes = 0;
+  uint64_t allocations = 0;
+  uint64_t allocated_bytes = 0;
+  uint64_t parse_errors = 0;
+  size_t memory_bytes = 0;  // held by the tables and running queries, see MemoryTracker
+  size_t memory_peak_bytes = 0;
+
+  static MetricsSnapshot of(const Metrics& metrics);
+  // Prometheus text exposition format, latencies as summaries in seconds.
+  void writePrometheus(std::ostream& stream) const;
+};
+
+}  // namespace storage
+}  // namespace csql
@@ -0,0 +1,111 @@
+#include "plan_cache.h"
+
+#include <memory>
+#include <string>
+
+#include "sql/tokenizer.h"
+
+namespace {
+using namespace csql;
+
+// Appends the tokens of `sql` to `text`, separated by a space, every literal and placeholder
+// as ?. With `literals` the literals are collected too, and a placeholder, an invalid token or
+// a second statement make it fail.
+bool appendTokens(const std::string& sql, std::string& text,
+                  std::vector<std::shared_ptr<Expr>>* literals) {
+  SQLTokenizer tokenizer(sql);
+  while (tokenizer.hasNext()) {
+    Token token = tokenizer.nextToken();
+    switch (token.type) {
+      case TokenType::INTEGER:
+      case TokenType::STRING:
+      case TokenType::HEX:
+        if (literals) {
+          auto literal = Expr::makeLiteral(std::string(token.value));
+          if (!literal) return false;
+          literals->push_back(literal);
+        }
+        text += '?';
+        break;
+      case TokenType::PARAMETER:  // has to be bound by the caller, see PreparedStatement
+        if (literals) return false;
+        text += '?';
+        break;
+      case TokenType::NONE:
+        if (literals) return false;
+        text += token.value;
+        break;
+      case TokenType::TERMINAL:
+        if (literals && tokenizer.hasNext()) return false;  // more than one statement
+        text += token.value;
+        break;
+      default:
+        text += token.value;
+    }
+    text += ' ';
+  }
+  return true;
+}
+
+}  // namespace
+
+namespace csql {
+namespace storage {
+
+PlanCache::PlanCache(size_t capacity) : capacity_(capacity) {}
+
+std::string PlanCache::normalize(const std::string& sql) {
+  std::string text;
+  appendTokens(sql, text, nullptr);
+  return text;
+}
+
+bool PlanCache::normalize(const std::string& sql, std::string& key,
+                          std::vector<std::shared_ptr<Expr>>& literals) {
+  Token token = SQLTokenizer(sql).get();
+  if (token.value != "SELECT" && token.value != "INSERT" && token.value != "DELETE") {
+    return false;  // CREATE takes literals where the parser does not accept ?
+  }
+  key.clear();
+  literals.clear();
+  return appendTokens(sql, key, &literals);
+}
+
+std::shared_ptr<CachedPlan> PlanCache::acquire(const std::string& key) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = index_.find(key);
+  if (it == index_.end()) {
+    return nullptr;
+  }
+  auto entry = *it->second;
+  entries_.erase(it->second);
+  index_.erase(it);
+  return entry;
+}
+
+void PlanCache::release(std::shared_ptr<CachedPlan> entry) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (capacity_ == 0 || index_.count(entry->key) > 0) {
+    return;  // an equal entry was cached while this one was in use
+  }
+  entries_.push_front(entry);
+  index_[entry->key] = entries_.begin();
+  if (entries_.size() > capacity_) {
+    index_.erase(entries_.back()->key);
+    entries_.pop_back();
+  }
+}
+
+size_t PlanCache::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return entries_.size();
+}
+
+void PlanCache::clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  entries_.clear();
+  index_.clear();
+}
+
+}  // namespace storage
+}  // namespace csql
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "generic/planning/planning.h"
+#include "sql/expr.h"
+#include "sql/statements/statement.h"
+
+namespace csql {
+namespace storage {
+
+class StorageTable;
+
+// Parsed statement and plan of a normalized statement, its literals turned into parameters,
+// or of a prepared one.
+struct CachedPlan {
+  struct TableVersion {
+    std::string name;
+    std::weak_ptr<StorageTable> table;  // a table created under the same name is another one
+    size_t statsVersion;
+  };
+
+  std::string key;
+  std::shared_ptr<SQLStatement> statement;
+  std::shared_ptr<QueryPlan> plan;  // nullptr for INSERT and DELETE
+  std::vector<std::shared_ptr<Expr>> parameters;
+  std::vector<TableVersion> tables;  // tables the plan was built against
+};
+
+// Bounded LRU of CachedPlan by normalized statement text. An entry is taken out while its
+// parameters are bound to the literals of one execution and put back by release(), so that
+// a statement still being iterated never sees the values of another one. Safe to share
+// between threads.
+class PlanCache {
+ public:
+  PlanCache(size_t capacity = 256);
+  virtual ~PlanCache() = default;
+
+  // `sql` with every literal and placeholder replaced by ?, tokens separated by a space: the
+  // text statements are cached and counted under, see StatementStatistics.
+  static std::string normalize(const std::string& sql);
+  // Splits a single SELECT, INSERT or DELETE into normalize(sql) and the literals themselves.
+  // Returns false for statements that are not cached, placeholders included.
+  static bool normalize(const std::string& sql, std::string& key,
+                        std::vector<std::shared_ptr<Expr>>& literals);
+
+  std::shared_ptr<CachedPlan> acquire(const std::string& key);
+  void release(std::shared_ptr<CachedPlan> entry);
+
+  size_t size() const;
+  void clear();
+
+ private:
+  size_t capacity_;
+  mutable std::mutex mutex_;
+  std::list<std::shared_ptr<CachedPlan>> entries_;  // most recently used first
+  std::unordered_map<std::string, std::list<std::shared_ptr<CachedPlan>>::iterator> index_;
+};
+
+}  // namespace storage
+}  // namespace csql
@@ -0,0 +1,135 @@
+#include "common_subexpressions.h"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "memory/arena.h"
+#include "sql/statements/select.h"
+
+namespace {
+using namespace csql;
+
+bool readsSubquery(const Expr& expr) {
+  if (expr.type == kExprSelect || expr.type == kExprJoin) return true;
+  return (expr.expr && readsSubquery(*expr.expr)) || (expr.expr2 && readsSubquery(*expr.expr2));
+}
+
+void combine(size_t& seed, size_t value) {
+  seed ^= value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2);
+}
+
+}  // namespace
+
+namespace csql {
+namespace storage {
+
+size_t CommonSubexpressions::Hash::operator()(const Expr* expr) const {
+  size_t seed = std::hash<int>()(expr->type);
+  combine(seed, std::hash<int>()(expr->opType));
+  combine(seed, std::hash<int32_t>()(expr->ival));
+  combine(seed, std::hash<std::string>()(expr->name));
+  combine(seed, std::hash<std::string>()(expr->table));
+  if (expr->expr) combine(seed, (*this)(expr->expr.get()));
+  if (expr->expr2) combine(seed, (*this)(expr->expr2.get()));
+  return seed;
+}
+
+bool CommonSubexpressions::Equal::operator()(const Expr* lhs, const Expr* rhs) const {
+  if (lhs == rhs) return true;
+  if (!lhs || !rhs || lhs->type != rhs->type || lhs->opType != rhs->opType ||
+      lhs->ival != rhs->ival || lhs->name != rhs->name || lhs->table != rhs->table) {
+    return false;
+  }
+  if (lhs->type == kExprSelect || lhs->type == kExprJoin) return false;
+  return (*this)(lhs->expr.get(), rhs->expr.get()) && (*this)(lhs->expr2.get(), rhs->expr2.get());
+}
+
+void CommonSubexpressions::share(const std::shared_ptr<QueryPlan>& plan) {
+  if (!plan) return;
+  if (plan->type_ == QueryType::kStepEval) {
+    auto select = makeNode<SelectStatement>(*plan->query_->select);
+    select->selectList = makeNode<std::vector<std::shared_ptr<Expr>>>(*select->selectList);
+    std::vector<std::shared_ptr<Expr>*> roots;
+    for (auto& expr : *select->selectList) {
+      roots.push_back(&expr);
+    }
+    auto below = plan->left_;
+    if (below && below->type_ == QueryType::kStepFilter && below->query_) {
+      roots.push_back(&below->query_);
+      below = below->left_;
+    }
+    if (shareAmong(roots)) {
+      plan->query_ = Expr::makeSelect(select);
+    }
+    share(below);
+    return;
+  }
+  if (plan->type_ == QueryType::kStepFilter && plan->query_) {
+    shareAmong({&plan->query_});
+  }
+  share(plan->left_);
+  share(plan->right_);
+}
+
+bool CommonSubexpressions::shareAmong(const std::vector<std::shared_ptr<Expr>*>& roots) {
+  Counts counts;
+  for (const auto* root : roots) {
+    count(**root, counts);
+  }
+  Counts slots;
+  for (const auto* root : roots) {
+    number(**root, counts, slots);
+  }
+  if (slots.empty()) return false;
+  for (auto* root : roots) {
+    *root = mark(*root, slots);
+  }
+  return true;
+}
+
+bool CommonSubexpressions::isShareable(const Expr& expr) {
+  return expr.type == kExprOperator && expr.opType != kOpParenthesis &&
+         expr.opType != kOpExists && !readsSubquery(expr);
+}
+
+void CommonSubexpressions::count(const Expr& expr, Counts& counts) {
+  if (expr.type == kExprSelect || expr.type == kExprJoin) return;
+  if (isShareable(expr)) {
+    counts[&expr]++;
+  }
+  if (expr.expr) count(*expr.expr, counts);
+  if (expr.expr2) count(*expr.expr2, counts);
+}
+
+void CommonSubexpressions::number(const Expr& expr, const Counts& counts, Counts& slots) {
+  if (expr.type == kExprSelect || expr.type == kExprJoin) return;
+  if (isShareable(expr) && counts.at(&expr) > 1 && !slots.count(&expr)) {
+    int32_t slot = slots.size();
+    slots[&expr] = slot;
+  }
+  if (expr.expr) number(*expr.expr, counts, slots);
+  if (expr.expr2) number(*expr.expr2, counts, slots);
+}
+
+std::shared_ptr<Expr> CommonSubexpressions::mark(const std::shared_ptr<Expr>& expr,
+                                                 const Counts& slots) {
+  if (!expr || expr->type == kExprSelect || expr->type == kExprJoin) return expr;
+  auto left = mark(expr->expr, slots);
+  auto right = mark(expr->expr2, slots);
+  auto slot = isShareable(*expr) ? slots.find(expr.get()) : slots.end();
+  if (slot == slots.end() && left == expr->expr && right == expr->expr2) {
+    return expr;
+  }
+  auto marked = makeNode<Expr>(*expr);  // the statement may share the original
+  marked->expr = left;
+  marked->expr2 = right;
+  if (slot != slots.end()) {
+    marked->memoSlot = slot->second;
+  }
+  return marked;
+}
+
+}  // namespace storage
+}  // namespace csql
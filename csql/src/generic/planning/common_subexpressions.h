@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "planning.h"
+#include "sql/expr.h"
+
+namespace csql {
+namespace storage {
+
+// Finds the operators evaluated more than once per row and gives each of them a slot of the
+// row memo (Expr::memoSlot), so that Row::evaluate computes it once per row. A row is evaluated
+// by the select list of an Eval and by the filter right below it, which hands the same row
+// up; slots are numbered per such pair, or per filter on its own. Join conditions are left
+// alone: the merged rows they accept go on to the steps above, with slots of their own.
+class CommonSubexpressions {
+ public:
+  void share(const std::shared_ptr<QueryPlan>& plan);
+
+ private:
+  // Structural hash and equality of expressions, aliases aside.
+  struct Hash {
+    size_t operator()(const Expr* expr) const;
+  };
+  struct Equal {
+    bool operator()(const Expr* lhs, const Expr* rhs) const;
+  };
+  using Counts = std::unordered_map<const Expr*, int32_t, Hash, Equal>;
+
+  // Shares the operators repeated across `roots`, replacing the expressions they point to;
+  // false when there are none.
+  bool shareAmong(const std::vector<std::shared_ptr<Expr>*>& roots);
+  static bool isShareable(const Expr& expr);
+  static void count(const Expr& expr, Counts& counts);
+  // Assigns the slots in order of first occurrence.
+  static void number(const Expr& expr, const Counts& counts, Counts& slots);
+  // `expr` with the slots assigned, copied where it changes.
+  static std::shared_ptr<Expr> mark(const std::shared_ptr<Expr>& expr, const Counts& slots);
+};
+
+}  // namespace storage
+}  // namespace csql
@@ -0,0 +1,161 @@
+#include "expression_simplifier.h"
+
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "generic/row.h"
+#include "memory/arena.h"
+
+namespace {
+using namespace csql;
+
+bool isLiteralType(ExprType type) {
+  return type == kExprLiteralInt || type == kExprLiteralString || type == kExprLiteralBool ||
+         type == kExprLiteralBytes || type == kExprLiteralNull;
+}
+
+bool isBool(const std::shared_ptr<Expr>& expr, bool value) {
+  return expr && expr->type == kExprLiteralBool && static_cast<bool>(expr->ival) == value;
+}
+
+// `result` standing for `original`, which may name a select list entry.
+std::shared_ptr<Expr> withAlias(std::shared_ptr<Expr> result,
+                                const std::shared_ptr<Expr>& original) {
+  if (result == original || original->alias.empty() || result->alias == original->alias) {
+    return result;
+  }
+  auto copy = storage::makeNode<Expr>(*result);
+  copy->alias = original->alias;
+  return copy;
+}
+
+}  // namespace
+
+namespace csql {
+namespace storage {
+
+ExpressionSimplifier::ExpressionSimplifier(bool bindParameters)
+    : bindParameters_(bindParameters) {}
+
+OperatorType ExpressionSimplifier::mirrored(OperatorType op) {
+  switch (op) {
+    case kOpLess:
+      return kOpGreater;
+    case kOpLessEq:
+      return kOpGreaterEq;
+    case kOpGreater:
+      return kOpLess;
+    case kOpGreaterEq:
+      return kOpLessEq;
+    default:
+      return op;
+  }
+}
+
+std::shared_ptr<std::vector<std::shared_ptr<Expr>>> ExpressionSimplifier::simplify(
+    std::shared_ptr<std::vector<std::shared_ptr<Expr>>> list) const {
+  if (!list) return list;
+  std::shared_ptr<std::vector<std::shared_ptr<Expr>>> result;
+  for (size_t i = 0; i < list->size(); i++) {
+    auto simplified = simplify((*list)[i]);
+    if (simplified != (*list)[i] && !result) {
+      result = makeNode<std::vector<std::shared_ptr<Expr>>>(*list);
+    }
+    if (result) (*result)[i] = simplified;
+  }
+  return result ? result : list;
+}
+
+std::shared_ptr<Expr> ExpressionSimplifier::simplify(std::shared_ptr<Expr> expr) const {
+  if (!expr) return expr;
+  if (expr->type == kExprParameter) {
+    auto value = constant(expr);
+    return value ? withAlias(value, expr) : expr;
+  }
+  if (expr->type != kExprOperator) return expr;
+  if (expr->opType == kOpParenthesis) {  // the tree already holds the grouping
+    return withAlias(simplify(expr->expr), expr);
+  }
+  auto left = simplify(expr->expr);
+  auto right = simplify(expr->expr2);
+  auto result = expr;
+  if (left != expr->expr || right != expr->expr2) {
+    result = makeNode<Expr>(*expr);
+    result->expr = left;
+    result->expr2 = right;
+  }
+  return withAlias(reduce(result), expr);
+}
+
+std::shared_ptr<Expr> ExpressionSimplifier::constant(const std::shared_ptr<Expr>& expr) const {
+  if (!expr) return nullptr;
+  if (isLiteralType(expr->type)) return expr;
+  if (bindParameters_ && expr->type == kExprParameter && expr->expr) return expr->expr;
+  return nullptr;
+}
+
+std::shared_ptr<Expr> ExpressionSimplifier::reduce(const std::shared_ptr<Expr>& expr) const {
+  auto left = constant(expr->expr);
+  auto right = constant(expr->expr2);
+  try {
+    if (isUnaryOperator(expr->opType) && left && expr->opType != kOpExists) {
+      return applyUnaryOpToLiteral(expr->opType, left);
+    }
+    if (isBinaryOperator(expr->opType) && left && right) {
+      bool divides = expr->opType == kOpSlash || expr->opType == kOpPercentage;
+      if (divides && right->type == kExprLiteralInt && (right->ival == 0 || right->ival == -1)) {
+        return expr;  // may raise, left for the rows to do so
+      }
+      return applyBinaryOpToLiterals(left, expr->opType, right);
+    }
+  } catch (const std::runtime_error&) {
+    return expr;  // raised when a row evaluates it, as before
+  }
+
+  switch (expr->opType) {
+    case kOpNot:
+      if (expr->expr->type == kExprOperator && expr->expr->opType == kOpNot &&
+          expr->expr->expr->isBoolean()) {
+        return expr->expr->expr;
+      }
+      break;
+    case kOpAnd:
+      // Both sides are evaluated and anything but two booleans gives false.
+      if (isBool(left, false) || isBool(right, false)) return Expr::makeLiteral(false);
+      if (isBool(left, true) && expr->expr2->isBoolean()) return expr->expr2;
+      if (isBool(right, true) && expr->expr->isBoolean()) return expr->expr;
+      break;
+    case kOpOr:
+      if ((isBool(left, true) && expr->expr2->isBoolean()) ||
+          (isBool(right, true) && expr->expr->isBoolean())) {
+        return Expr::makeLiteral(true);
+      }
+      if (isBool(left, false) && expr->expr2->isBoolean()) return expr->expr2;
+      if (isBool(right, false) && expr->expr->isBoolean()) return expr->expr;
+      break;
+    case kOpEquals:
+    case kOpNotEquals:
+    case kOpLess:
+    case kOpLessEq:
+    case kOpGreater:
+    case kOpGreaterEq: {
+      auto isValue = [](const Expr& side) {
+        return isLiteralType(side.type) || side.type == kExprParameter;
+      };
+      if (isValue(*expr->expr) && !isValue(*expr->expr2)) {
+        auto swapped = makeNode<Expr>(*expr);
+        swapped->opType = mirrored(expr->opType);
+        swapped->expr = expr->expr2;
+        swapped->expr2 = expr->expr;
+        return swapped;
+      }
+    } break;
+    default:
+      break;
+  }
+  return expr;
+}
+
+}  // namespace storage
+}  // namespace csql
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "sql/expr.h"
+
+namespace csql {
+namespace storage {
+
+// Rewrites an expression into a cheaper one that evaluates the same for every row: folds
+// operators over constants, drops parentheses, applies the boolean identities that hold for
+// Row::evaluate, and turns `constant op column` into `column op' constant`.
+class ExpressionSimplifier {
+ public:
+  // With `bindParameters` bound parameters count as the constants they hold, for expressions
+  // evaluated once with them. A plan that is cached has to keep them.
+  ExpressionSimplifier(bool bindParameters = false);
+
+  // `expr` itself when nothing could be simplified.
+  std::shared_ptr<Expr> simplify(std::shared_ptr<Expr> expr) const;
+  std::shared_ptr<std::vector<std::shared_ptr<Expr>>> simplify(
+      std::shared_ptr<std::vector<std::shared_ptr<Expr>>> list) const;
+
+  // `value op column` is `column mirrored(op) value`.
+  static OperatorType mirrored(OperatorType op);
+
+ private:
+  // Value of a literal, or of a bound parameter with bindParameters; nullptr otherwise.
+  std::shared_ptr<Expr> constant(const std::shared_ptr<Expr>& expr) const;
+  // `expr` has simplified operands, folds it or applies an identity.
+  std::shared_ptr<Expr> reduce(const std::shared_ptr<Expr>& expr) const;
+
+  bool bindParameters_;
+};
+
+}  // namespace storage
+}  // namespace csql
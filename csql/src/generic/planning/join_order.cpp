@@ -0,0 +1,258 @@
+#include "join_order.h"
+
+#include <bit>
+#include <memory>
+#include <unordered_set>
+#include <vector>
+
+#include "generic/database.h"
+#include "generic/trace.h"
+#include "memory/arena.h"
+
+namespace {
+using namespace csql;
+
+void splitConjuncts(std::shared_ptr<Expr> expr, std::vector<std::shared_ptr<Expr>>& conjuncts) {
+  if (!expr) return;
+  if (expr->type == kExprOperator && expr->opType == kOpAnd) {
+    splitConjuncts(expr->expr, conjuncts);
+    splitConjuncts(expr->expr2, conjuncts);
+  } else if (expr->type == kExprOperator && expr->opType == kOpParenthesis) {
+    splitConjuncts(expr->expr, conjuncts);
+  } else {
+    conjuncts.push_back(expr);
+  }
+}
+
+bool isColumnEquality(const std::shared_ptr<Expr>& expr) {
+  return expr->type == kExprOperator && expr->opType == kOpEquals &&
+         expr->expr->type == kExprColumnRef && expr->expr2->type == kExprColumnRef;
+}
+
+}  // namespace
+
+namespace csql {
+namespace storage {
+
+bool relationsOf(std::shared_ptr<Expr> expr,
+                 const std::vector<std::shared_ptr<StorageTable>>& tables, uint64_t& relations) {
+  if (!expr) return true;
+  if (expr->type == kExprColumnRef) {
+    uint64_t found = 0;
+    size_t matches = 0;
+    for (size_t i = 0; i < tables.size(); i++) {
+      if (!expr->table.empty() && tables[i]->getName() == expr->table) {
+        found = uint64_t(1) << i;
+        matches = 1;
+        break;
+      }
+      for (const auto& column : tables[i]->getColumns()) {
+        if (column->getName() == expr->name) {
+          found |= uint64_t(1) << i;
+          matches++;
+          break;
+        }
+      }
+    }
+    if (matches != 1) {
+      return false;  // unknown or ambiguous, its meaning may depend on the order
+    }
+    relations |= found;
+    return true;
+  }
+  if (expr->type == kExprSelect || expr->type == kExprJoin) {
+    return false;
+  }
+  if (expr->type == kExprOperator) {
+    return relationsOf(expr->expr, tables, relations) &&
+           relationsOf(expr->expr2, tables, relations);
+  }
+  return true;
+}
+
+JoinOrder::JoinOrder(std::shared_ptr<Database> db) : db_(db) {}
+
+std::shared_ptr<QueryPlan> JoinOrder::reorder(std::shared_ptr<QueryPlan> join) {
+  std::vector<std::shared_ptr<Expr>> conditions;
+  flatten(join, conditions);
+
+  bool reorderable = relations_.size() <= 64;
+  std::unordered_set<std::string> names;
+  for (const auto& relation : relations_) {
+    std::shared_ptr<StorageTable> table;
+    if (auto ref = tableRef(relation)) {
+      table = std::dynamic_pointer_cast<StorageTable>(db_->getTable(ref));
+    }
+    // Without aliases a table joined twice can not be told apart
+    if (!table || !names.insert(table->getName()).second) {
+      reorderable = false;
+    }
+    tables_.push_back(table);
+  }
+
+  if (reorderable) {
+    uint64_t all = relations_.size() == 64 ? ~uint64_t(0) : (uint64_t(1) << relations_.size()) - 1;
+    std::vector<std::shared_ptr<Expr>> parts;
+    for (const auto& condition : conditions) {
+      splitConjuncts(condition, parts);
+    }
+    for (const auto& part : parts) {
+      uint64_t relations = 0;
+      if (!relationsOf(part, tables_, relations)) {
+        reorderable = false;
+        break;
+      }
+      conjuncts_.push_back(Conjunct{part, relations ? relations : all});  // constants go on top
+    }
+  }
+
+  if (!reorderable) {
+    CSQL_TRACE(TraceLevel::kTrace, "Join order kept over " << relations_.size() << " relations");
+    size_t next = 0;
+    return withStrategy(join, next);
+  }
+  if (relations_.size() <= kMaxExhaustiveRelations) {
+    CSQL_TRACE(TraceLevel::kTrace,
+               "Join order searched over " << relations_.size() << " relations");
+    return exhaustive();
+  }
+  CSQL_TRACE(TraceLevel::kTrace,
+             "Join order built greedily over " << relations_.size() << " relations");
+  return greedy();
+}
+
+void JoinOrder::flatten(std::shared_ptr<QueryPlan> plan,
+                        std::vector<std::shared_ptr<Expr>>& conditions) {
+  if ((plan->type_ == QueryType::kStepJoin || plan->type_ == QueryType::kStepHashJoin) &&
+      plan->query_->opType == kOpInnerJoin) {
+    flatten(plan->left_, conditions);
+    flatten(plan->right_, conditions);
+    conditions.push_back(plan->query_->on);
+  } else {
+    relations_.push_back(plan->restructure());
+  }
+}
+
+std::shared_ptr<Expr> JoinOrder::tableRef(const std::shared_ptr<QueryPlan>& relation) const {
+  auto plan = relation;
+  if (plan->type_ == QueryType::kStepFilter && plan->left_) {
+    plan = plan->left_;
+  }
+  if ((plan->type_ == QueryType::kStepFullScan || plan->type_ == QueryType::kStepRangeScan) &&
+      plan->left_) {
+    plan = plan->left_;
+  }
+  return plan->type_ == QueryType::kStepProject ? plan->query_ : nullptr;
+}
+
+std::shared_ptr<Expr> JoinOrder::sourceOf(const std::shared_ptr<QueryPlan>& relation) const {
+  auto ref = tableRef(relation);
+  return ref ? ref : relation->query_;
+}
+
+std::shared_ptr<QueryPlan> JoinOrder::join(std::shared_ptr<QueryPlan> left,
+                                           uint64_t leftRelations,
+                                           std::shared_ptr<QueryPlan> right,
+                                           uint64_t rightRelations) {
+  std::shared_ptr<Expr> on;
+  bool equality = false;
+  uint64_t both = leftRelations | rightRelations;
+  for (const auto& conjunct : conjuncts_) {
+    if ((conjunct.relations & ~both) != 0) continue;  // needs a table joined later
+    if ((conjunct.relations & ~leftRelations) == 0 && std::popcount(leftRelations) > 1) continue;
+    if ((conjunct.relations & ~rightRelations) == 0 && std::popcount(rightRelations) > 1) continue;
+    on = on ? Expr::makeOpBinary(on, kOpAnd, conjunct.expr) : conjunct.expr;
+
+    if (!equality && isColumnEquality(conjunct.expr)) {
+      uint64_t first = 0, second = 0;
+      relationsOf(conjunct.expr->expr, tables_, first);
+      relationsOf(conjunct.expr->expr2, tables_, second);
+      equality = ((first & ~leftRelations) == 0 && (second & ~rightRelations) == 0) ||
+                 ((first & ~rightRelations) == 0 && (second & ~leftRelations) == 0);
+    }
+  }
+  if (!on) {
+    on = Expr::makeLiteral(true);
+  }
+
+  auto plan = makeNode<QueryPlan>(equality ? QueryType::kStepHashJoin : QueryType::kStepJoin,
+                                  Expr::makeJoin(sourceOf(left), sourceOf(right), on, kOpInnerJoin),
+                                  db_);
+  plan->left_ = left;
+  plan->right_ = right;
+  plan->buildLeft_ = left->getCost().amount < right->getCost().amount;
+  plan->calculateCost();
+  return plan;
+}
+
+std::shared_ptr<QueryPlan> JoinOrder::exhaustive() {
+  std::vector<std::shared_ptr<QueryPlan>> best(size_t(1) << relations_.size());
+  for (size_t i = 0; i < relations_.size(); i++) {
+    best[size_t(1) << i] = relations_[i];
+  }
+  for (uint64_t set = 1; set < best.size(); set++) {
+    if (std::popcount(set) < 2) continue;
+    // Submasks in increasing order, so ties keep the written order
+    for (uint64_t left = (0 - set) & set; left != set; left = (left - set) & set) {
+      uint64_t right = set ^ left;
+      auto candidate = join(best[left], left, best[right], right);
+      if (!best[set] || candidate->getCost().total_steps < best[set]->getCost().total_steps) {
+        best[set] = candidate;
+      }
+    }
+  }
+  return best.back();
+}
+
+std::shared_ptr<QueryPlan> JoinOrder::greedy() {
+  std::vector<std::pair<std::shared_ptr<QueryPlan>, uint64_t>> trees;
+  for (size_t i = 0; i < relations_.size(); i++) {
+    trees.emplace_back(relations_[i], uint64_t(1) << i);
+  }
+  while (trees.size() > 1) {
+    std::shared_ptr<QueryPlan> best;
+    size_t bestLeft = 0, bestRight = 0;
+    for (size_t i = 0; i < trees.size(); i++) {
+      for (size_t j = 0; j < trees.size(); j++) {
+        if (i == j) continue;
+        auto candidate = join(trees[i].first, trees[i].second, trees[j].first, trees[j].second);
+        if (!best || candidate->getCost().total_steps < best->getCost().total_steps) {
+          best = candidate;
+          bestLeft = i;
+          bestRight = j;
+        }
+      }
+    }
+    trees[std::min(bestLeft, bestRight)] = {best, trees[bestLeft].second | trees[bestRight].second};
+    trees.erase(trees.begin() + std::max(bestLeft, bestRight));
+  }
+  return trees.front().first;
+}
+
+std::shared_ptr<QueryPlan> JoinOrder::withStrategy(std::shared_ptr<QueryPlan> plan,
+                                                   size_t& next) {
+  if ((plan->type_ != QueryType::kStepJoin && plan->type_ != QueryType::kStepHashJoin) ||
+      plan->query_->opType != kOpInnerJoin) {
+    return relations_[next++];
+  }
+  auto left = withStrategy(plan->left_, next);
+  auto right = withStrategy(plan->right_, next);
+
+  std::vector<std::shared_ptr<Expr>> conjuncts;
+  splitConjuncts(plan->query_->on, conjuncts);
+  bool equality = false;
+  for (const auto& conjunct : conjuncts) {
+    equality = equality || isColumnEquality(conjunct);
+  }
+
+  auto result = makeNode<QueryPlan>(equality ? QueryType::kStepHashJoin : QueryType::kStepJoin,
+                                    plan->query_, db_);
+  result->left_ = left;
+  result->right_ = right;
+  result->buildLeft_ = left->getCost().amount < right->getCost().amount;
+  result->calculateCost();
+  return result;
+}
+
+}  // namespace storage
+}  // namespace csql
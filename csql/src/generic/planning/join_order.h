@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "generic/table.h"
+#include "planning.h"
+#include "sql/expr.h"
+
+namespace csql {
+namespace storage {
+
+class Database;
+
+// Sets bit i of `relations` for every table of `tables` read by `expr`; false when one of its
+// columns can not be attributed to exactly one of them.
+bool relationsOf(std::shared_ptr<Expr> expr,
+                 const std::vector<std::shared_ptr<StorageTable>>& tables, uint64_t& relations);
+
+// Picks the order of a tree of inner joins over stored tables. The ON conditions are split
+// into conjuncts and each one is placed on the lowest join that sees all of its tables.
+// Orders are searched by dynamic programming over table subsets for up to
+// kMaxExhaustiveRelations tables, and greedily by cheapest next pair above that. Every join
+// becomes a hash join when it has an equality between its sides, hashing the smaller one.
+class JoinOrder {
+ public:
+  static constexpr size_t kMaxExhaustiveRelations = 8;
+
+  JoinOrder(std::shared_ptr<Database> db);
+
+  // Best plan for the join tree rooted at `join`. Trees with other sources (subqueries,
+  // outer joins) keep their order and only get a strategy.
+  std::shared_ptr<QueryPlan> reorder(std::shared_ptr<QueryPlan> join);
+
+ private:
+  struct Conjunct {
+    std::shared_ptr<Expr> expr;
+    uint64_t relations;  // bit per relation the conjunct reads
+  };
+
+  void flatten(std::shared_ptr<QueryPlan> plan, std::vector<std::shared_ptr<Expr>>& conditions);
+  // Table read by a relation, possibly through a filter and its scan; nullptr otherwise.
+  std::shared_ptr<Expr> tableRef(const std::shared_ptr<QueryPlan>& relation) const;
+  // Expression of a relation in a join: its table, or the join or subquery it stands for.
+  std::shared_ptr<Expr> sourceOf(const std::shared_ptr<QueryPlan>& relation) const;
+
+  std::shared_ptr<QueryPlan> join(std::shared_ptr<QueryPlan> left, uint64_t leftRelations,
+                                  std::shared_ptr<QueryPlan> right, uint64_t rightRelations);
+  std::shared_ptr<QueryPlan> exhaustive();
+  std::shared_ptr<QueryPlan> greedy();
+  // Keeps the written order and only chooses the strategy of every inner join.
+  std::shared_ptr<QueryPlan> withStrategy(std::shared_ptr<QueryPlan> plan, size_t& next);
+
+  std::shared_ptr<Database> db_;
+  std::vector<std::shared_ptr<QueryPlan>> relations_;
+  std::vector<std::shared_ptr<StorageTable>> tables_;  // table of every relation
+  std::vector<Conjunct> conjuncts_;
+};
+
+}  // namespace storage
+}  // namespace csql
@@ -0,0 +1,170 @@
+#include "plan_rewriter.h"
+
+#include <memory>
+#include <vector>
+
+#include "memory/arena.h"
+#include "sql/statements/select.h"
+
+namespace {
+using namespace csql;
+
+// Whether `expr` is true whatever the row, without evaluating anything but literals. Bound
+// parameters do not count: a cached plan is executed again with other values. OR gives false
+// when its other side is not a boolean, as Row::evaluate does.
+bool isTrue(const std::shared_ptr<Expr>& expr) {
+  if (!expr) return false;
+  if (expr->type == kExprLiteralBool) return expr->ival;
+  if (expr->type != kExprOperator) return false;
+  switch (expr->opType) {
+    case kOpParenthesis:
+      return isTrue(expr->expr);
+    case kOpAnd:
+      return isTrue(expr->expr) && isTrue(expr->expr2);
+    case kOpOr:
+      return (isTrue(expr->expr) && expr->expr2->isBoolean()) ||
+             (isTrue(expr->expr2) && expr->expr->isBoolean());
+    default:
+      return false;
+  }
+}
+
+bool isParenthesis(const std::shared_ptr<Expr>& expr) {
+  return expr && expr->type == kExprOperator && expr->opType == kOpParenthesis;
+}
+
+// `expr` with nested parentheses collapsed, `expr` itself when there are none.
+std::shared_ptr<Expr> collapsed(const std::shared_ptr<Expr>& expr) {
+  if (!expr || expr->type != kExprOperator) return expr;
+  if (isParenthesis(expr) && isParenthesis(expr->expr) && expr->alias.empty()) {
+    return collapsed(expr->expr);
+  }
+  auto left = collapsed(expr->expr);
+  auto right = collapsed(expr->expr2);
+  if (left == expr->expr && right == expr->expr2) return expr;
+  auto copy = storage::makeNode<Expr>(*expr);
+  copy->expr = left;
+  copy->expr2 = right;
+  return copy;
+}
+
+// A condition without the parentheses around all of it.
+std::shared_ptr<Expr> condition(const std::shared_ptr<Expr>& expr) {
+  auto result = collapsed(expr);
+  while (isParenthesis(result) && result->alias.empty()) {
+    result = result->expr;
+  }
+  return result;
+}
+
+}  // namespace
+
+namespace csql {
+namespace storage {
+
+PlanRewriter::PlanRewriter(std::vector<RewriteStep>* trace) : trace_(trace) {}
+
+const std::vector<PlanRewriter::NamedRule>& PlanRewriter::rules() {
+  static const std::vector<NamedRule> rules = {
+      {"drop full scan", &PlanRewriter::dropFullScan},
+      {"drop true filter", &PlanRewriter::dropTrueFilter},
+      {"drop SELECT * eval", &PlanRewriter::dropStarEval},
+      {"merge filters", &PlanRewriter::mergeFilters},
+      {"collapse parentheses", &PlanRewriter::collapseParentheses},
+  };
+  return rules;
+}
+
+std::shared_ptr<QueryPlan> PlanRewriter::rewrite(std::shared_ptr<QueryPlan> plan) {
+  root_ = plan;
+  for (size_t pass = 0; pass < kMaxPasses && rewriteStep(root_); pass++) {
+  }
+  recalculateCosts(*root_);
+  return std::move(root_);
+}
+
+bool PlanRewriter::rewriteStep(std::shared_ptr<QueryPlan>& slot) {
+  bool changed = false;
+  if (slot->left_) changed |= rewriteStep(slot->left_);
+  if (slot->right_) changed |= rewriteStep(slot->right_);
+  for (bool applied = true; applied;) {
+    applied = false;
+    for (const auto& rule : rules()) {
+      auto replacement = rule.apply(slot);
+      if (!replacement) continue;
+      std::string before = trace_ ? root_->toMermaid() : "";
+      slot = replacement;  // `slot` may be root_ itself
+      if (trace_) {
+        trace_->push_back(RewriteStep{rule.name, std::move(before), root_->toMermaid()});
+      }
+      applied = changed = true;
+    }
+  }
+  return changed;
+}
+
+void PlanRewriter::recalculateCosts(QueryPlan& plan) {
+  if (plan.left_) recalculateCosts(*plan.left_);
+  if (plan.right_) recalculateCosts(*plan.right_);
+  plan.calculateCost();
+}
+
+std::shared_ptr<QueryPlan> PlanRewriter::mergeFilters(const std::shared_ptr<QueryPlan>& plan) {
+  if (plan->type_ != QueryType::kStepFilter || !plan->left_ ||
+      plan->left_->type_ != QueryType::kStepFilter) {
+    return nullptr;
+  }
+  auto below = plan->left_;
+  auto merged = makeNode<QueryPlan>(QueryType::kStepFilter,
+                                    Expr::makeOpBinary(below->query_, kOpAnd, plan->query_),
+                                    plan->db_.lock());
+  merged->left_ = below->left_;
+  return merged;
+}
+
+std::shared_ptr<QueryPlan> PlanRewriter::dropFullScan(const std::shared_ptr<QueryPlan>& plan) {
+  if (plan->type_ != QueryType::kStepFullScan || !plan->left_) return nullptr;
+  return plan->left_;
+}
+
+std::shared_ptr<QueryPlan> PlanRewriter::dropTrueFilter(const std::shared_ptr<QueryPlan>& plan) {
+  if (plan->type_ != QueryType::kStepFilter || !plan->left_ || !isTrue(plan->query_)) {
+    return nullptr;
+  }
+  return plan->left_;
+}
+
+std::shared_ptr<QueryPlan> PlanRewriter::dropStarEval(const std::shared_ptr<QueryPlan>& plan) {
+  if (plan->type_ != QueryType::kStepEval || !plan->left_) return nullptr;
+  auto select = plan->query_->select;
+  const auto& list = *select->selectList;
+  if (select->selectDistinct || list.size() != 1 || list[0]->type != kExprStar ||
+      !list[0]->table.empty()) {
+    return nullptr;
+  }
+  return plan->left_;
+}
+
+std::shared_ptr<QueryPlan> PlanRewriter::collapseParentheses(
+    const std::shared_ptr<QueryPlan>& plan) {
+  if (plan->type_ == QueryType::kStepFilter && plan->query_) {
+    auto predicate = condition(plan->query_);
+    if (predicate == plan->query_) return nullptr;
+    auto copy = makeNode<QueryPlan>(*plan);
+    copy->query_ = predicate;
+    return copy;
+  }
+  if ((plan->type_ == QueryType::kStepJoin || plan->type_ == QueryType::kStepHashJoin) &&
+      plan->query_->on) {
+    auto query = plan->query_;
+    auto on = condition(query->on);
+    if (on == query->on) return nullptr;
+    auto copy = makeNode<QueryPlan>(*plan);
+    copy->query_ = Expr::makeJoin(query->expr, query->expr2, on, query->opType);
+    return copy;
+  }
+  return nullptr;
+}
+
+}  // namespace storage
+}  // namespace csql
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "planning.h"
+#include "sql/expr.h"
+
+namespace csql {
+namespace storage {
+
+// One applied rewrite, with the whole plan as Mermaid before and after it.
+struct RewriteStep {
+  std::string rule;
+  std::string before;
+  std::string after;
+};
+
+// Applies pattern-matched rewrites to a plan until none of them matches any more. Every rule
+// looks at one step and returns the step replacing it, or nullptr when it does not apply.
+// Steps are visited bottom up, so a rule sees its inputs already rewritten.
+class PlanRewriter {
+ public:
+  using Rule = std::shared_ptr<QueryPlan> (*)(const std::shared_ptr<QueryPlan>& plan);
+  struct NamedRule {
+    const char* name;
+    Rule apply;
+  };
+  // Bound on the passes over the plan, in case two rules undo each other.
+  static constexpr size_t kMaxPasses = 16;
+
+  // `trace`, when set, receives every rewrite applied.
+  PlanRewriter(std::vector<RewriteStep>* trace = nullptr);
+
+  // The rewritten plan, with its costs recalculated.
+  std::shared_ptr<QueryPlan> rewrite(std::shared_ptr<QueryPlan> plan);
+
+ private:
+  // Rewrites the step in `slot` and below; whether anything changed.
+  bool rewriteStep(std::shared_ptr<QueryPlan>& slot);
+  static void recalculateCosts(QueryPlan& plan);
+
+  // Filter over Filter becomes one Filter of both predicates.
+  static std::shared_ptr<QueryPlan> mergeFilters(const std::shared_ptr<QueryPlan>& plan);
+  // A full scan hands its input through unchanged.
+  static std::shared_ptr<QueryPlan> dropFullScan(const std::shared_ptr<QueryPlan>& plan);
+  // A filter whose predicate is always true.
+  static std::shared_ptr<QueryPlan> dropTrueFilter(const std::shared_ptr<QueryPlan>& plan);
+  // SELECT * evaluates every column to itself.
+  static std::shared_ptr<QueryPlan> dropStarEval(const std::shared_ptr<QueryPlan>& plan);
+  // ((x)) in a filter or join condition becomes (x), and the outermost parentheses go.
+  static std::shared_ptr<QueryPlan> collapseParentheses(const std::shared_ptr<QueryPlan>& plan);
+
+  static const std::vector<NamedRule>& rules();
+
+  std::vector<RewriteStep>* trace_;
+  std::shared_ptr<QueryPlan> root_;
+};
+
+}  // namespace storage
+}  // namespace csql
@@ -2,11 +2,24 @@
 
 #include <math.h>
 
+#include <algorithm>
 #include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
 #include <memory>
 #include <string>
 
 #include "generic/database.h"
+#include "generic/statistics.h"
+#include "generic/table.h"
+#include "generic/trace.h"
+#include "common_subexpressions.h"
+#include "expression_simplifier.h"
+#include "join_order.h"
+#include "memory/arena.h"
+#include "plan_rewriter.h"
+#include "predicate_pushdown.h"
 #include "sql/expr.h"
 #include "sql/statements/select.h"
 
@@ -40,10 +53,26 @@ void createMermaidNode(std::string& result, const std::string& name, const std::
   result += "\n";
 }
 
+// `text` inside a quoted Mermaid label.
+std::string mermaidText(const std::string& text) {
+  std::string result;
+  for (char c : text) {
+    result += c == '"' ? std::string("#quot;") : std::string(1, c);
+  }
+  return result;
+}
+
 void connectMermaidNodes(std::string& result, const std::string& from, const std::string& to) {
   result += "  " + from + " --> " + to + "\n";
 }
 
+// `nanoseconds` in milliseconds, to the microsecond.
+std::string milliseconds(uint64_t nanoseconds) {
+  char buffer[32];
+  std::snprintf(buffer, sizeof(buffer), "%.3f", nanoseconds / 1e6);
+  return buffer;
+}
+
 size_t log2(size_t x) {
   if (x == 0) return 0;
   return static_cast<size_t>(std::ceil(std::log2(x)));
@@ -54,25 +83,49 @@ size_t log2(size_t x) {
 namespace csql {
 namespace storage {
 
+bool QueryPlan::hasKeyRange(std::shared_ptr<SelectStatement> select,
+                            std::shared_ptr<Database> db) {
+  auto source = select->fromSource;
+  while (source->type == kExprOperator && source->opType == kOpParenthesis) {
+    source = source->expr;
+  }
+  if (source->type != kExprTableRef || !select->whereClause) {
+    return false;
+  }
+  auto table = std::dynamic_pointer_cast<StorageTable>(db->getTable(source));
+  return table && table->hasKeyRange(select->whereClause);
+}
+
 std::shared_ptr<QueryPlan> QueryPlan::create(std::shared_ptr<Expr> query,
                                              std::shared_ptr<Database> db) {
   std::shared_ptr<QueryPlan> plan;
   switch (query->type) {
     case kExprSelect: {
-      std::shared_ptr<SelectStatement> select = query->select;
-      plan = std::make_shared<QueryPlan>(QueryType::kStepEval, query, db);
-      plan->left_ = std::make_shared<QueryPlan>(QueryType::kStepFilter, select->whereClause, db);
-      plan->left_->left_ =
-          std::make_shared<QueryPlan>(QueryType::kStepFullScan, select->fromSource, db);
+      auto select = makeNode<SelectStatement>(*query->select);
+      select->whereClause = ExpressionSimplifier().simplify(select->whereClause);
+      select->selectList = ExpressionSimplifier().simplify(select->selectList);
+      plan = makeNode<QueryPlan>(QueryType::kStepEval, Expr::makeSelect(select), db);
+      plan->left_ = makeNode<QueryPlan>(QueryType::kStepFilter, select->whereClause, db);
+      if (hasKeyRange(select, db)) {  // the filter stays on top for the rest of the clause
+        plan->left_->left_ =
+            makeNode<QueryPlan>(QueryType::kStepRangeScan, select->whereClause, db);
+      } else {
+        plan->left_->left_ =
+            makeNode<QueryPlan>(QueryType::kStepFullScan, select->fromSource, db);
+      }
       plan->left_->left_->left_ = create(select->fromSource, db);
     } break;
     case kExprJoin: {
-      plan = std::make_shared<QueryPlan>(QueryType::kStepJoin, query, db);
+      auto on = ExpressionSimplifier().simplify(query->on);
+      if (on != query->on) {
+        query = Expr::makeJoin(query->expr, query->expr2, on, query->opType);
+      }
+      plan = makeNode<QueryPlan>(QueryType::kStepJoin, query, db);
       plan->left_ = create(query->expr, db);
       plan->right_ = create(query->expr2, db);
     } break;
     case kExprTableRef: {
-      plan = std::make_shared<QueryPlan>(QueryType::kStepProject, query, db);
+      plan = makeNode<QueryPlan>(QueryType::kStepProject, query, db);
     } break;
     case kExprOperator: {
       if (query->opType == OperatorType::kOpParenthesis) {
@@ -88,31 +141,339 @@ std::shared_ptr<QueryPlan> QueryPlan::create(std::shared_ptr<Expr> query,
   return plan;
 }
 
+namespace {
+
+// Appends the column references of `expr`; false when it reads every column (`*`, subquery).
+bool collectColumns(const std::shared_ptr<Expr>& expr, std::vector<std::shared_ptr<Expr>>& out) {
+  if (!expr) return true;
+  if (expr->type == kExprStar || expr->type == kExprSelect || expr->type == kExprJoin) {
+    return false;
+  }
+  if (expr->type == kExprColumnRef) {
+    out.push_back(expr);
+    return true;
+  }
+  return collectColumns(expr->expr, out) && collectColumns(expr->expr2, out);
+}
+
+// `columns` and the column references of `expr`, nullptr standing for all columns.
+std::shared_ptr<std::vector<std::shared_ptr<Expr>>> withColumnsOf(
+    std::shared_ptr<std::vector<std::shared_ptr<Expr>>> columns,
+    const std::shared_ptr<Expr>& expr) {
+  if (!columns) return nullptr;
+  auto result = makeNode<std::vector<std::shared_ptr<Expr>>>(*columns);
+  return collectColumns(expr, *result) ? result : nullptr;
+}
+
+// Value of a literal or of a bound parameter, nullptr when unknown.
+std::shared_ptr<Expr> constantValue(const std::shared_ptr<Expr>& expr) {
+  if (expr->type == kExprParameter) return expr->expr;
+  return expr->isLiteral() && expr->type != kExprColumnRef ? expr : nullptr;
+}
+
+void splitConjuncts(const std::shared_ptr<Expr>& expr, std::vector<std::shared_ptr<Expr>>& out) {
+  if (expr->type == kExprOperator && (expr->opType == kOpAnd || expr->opType == kOpParenthesis)) {
+    splitConjuncts(expr->expr, out);
+    if (expr->expr2) splitConjuncts(expr->expr2, out);
+  } else {
+    out.push_back(expr);
+  }
+}
+
+}  // namespace
+
+std::shared_ptr<QueryPlan> QueryPlan::optimize(std::vector<RewriteStep>* trace) {
+  TraceSpan span(TraceLevel::kInfo, "optimize");
+  auto plan = PlanRewriter(trace).rewrite(restructure());
+  CommonSubexpressions().share(plan);
+  return plan;
+}
+
+std::shared_ptr<QueryPlan> QueryPlan::restructure() {
+  if (type_ == QueryType::kStepFilter) {
+    auto pushed = PredicatePushdown(db_.lock()).apply(shared_from_this());
+    if (pushed.get() != this) {
+      return pushed->restructure();
+    }
+  }
+  if ((type_ == QueryType::kStepJoin || type_ == QueryType::kStepHashJoin) &&
+      query_->opType == kOpInnerJoin) {
+    return JoinOrder(db_.lock()).reorder(shared_from_this());
+  }
+  if (left_) left_ = left_->restructure();
+  if (right_) right_ = right_->restructure();
+  if (type_ == QueryType::kStepEval) {
+    expandStar();
+    auto columns = makeNode<std::vector<std::shared_ptr<Expr>>>();
+    for (const auto& expr : *query_->select->selectList) {
+      if (!collectColumns(expr, *columns)) {
+        columns = nullptr;
+        break;
+      }
+    }
+    left_->require(columns);
+  }
+  calculateCost();
+  return shared_from_this();
+}
+
+void QueryPlan::require(std::shared_ptr<std::vector<std::shared_ptr<Expr>>> columns) {
+  switch (type_) {
+    case QueryType::kStepFilter:
+      left_->require(withColumnsOf(columns, query_));
+      break;
+    case QueryType::kStepFullScan:
+    case QueryType::kStepRangeScan:
+    case QueryType::kStepSort:
+      left_->require(columns);
+      break;
+    case QueryType::kStepJoin:
+    case QueryType::kStepHashJoin:
+      required_ = withColumnsOf(columns, query_->on);  // the ON clause reads the merged row
+      left_->require(required_);
+      right_->require(required_);
+      break;
+    default:  // tables are read in place and subqueries evaluate their own select list
+      break;
+  }
+}
+
+void QueryPlan::expandStar() {
+  auto select = query_->select;
+  bool hasStar = false;
+  for (const auto& expr : *select->selectList) {
+    hasStar = hasStar || expr->isType(kExprStar);
+  }
+  if (!hasStar) return;
+
+  std::vector<std::shared_ptr<Expr>> tables;
+  std::function<bool(std::shared_ptr<Expr>)> collect = [&](std::shared_ptr<Expr> source) {
+    if (source->type == kExprOperator && source->opType == kOpParenthesis) {
+      return collect(source->expr);
+    } else if (source->type == kExprJoin) {
+      return collect(source->expr) && collect(source->expr2);
+    } else if (source->type == kExprTableRef) {
+      tables.push_back(source);
+      return true;
+    }
+    return false;
+  };
+  if (!collect(select->fromSource) || tables.size() < 2) return;
+
+  auto db = db_.lock();
+  auto selectList = makeNode<std::vector<std::shared_ptr<Expr>>>();
+  for (const auto& expr : *select->selectList) {
+    if (!expr->isType(kExprStar)) {
+      selectList->push_back(expr);
+      continue;
+    }
+    for (const auto& table : tables) {
+      for (const auto& column : db->getTable(table)->getColumns()) {
+        selectList->push_back(Expr::makeColumnRef(table->name, column->getName()));
+      }
+    }
+  }
+  auto expanded = makeNode<SelectStatement>(*select);
+  expanded->selectList = selectList;
+  query_ = Expr::makeSelect(expanded);
+}
+
+QueryPlan::ColumnSource QueryPlan::resolve(const Expr& column) const {
+  ColumnSource found;
+  size_t matches = 0;
+  std::function<void(const QueryPlan&)> visit = [&](const QueryPlan& plan) {
+    if (plan.type_ == QueryType::kStepProject) {
+      if (!column.table.empty() && column.table != plan.query_->name &&
+          column.table != plan.query_->alias) {
+        return;
+      }
+      auto table = db_.lock()->findTable(plan.query_->name);
+      if (!table) return;
+      const auto& columns = table->getColumns();
+      for (size_t i = 0; i < columns.size(); i++) {
+        if (columns[i]->getName() == column.name) {
+          found = ColumnSource{.table = table, .index = i};
+          matches++;
+        }
+      }
+      return;
+    }
+    if (plan.type_ == QueryType::kStepEval && &plan != this) return;  // a subquery
+    if (plan.left_) visit(*plan.left_);
+    if (plan.right_) visit(*plan.right_);
+  };
+  visit(*this);
+  return matches == 1 ? found : ColumnSource{};
+}
+
+
+double QueryPlan::selectivity(std::shared_ptr<Expr> condition) const {
+  if (!condition) return 1;
+  if (condition->type == kExprLiteralBool) return condition->ival ? 1 : 0;
+  if (condition->type != kExprOperator) return 0.5;
+
+  switch (condition->opType) {
+    case kOpParenthesis:
+      return selectivity(condition->expr);
+    case kOpAnd:
+      return selectivity(condition->expr) * selectivity(condition->expr2);
+    case kOpOr: {
+      double left = selectivity(condition->expr);
+      double right = selectivity(condition->expr2);
+      return left + right - left * right;
+    }
+    case kOpNot:
+      return 1 - selectivity(condition->expr);
+    case kOpIsNull: {
+      if (condition->expr->type != kExprColumnRef) return kDefaultNullSelectivity;
+      auto source = resolve(*condition->expr);
+      auto statistics = source.table ? source.table->statistics() : nullptr;
+      if (!statistics) return kDefaultNullSelectivity;
+      return 1 - nonNullFraction(*statistics, source.index);
+    }
+    case kOpEquals:
+      return equality(condition->expr, condition->expr2);
+    case kOpNotEquals:
+      return 1 - equality(condition->expr, condition->expr2);
+    case kOpLess:
+    case kOpLessEq:
+    case kOpGreater:
+    case kOpGreaterEq:
+      if (condition->expr->type == kExprColumnRef) {
+        return comparison(condition->opType, *condition->expr, condition->expr2);
+      } else if (condition->expr2->type == kExprColumnRef) {
+        return comparison(ExpressionSimplifier::mirrored(condition->opType), *condition->expr2,
+                          condition->expr);
+      }
+      return kDefaultRangeSelectivity;
+    default:
+      return 0.5;
+  }
+}
+
+double QueryPlan::nonNullFraction(const TableStatistics& statistics, size_t index) {
+  const auto& column = statistics.column(index);
+  size_t total = column.nulls() + column.values();
+  return total ? static_cast<double>(column.values()) / total : 1;
+}
+
+double QueryPlan::distinct(const ColumnSource& source) {
+  if (auto statistics = source.table->statistics()) {
+    return statistics->column(source.index).distinct();
+  }
+  // Without statistics a stored column is assumed to hold distinct values.
+  return static_cast<double>(source.table->getRowsCount());
+}
+
+double QueryPlan::equality(std::shared_ptr<Expr> left, std::shared_ptr<Expr> right) const {
+  if (left->type != kExprColumnRef) std::swap(left, right);
+  if (left->type != kExprColumnRef) return kDefaultEqualitySelectivity;
+  auto source = resolve(*left);
+  if (!source.table) return kDefaultEqualitySelectivity;
+  auto statistics = source.table->statistics();
+  double fraction = statistics ? nonNullFraction(*statistics, source.index) : 1;
+
+  if (right->type == kExprColumnRef) {  // a join: every value matches one of the larger domain
+    auto other = resolve(*right);
+    if (!other.table) return kDefaultEqualitySelectivity;
+    auto otherStatistics = other.table->statistics();
+    fraction *= otherStatistics ? nonNullFraction(*otherStatistics, other.index) : 1;
+    double values = std::max(distinct(source), distinct(other));
+    return values >= 1 ? fraction / values : 0;
+  }
+
+  auto value = constantValue(right);
+  if (value && value->type == kExprLiteralNull) return 0;
+  const auto& column = source.table->getColumns()[source.index];
+  if (!statistics) {
+    if (column->isKey() || column->isUnique()) {
+      return 1.0 / std::max<size_t>(source.table->getRowsCount(), 1);
+    }
+    return kDefaultEqualitySelectivity;
+  }
+  const auto& columnStatistics = statistics->column(source.index);
+  if (columnStatistics.values() == 0) return 0;
+  if (value) {
+    auto position = columnStatistics.position(*value);
+    if (position && (*position < *columnStatistics.min() || *position > *columnStatistics.max())) {
+      return 0;
+    }
+    if (auto equal = position ? columnStatistics.fractionEqual(*position) : std::nullopt) {
+      return fraction * *equal;  // a frequent value, counted by the histogram
+    }
+  }
+  return fraction / columnStatistics.distinct();
+}
+
+double QueryPlan::comparison(OperatorType op, const Expr& column,
+                             std::shared_ptr<Expr> bound) const {
+  auto source = resolve(column);
+  auto statistics = source.table ? source.table->statistics() : nullptr;
+  auto value = constantValue(bound);
+  if (!statistics || !value) return kDefaultRangeSelectivity;
+  if (value->type == kExprLiteralNull) return 0;
+  const auto& columnStatistics = statistics->column(source.index);
+  auto position = columnStatistics.position(*value);
+  if (!position || columnStatistics.values() == 0) return kDefaultRangeSelectivity;
+
+  double below = columnStatistics.fractionBelow(*position);
+  double equal = 0;
+  if (*position >= *columnStatistics.min() && *position <= *columnStatistics.max()) {
+    equal = columnStatistics.fractionEqual(*position).value_or(1 / columnStatistics.distinct());
+  }
+  double fraction = 0;
+  switch (op) {
+    case kOpLess:
+      fraction = below;
+      break;
+    case kOpLessEq:
+      fraction = below + equal;
+      break;
+    case kOpGreater:
+      fraction = 1 - below - equal;
+      break;
+    case kOpGreaterEq:
+      fraction = 1 - below;
+      break;
+    default:
+      return kDefaultRangeSelectivity;
+  }
+  return std::clamp(fraction, 0.0, 1.0) * nonNullFraction(*statistics, source.index);
+}
+
+double QueryPlan::keySelectivity(std::shared_ptr<Expr> whereClause) const {
+  std::vector<std::shared_ptr<Expr>> conjuncts;
+  splitConjuncts(whereClause, conjuncts);
+  double fraction = 1;
+  for (const auto& conjunct : conjuncts) {
+    if (conjunct->type != kExprOperator || !conjunct->expr2) continue;
+    for (const auto& side : {conjunct->expr, conjunct->expr2}) {
+      if (side->type != kExprColumnRef) continue;
+      auto source = resolve(*side);
+      if (source.table && source.table->isLeadingKey(*source.table->getColumns()[source.index])) {
+        fraction *= selectivity(conjunct);
+        break;
+      }
+    }
+  }
+  return fraction;
+}
+
 void makeMermaid(std::string& result, const csql::storage::QueryPlan& plan,
                  const std::string& name) {
   std::string left_name = name + "L";
   std::string right_name = name + "R";
-  MermaidNodeType type = MermaidNodeType::kRectangle;
-
-  if (plan.type_ == QueryType::kStepJoin) {
-    createMermaidNode(result, name, "Join", MermaidNodeType::kRectangleRounded);
-  } else if (plan.type_ == QueryType::kStepFilter) {
-    createMermaidNode(result, name, "Filter", MermaidNodeType::kRectangleRounded);
-  } else if (plan.type_ == QueryType::kStepHashMerge) {
-    createMermaidNode(result, name, "HashMerge", MermaidNodeType::kRectangleRounded);
-  } else if (plan.type_ == QueryType::kStepSort) {
-    createMermaidNode(result, name, "Sort", MermaidNodeType::kRectangleRounded);
-  } else if (plan.type_ == QueryType::kStepEval) {
-    createMermaidNode(result, name, "Eval", MermaidNodeType::kRectangleRounded);
-  } else if (plan.type_ == QueryType::kStepProject) {
-    createMermaidNode(result, name, "Project: " + plan.query_->name, MermaidNodeType::kRectangle);
-  } else if (plan.type_ == QueryType::kStepFullScan) {
-    createMermaidNode(result, name, "FullScan", MermaidNodeType::kCircle);
-  } else if (plan.type_ == QueryType::kStepRangeScan) {
-    createMermaidNode(result, name, "RangeScan", MermaidNodeType::kCircle);
-  } else {
-    createMermaidNode(result, name, "\"Unknown\"", type);
+  MermaidNodeType type = MermaidNodeType::kRectangleRounded;
+  if (plan.type_ == QueryType::kStepProject) {
+    type = MermaidNodeType::kRectangle;
+  } else if (plan.type_ == QueryType::kStepFullScan || plan.type_ == QueryType::kStepRangeScan) {
+    type = MermaidNodeType::kCircle;
   }
+  std::string text = mermaidText(plan.label()) + "<br/>" + plan.estimates();
+  if (plan.actual_) {
+    text += "<br/>" + plan.actuals();
+  }
+  createMermaidNode(result, name, text, type);
   if (plan.left_) {
     makeMermaid(result, *plan.left_, left_name);
     connectMermaidNodes(result, left_name, name);
@@ -123,6 +484,54 @@ void makeMermaid(std::string& result, const csql::storage::QueryPlan& plan,
   }
 }
 
+std::string QueryPlan::label() const {
+  std::string on;
+  if ((type_ == QueryType::kStepJoin || type_ == QueryType::kStepHashJoin) && query_->on) {
+    on = " on " + query_->on->toString();
+  }
+  if (type_ == QueryType::kStepJoin) {
+    return "Join" + on;
+  } else if (type_ == QueryType::kStepHashJoin) {
+    return std::string("HashJoin build ") + (buildLeft_ ? "left" : "right") + on;
+  } else if (type_ == QueryType::kStepFilter && query_) {
+    return "Filter: " + query_->toString();
+  }
+  return toString();
+}
+
+std::string QueryPlan::estimates() const {
+  return "~" + std::to_string(cost_.amount) + " rows, " + std::to_string(cost_.total_steps) +
+         " steps";
+}
+
+std::string QueryPlan::actuals() const {
+  if (!actual_) return "";
+  std::string result = "actual " + std::to_string(actual_->rows) + " rows";
+  if ((left_ && left_->actual_) || (right_ && right_->actual_)) {
+    size_t examined = (left_ && left_->actual_ ? left_->actual_->rows : 0) +
+                      (right_ && right_->actual_ ? right_->actual_->rows : 0);
+    result += " of " + std::to_string(examined) + " examined";
+  }
+  result += ", " + std::to_string(actual_->loops) + (actual_->loops == 1 ? " loop" : " loops");
+  result += ", " + milliseconds(actual_->wall_ns) + " ms, cpu " + milliseconds(actual_->cpu_ns) +
+            " ms, " + std::to_string(actual_->allocations) + " allocations";
+  if (actual_->counted) {
+    const auto& counters = actual_->counters;
+    char ipc[32];
+    std::snprintf(ipc, sizeof(ipc), "%.2f",
+                  counters.cycles ? static_cast<double>(counters.instructions) / counters.cycles
+                                  : 0.0);
+    result += ", " + std::to_string(counters.cycles) + " cycles, " +
+              std::to_string(counters.instructions) + " instructions (IPC " + ipc + "), " +
+              std::to_string(counters.cache_misses) + " LLC misses, " +
+              std::to_string(counters.branch_misses) + " branch misses";
+    if (counters.multiplexed) {
+      result += " (estimated, the PMU was multiplexed)";
+    }
+  }
+  return result;
+}
+
 std::string QueryPlan::toString() const {
   switch (type_) {
     case QueryType::kStepFullScan:
@@ -131,6 +540,8 @@ std::string QueryPlan::toString() const {
       return "RangeScan";
     case QueryType::kStepJoin:
       return "Join";
+    case QueryType::kStepHashJoin:
+      return "HashJoin";
     case QueryType::kStepHashMerge:
       return "HashMerge";
     case QueryType::kStepSort:
@@ -152,41 +563,59 @@ std::string QueryPlan::toMermaid(const std::string& name) const {
   return result;
 }
 
+std::string QueryPlan::explain() const {
+  std::string result;
+  std::function<void(const QueryPlan&, const std::string&)> print =
+      [&](const QueryPlan& plan, const std::string& indent) {
+        result += indent + plan.label() + "  (" + plan.estimates() + ")";
+        if (plan.actual_) {
+          result += "  (" + plan.actuals() + ")";
+        }
+        result += "\n";
+        if (plan.left_) print(*plan.left_, indent + "  ");
+        if (plan.right_) print(*plan.right_, indent + "  ");
+      };
+  print(*this, "");
+  return result;
+}
+
 Cost QueryPlan::calculateCost() {
-  if (type_ == QueryType::kStepJoin) {
+  if (type_ == QueryType::kStepJoin || type_ == QueryType::kStepHashJoin) {
     auto join_expr = query_;
     if (join_expr->type != kExprJoin) {
       throw std::runtime_error("Expected join expression");
     }
     auto left = left_->getCost();
     auto right = right_->getCost();
+    size_t amount;
     if (join_expr->opType == OperatorType::kOpInnerJoin ||
         join_expr->opType == OperatorType::kOpCrossJoin) {
-      cost_ = Cost{
-          .total_steps = left.total_steps + left.amount * right.total_steps,
-          .self_steps = 0,
-          .amount = left.amount + right.amount,
-      };
+      double pairs = static_cast<double>(left.amount) * static_cast<double>(right.amount);
+      amount = static_cast<size_t>(std::ceil(pairs * selectivity(join_expr->on)));
     } else if (join_expr->opType == OperatorType::kOpLeftJoin) {
-      cost_ = Cost{
-          .total_steps = left.total_steps + left.amount * right.total_steps,
-          .self_steps = 0,
-          .amount = left.amount,
-      };
+      amount = left.amount;
     } else if (join_expr->opType == OperatorType::kOpRightJoin) {
+      amount = right.amount;
+    } else if (join_expr->opType == OperatorType::kOpOuterJoin) {
+      amount = left.amount * right.amount;
+    } else {
+      throw std::runtime_error("Unsupported join type");
+    }
+    if (type_ == QueryType::kStepHashJoin) {  // one pass over each side
+      size_t self = left.amount + right.amount + amount;
       cost_ = Cost{
-          .total_steps = left.total_steps + left.amount * right.total_steps,
-          .self_steps = 0,
-          .amount = right.amount,
+          .total_steps = left.total_steps + right.total_steps + self,
+          .self_steps = self,
+          .amount = amount,
       };
-    } else if (join_expr->opType == OperatorType::kOpOuterJoin) {
+    } else {  // the right side is produced again for every left row
+      size_t self = left.amount * right.amount + amount;
       cost_ = Cost{
-          .total_steps = left.total_steps + left.amount * right.total_steps,
-          .self_steps = 0,
-          .amount = left.amount * right.amount,
+          .total_steps = left.total_steps + left.amount * (right.total_steps + right.amount) +
+                         amount,
+          .self_steps = self,
+          .amount = amount,
       };
-    } else {
-      throw std::runtime_error("Unsupported join type");
     }
   } else if (type_ == QueryType::kStepHashMerge) {
     auto left = left_->getCost();
@@ -205,11 +634,18 @@ Cost QueryPlan::calculateCost() {
     };
   } else if (type_ == QueryType::kStepFilter) {
     auto left = left_->getCost();
-    // TODO: Implement better prediction by evaluating the where clause expression
+    // Below a range scan the clause is estimated against the whole table, the scan having
+    // applied its key part already.
+    size_t rows = left.amount;
+    if (left_->type_ == QueryType::kStepRangeScan) {
+      rows = left_->left_->getCost().amount;
+    }
+    size_t amount =
+        std::min(left.amount, static_cast<size_t>(std::ceil(rows * selectivity(query_))));
     cost_ = Cost{
-        .total_steps = left.total_steps,
-        .self_steps = 0,
-        .amount = left.amount,
+        .total_steps = left.total_steps + left.amount,
+        .self_steps = left.amount,
+        .amount = amount,
     };
   } else if (type_ == QueryType::kStepEval) {
     auto left = left_->getCost();
@@ -227,10 +663,11 @@ Cost QueryPlan::calculateCost() {
     };
   } else if (type_ == QueryType::kStepRangeScan) {
     auto left = left_->getCost();
+    size_t amount = std::ceil(left.amount * keySelectivity(query_));
     cost_ = Cost{
-        .total_steps = left.total_steps + left.amount,
-        .self_steps = 0,
-        .amount = left.amount,
+        .total_steps = left.total_steps + log2(left.amount) + amount,
+        .self_steps = log2(left.amount) + amount,
+        .amount = amount,
     };
   } else if (type_ == QueryType::kStepProject) {
     auto table = std::dynamic_pointer_cast<StorageTable>(db_.lock()->getTable(query_));
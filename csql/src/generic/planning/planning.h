@@ -1,8 +1,11 @@
 #pragma once
 
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "sql/expr.h"
+#include "sql/statements/select.h"
 #include "sql/statements/statement.h"
 
 namespace csql {
@@ -10,11 +13,17 @@ namespace storage {
 
 class QueryPlan;
 class Database;
+class StorageTable;
+class TableStatistics;
+struct OperatorStats;
+struct FilterCounts;
+struct RewriteStep;
 
 enum class QueryType {
   kStepFullScan,   // Full table scan
   kStepRangeScan,  // Index range scan
   kStepJoin,       // Join two tables
+  kStepHashJoin,   // Join two tables through a hash table on one side
   kStepHashMerge,  // Hash merge
   kStepSort,       // Sort (order by)
   kStepFilter,     // Filter (where clause)
@@ -28,7 +37,7 @@ struct Cost {
   size_t amount;       // predicted amount of rows
 };
 
-struct QueryPlan {
+struct QueryPlan : public std::enable_shared_from_this<QueryPlan> {
  public:
   QueryPlan(QueryType type, std::shared_ptr<Expr> query, std::shared_ptr<Database> db)
       : type_(type), query_(query), db_(db) {}
@@ -38,10 +47,42 @@ struct QueryPlan {
   virtual ~QueryPlan() = default;
 
   const Cost& getCost() const;
-  std::shared_ptr<QueryPlan> optimize();
+  // Restructures the plan, simplifies it with the rules of PlanRewriter and shares the
+  // subexpressions evaluated twice per row. `trace`, when set, receives every rewrite applied.
+  std::shared_ptr<QueryPlan> optimize(std::vector<RewriteStep>* trace = nullptr);
 
  protected:
+  // Pushes filters towards the tables, reorders inner joins by estimated cost and picks
+  // their strategy, see PredicatePushdown and JoinOrder.
+  std::shared_ptr<QueryPlan> restructure();
   Cost calculateCost();
+  // Whether the source is a single table whose key is bounded by the where clause.
+  static bool hasKeyRange(std::shared_ptr<SelectStatement> select, std::shared_ptr<Database> db);
+  // Guesses used where statistics can not tell, after the ones of System R.
+  static constexpr double kDefaultEqualitySelectivity = 0.1;
+  static constexpr double kDefaultRangeSelectivity = 1.0 / 3;
+  static constexpr double kDefaultNullSelectivity = 0.1;
+
+  // Stored column read by a column reference below this step.
+  struct ColumnSource {
+    std::shared_ptr<StorageTable> table;  // nullptr when unknown or ambiguous
+    size_t index = 0;
+  };
+  ColumnSource resolve(const Expr& column) const;
+
+  // Fraction of rows (or row pairs, for a join) accepted by a condition, from the column
+  // statistics of the tables below when they are analyzed.
+  double selectivity(std::shared_ptr<Expr> condition) const;
+  double equality(std::shared_ptr<Expr> left, std::shared_ptr<Expr> right) const;
+  double comparison(OperatorType op, const Expr& column, std::shared_ptr<Expr> bound) const;
+  // Selectivity of the conjuncts of a where clause that bound the leading key.
+  double keySelectivity(std::shared_ptr<Expr> whereClause) const;
+  static double nonNullFraction(const TableStatistics& statistics, size_t index);
+  static double distinct(const ColumnSource& source);
+  // Spells out `*` over a join in the written table order, which reordering may change.
+  void expandStar();
+  // Tells the steps below which columns are read above them, nullptr meaning all of them.
+  void require(std::shared_ptr<std::vector<std::shared_ptr<Expr>>> columns);
 
   QueryType type_;
 
@@ -50,15 +91,34 @@ struct QueryPlan {
 
   std::shared_ptr<Expr> query_;
   std::weak_ptr<Database> db_;
-  Cost cost_;
+  Cost cost_{};
+  bool buildLeft_ = false;  // kStepHashJoin: hash the left input and probe with the right one
+  // Joins: references of the columns read above and by the ON clause, nullptr for all.
+  std::shared_ptr<std::vector<std::shared_ptr<Expr>>> required_;
+  std::shared_ptr<OperatorStats> actual_;  // what the step did, once run by EXPLAIN ANALYZE
+  std::shared_ptr<FilterCounts> filtered_;  // kStepFilter: rows it read, see IndexAdvisor
+
+  // The step and its condition, e.g. "Filter: a > 1".
+  std::string label() const;
+  // Cost estimate, e.g. "~10 rows, 120 steps".
+  std::string estimates() const;
+  // Counters of actual_, empty when the step was not run profiled.
+  std::string actuals() const;
 
   friend class Database;
+  friend class JoinOrder;
+  friend class PredicatePushdown;
+  friend class PlanRewriter;
+  friend class CommonSubexpressions;
+  friend class IndexAdvisor;
 
  public:  // DEBUG
   std::string toMermaid(const std::string& name = "A") const;
   friend void makeMermaid(std::string& result, const csql::storage::QueryPlan& plan,
                           const std::string& name);
   std::string toString() const;
+  // The plan tree, one step per line with its estimates next to its actuals.
+  std::string explain() const;
 };
 
 // std::ostream& operator<<(std::ostream& os, const QueryPlan& stepPlan);
@@ -0,0 +1,230 @@
+#include "predicate_pushdown.h"
+
+#include <bit>
+#include <memory>
+#include <unordered_set>
+#include <vector>
+
+#include "generic/database.h"
+#include "join_order.h"
+#include "memory/arena.h"
+
+namespace {
+using namespace csql;
+
+void splitConjuncts(std::shared_ptr<Expr> expr, std::vector<std::shared_ptr<Expr>>& conjuncts) {
+  if (expr->type == kExprOperator && expr->opType == kOpAnd) {
+    splitConjuncts(expr->expr, conjuncts);
+    splitConjuncts(expr->expr2, conjuncts);
+  } else if (expr->type == kExprOperator && expr->opType == kOpParenthesis) {
+    splitConjuncts(expr->expr, conjuncts);
+  } else {
+    conjuncts.push_back(expr);
+  }
+}
+
+std::shared_ptr<Expr> conjunction(std::shared_ptr<Expr> left, std::shared_ptr<Expr> right) {
+  if (!left || (left->type == kExprLiteralBool && left->ival)) return right;
+  return Expr::makeOpBinary(left, kOpAnd, right);
+}
+
+bool isInnerJoin(const std::shared_ptr<Expr>& query) {
+  return query->type == kExprJoin && query->opType == kOpInnerJoin;
+}
+
+}  // namespace
+
+namespace csql {
+namespace storage {
+
+PredicatePushdown::PredicatePushdown(std::shared_ptr<Database> db) : db_(db) {}
+
+std::shared_ptr<QueryPlan> PredicatePushdown::apply(std::shared_ptr<QueryPlan> filter) {
+  auto scan = filter->left_;
+  if (!filter->query_ || !scan || scan->type_ != QueryType::kStepFullScan || !scan->left_) {
+    return filter;
+  }
+  std::vector<std::shared_ptr<Expr>> conjuncts;
+  splitConjuncts(filter->query_, conjuncts);
+
+  std::vector<std::shared_ptr<Expr>> kept;
+  auto source = scan->left_;
+  if ((source->type_ == QueryType::kStepJoin || source->type_ == QueryType::kStepHashJoin) &&
+      isInnerJoin(source->query_)) {
+    collect(scan->left_);
+    kept = intoJoins(conjuncts);
+  } else if (source->type_ == QueryType::kStepEval) {
+    kept = intoSubquery(*source, conjuncts);
+  } else {
+    return filter;
+  }
+
+  if (kept.size() == conjuncts.size()) {
+    return filter;
+  }
+  if (kept.empty()) {
+    return scan;
+  }
+  std::shared_ptr<Expr> predicate;
+  for (const auto& conjunct : kept) {
+    predicate = conjunction(predicate, conjunct);
+  }
+  filter->query_ = predicate;
+  return filter;
+}
+
+std::shared_ptr<QueryPlan> PredicatePushdown::filtered(std::shared_ptr<QueryPlan> project,
+                                                       std::shared_ptr<Expr> predicate) const {
+  auto table = std::dynamic_pointer_cast<StorageTable>(db_->getTable(project->query_));
+  auto filter = makeNode<QueryPlan>(QueryType::kStepFilter, predicate, db_);
+  if (table && table->hasKeyRange(predicate)) {  // the filter stays on top for the rest
+    filter->left_ = makeNode<QueryPlan>(QueryType::kStepRangeScan, predicate, db_);
+  } else {
+    filter->left_ = makeNode<QueryPlan>(QueryType::kStepFullScan, project->query_, db_);
+  }
+  filter->left_->left_ = project;
+  filter->left_->calculateCost();
+  filter->calculateCost();
+  return filter;
+}
+
+std::vector<std::shared_ptr<Expr>> PredicatePushdown::intoJoins(
+    std::vector<std::shared_ptr<Expr>> conjuncts) {
+  if (leaves_.size() > 64) {
+    return conjuncts;
+  }
+  std::vector<std::shared_ptr<StorageTable>> tables;
+  std::unordered_set<std::string> names;
+  for (auto* slot : leaves_) {
+    std::shared_ptr<StorageTable> table;
+    if ((*slot)->type_ == QueryType::kStepProject) {
+      table = std::dynamic_pointer_cast<StorageTable>(db_->getTable((*slot)->query_));
+    }
+    // A subquery or a table read twice leaves columns that can not be attributed
+    if (!table || !names.insert(table->getName()).second) {
+      return conjuncts;
+    }
+    tables.push_back(table);
+  }
+
+  std::vector<std::shared_ptr<Expr>> kept;
+  std::vector<std::shared_ptr<Expr>> predicates(leaves_.size());
+  for (const auto& conjunct : conjuncts) {
+    uint64_t relations = 0;
+    if (!relationsOf(conjunct, tables, relations) || relations == 0) {
+      kept.push_back(conjunct);  // constants are cheapest evaluated once on top
+    } else if (std::popcount(relations) == 1) {
+      size_t index = std::countr_zero(relations);
+      predicates[index] = conjunction(predicates[index], conjunct);
+    } else {
+      std::shared_ptr<QueryPlan> lowest;
+      uint64_t lowestRelations = 0;
+      for (const auto& [join, below] : joins_) {
+        if ((relations & ~below) == 0 &&
+            (!lowest || std::popcount(below) < std::popcount(lowestRelations))) {
+          lowest = join;
+          lowestRelations = below;
+        }
+      }
+      auto query = lowest->query_;
+      lowest->query_ = Expr::makeJoin(query->expr, query->expr2,
+                                      conjunction(query->on, conjunct), query->opType);
+    }
+  }
+  for (size_t i = 0; i < leaves_.size(); i++) {
+    if (predicates[i]) {
+      *leaves_[i] = filtered(*leaves_[i], predicates[i]);
+    }
+  }
+  return kept;
+}
+
+std::vector<std::shared_ptr<Expr>> PredicatePushdown::intoSubquery(
+    QueryPlan& eval, std::vector<std::shared_ptr<Expr>> conjuncts) {
+  auto filter = eval.left_;
+  if (!filter || filter->type_ != QueryType::kStepFilter || !filter->left_) {
+    return conjuncts;
+  }
+  std::vector<std::shared_ptr<Expr>> kept;
+  std::shared_ptr<Expr> moved;
+  for (const auto& conjunct : conjuncts) {
+    if (auto rewritten = throughSelectList(conjunct, *eval.query_->select->selectList)) {
+      moved = conjunction(moved, rewritten);
+    } else {
+      kept.push_back(conjunct);
+    }
+  }
+  if (!moved) {
+    return conjuncts;
+  }
+  filter->query_ = conjunction(filter->query_, moved);
+  auto scan = filter->left_;
+  if (scan->type_ == QueryType::kStepFullScan && scan->left_ &&
+      scan->left_->type_ == QueryType::kStepProject) {
+    auto rescanned = filtered(scan->left_, filter->query_);  // the key may be bounded now
+    filter->left_ = rescanned->left_;
+  }
+  return kept;
+}
+
+uint64_t PredicatePushdown::collect(std::shared_ptr<QueryPlan>& slot) {
+  auto plan = slot;
+  if ((plan->type_ == QueryType::kStepJoin || plan->type_ == QueryType::kStepHashJoin) &&
+      isInnerJoin(plan->query_)) {
+    uint64_t relations = collect(plan->left_);
+    relations |= collect(plan->right_);
+    joins_.emplace_back(plan, relations);
+    return relations;
+  }
+  leaves_.push_back(&slot);
+  return leaves_.size() <= 64 ? uint64_t(1) << (leaves_.size() - 1) : 0;  // see intoJoins
+}
+
+std::shared_ptr<Expr> PredicatePushdown::throughSelectList(
+    std::shared_ptr<Expr> expr, const std::vector<std::shared_ptr<Expr>>& list) const {
+  if (!expr) return expr;
+  if (expr->type == kExprColumnRef) {
+    bool star = false;
+    size_t matches = 0;
+    std::shared_ptr<Expr> match;
+    for (const auto& item : list) {
+      if (item->type == kExprStar) {
+        star = true;
+      } else if (item->hasAlias() ? expr->table.empty() && item->alias == expr->name
+                                  : item->type == kExprColumnRef && item->name == expr->name &&
+                                        (expr->table.empty() || item->table.empty() ||
+                                         item->table == expr->table)) {
+        match = item;
+        matches++;
+      }
+    }
+    if (matches == 0) {
+      return star ? expr : nullptr;  // the name comes through `*` unchanged
+    }
+    if (matches > 1) return nullptr;
+    if (match->type == kExprColumnRef) {
+      return match->table.empty() ? Expr::makeColumnRef(match->name)
+                                  : Expr::makeColumnRef(match->table, match->name);
+    }
+    auto computed = makeNode<Expr>(*match);
+    computed->alias.clear();
+    return computed;
+  }
+  if (expr->type == kExprSelect || expr->type == kExprJoin || expr->type == kExprStar) {
+    return nullptr;
+  }
+  if (expr->type != kExprOperator) {
+    return expr;
+  }
+  auto left = throughSelectList(expr->expr, list);
+  auto right = throughSelectList(expr->expr2, list);
+  if ((expr->expr && !left) || (expr->expr2 && !right)) return nullptr;
+  if (left == expr->expr && right == expr->expr2) return expr;
+  auto rewritten = makeNode<Expr>(*expr);
+  rewritten->expr = left;
+  rewritten->expr2 = right;
+  return rewritten;
+}
+
+}  // namespace storage
+}  // namespace csql
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "generic/table.h"
+#include "planning.h"
+#include "sql/expr.h"
+
+namespace csql {
+namespace storage {
+
+class Database;
+
+// Moves the conjuncts of a WHERE clause as close to the tables as they can go: into a filter
+// over the one stored table they read, into the ON condition of the lowest inner join that
+// sees all of their tables, or through the select list of a subquery into its own WHERE.
+// Conjuncts that can not move stay in the original filter.
+class PredicatePushdown {
+ public:
+  PredicatePushdown(std::shared_ptr<Database> db);
+
+  // `filter` is a kStepFilter step; returns the step replacing it, which is its scan when
+  // every conjunct moved.
+  std::shared_ptr<QueryPlan> apply(std::shared_ptr<QueryPlan> filter);
+
+  // Filter of `predicate` over a stored table, through a range scan when it bounds the key.
+  std::shared_ptr<QueryPlan> filtered(std::shared_ptr<QueryPlan> project,
+                                      std::shared_ptr<Expr> predicate) const;
+
+ private:
+  // The conjuncts left over.
+  std::vector<std::shared_ptr<Expr>> intoJoins(std::vector<std::shared_ptr<Expr>> conjuncts);
+  std::vector<std::shared_ptr<Expr>> intoSubquery(QueryPlan& eval,
+                                                  std::vector<std::shared_ptr<Expr>> conjuncts);
+  // Fills leaves_ and joins_ from a tree of inner joins, returns the relations below `slot`.
+  uint64_t collect(std::shared_ptr<QueryPlan>& slot);
+  // `expr` over the columns a select list is built from, nullptr if it can not be rewritten.
+  std::shared_ptr<Expr> throughSelectList(std::shared_ptr<Expr> expr,
+                                          const std::vector<std::shared_ptr<Expr>>& list) const;
+
+  std::shared_ptr<Database> db_;
+  std::vector<std::shared_ptr<QueryPlan>*> leaves_;                // slots holding the relations
+  std::vector<std::pair<std::shared_ptr<QueryPlan>, uint64_t>> joins_;  // with relations below
+};
+
+}  // namespace storage
+}  // namespace csql
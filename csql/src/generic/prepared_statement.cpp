@@ -0,0 +1,106 @@
+#include "prepared_statement.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "database.h"
+#include "memory/arena.h"
+#include "metrics.h"
+#include "sql/statements/delete.h"
+#include "sql/statements/insert.h"
+#include "trace.h"
+
+namespace csql {
+namespace storage {
+
+PreparedStatement::PreparedStatement(std::shared_ptr<Database> db, std::string sql,
+                                     std::shared_ptr<CachedPlan> prepared)
+    : db_(db),
+      sql_(std::move(sql)),
+      normalized_(PlanCache::normalize(sql_)),
+      prepared_(prepared) {}
+
+size_t PreparedStatement::parameterCount() const {
+  return prepared_->parameters.size();
+}
+
+PreparedStatement& PreparedStatement::bind(size_t index, std::shared_ptr<Expr> value) {
+  if (index >= prepared_->parameters.size()) {
+    throw std::runtime_error("Parameter index out of range: " + std::to_string(index));
+  }
+  prepared_->parameters[index]->expr = value;
+  return *this;
+}
+
+PreparedStatement& PreparedStatement::bind(size_t index, int32_t value) {
+  return bind(index, Expr::makeLiteral(value));
+}
+
+PreparedStatement& PreparedStatement::bind(size_t index, bool value) {
+  return bind(index, Expr::makeLiteral(value));
+}
+
+PreparedStatement& PreparedStatement::bind(size_t index, std::string_view value) {
+  return bind(index, Expr::makeStringLiteral(std::string(value)));
+}
+
+PreparedStatement& PreparedStatement::bind(size_t index, const char* value) {
+  return bind(index, std::string_view(value));
+}
+
+PreparedStatement& PreparedStatement::bind(size_t index, const std::vector<uint8_t>& value) {
+  return bind(index, Expr::makeLiteral(value));
+}
+
+PreparedStatement& PreparedStatement::bindNull(size_t index) {
+  return bind(index, Expr::makeNullLiteral());
+}
+
+void PreparedStatement::clearBindings() {
+  for (auto parameter : prepared_->parameters) {
+    parameter->expr = nullptr;
+  }
+}
+
+std::shared_ptr<TableIterator> PreparedStatement::execute() {
+  TraceSpan span(TraceLevel::kInfo, "execute");
+  uint64_t start = Tracer::now();
+  std::vector<std::shared_ptr<Expr>> values;  // as bound now, for the slow query log
+  for (const auto& parameter : prepared_->parameters) {
+    if (!parameter->expr) {
+      throw std::runtime_error("Parameter is not bound: " + std::to_string(parameter->ival));
+    }
+    values.push_back(parameter->expr);
+  }
+  auto locks = db_->lock(prepared_->statement);
+  if (prepared_->plan && !db_->isCurrent(*prepared_)) {
+    ArenaScope scope(std::make_shared<Arena>());
+    db_->replan(*prepared_);
+  }
+  PhaseTimer timer(db_->metrics_, MetricsPhase::kExecute);
+  size_t rows = 0;
+  if (prepared_->statement->is(kStmtSelect)) {
+    return Database::holding(
+        timer.stop(kStmtSelect, db_->execute(prepared_->plan)->getIterator(),
+                   db_->completion(kStmtSelect, start, sql_, normalized_, values, prepared_->plan)),
+        locks);
+  } else if (prepared_->statement->is(kStmtInsert)) {
+    rows = db_->insert(std::dynamic_pointer_cast<InsertStatement>(prepared_->statement));
+  } else if (prepared_->statement->is(kStmtDelete)) {
+    rows = db_->delete_(std::dynamic_pointer_cast<DeleteStatement>(prepared_->statement));
+  } else {
+    throw std::runtime_error("Unsupported statement");
+  }
+  timer.stop(prepared_->statement->type());
+  db_->complete(prepared_->statement->type(), start, rows, sql_, normalized_, values, nullptr);
+  return nullptr;
+}
+
+std::shared_ptr<QueryPlan> PreparedStatement::plan() const {
+  return prepared_->plan;
+}
+
+}  // namespace storage
+}  // namespace csql
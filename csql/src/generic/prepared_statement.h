@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "generic/plan_cache.h"
+#include "generic/planning/planning.h"
+#include "sql/expr.h"
+#include "sql/statements/statement.h"
+#include "table.h"
+
+namespace csql {
+namespace storage {
+
+class Database;
+
+// A statement parsed (and, for SELECT, planned) once and executed many times.
+// Placeholders (?) are numbered from 0 in order of appearance; bound values are kept
+// between executions until rebound or cleared. Like a cached plan, the plan is built again
+// with the values bound at the time once a table it reads is analyzed or replaced.
+class PreparedStatement {
+ public:
+  PreparedStatement(std::shared_ptr<Database> db, std::string sql,
+                    std::shared_ptr<CachedPlan> prepared);
+  virtual ~PreparedStatement() = default;
+
+  size_t parameterCount() const;
+
+  PreparedStatement& bind(size_t index, int32_t value);
+  PreparedStatement& bind(size_t index, bool value);
+  PreparedStatement& bind(size_t index, std::string_view value);
+  PreparedStatement& bind(size_t index, const char* value);
+  PreparedStatement& bind(size_t index, const std::vector<uint8_t>& value);
+  PreparedStatement& bindNull(size_t index);
+  void clearBindings();
+
+  // Rows for SELECT, nullptr otherwise. Every parameter has to be bound.
+  std::shared_ptr<TableIterator> execute();
+
+  std::shared_ptr<QueryPlan> plan() const;
+
+ private:
+  PreparedStatement& bind(size_t index, std::shared_ptr<Expr> value);
+
+  std::shared_ptr<Database> db_;
+  std::string sql_;
+  std::string normalized_;  // see PlanCache::normalize
+  std::shared_ptr<CachedPlan> prepared_;  // its parameters are the placeholders
+};
+
+}  // namespace storage
+}  // namespace csql
@@ -0,0 +1,112 @@
+#include <time.h>
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+#include "hardware_counters.h"
+#include "memory/allocations.h"
+#include "row.h"
+#include "table.h"
+
+namespace {
+
+uint64_t threadCpuNanoseconds() {
+  timespec time;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+  return static_cast<uint64_t>(time.tv_sec) * 1000000000 + time.tv_nsec;
+}
+
+// Adds what the enclosing block spent to `stats`.
+class Measure {
+ public:
+  Measure(csql::storage::OperatorStats& stats)
+      : stats_(stats),
+        counted_(csql::storage::HardwareCounters::read(counters_)),
+        wall_(std::chrono::steady_clock::now()),
+        cpu_(threadCpuNanoseconds()),
+        allocations_(csql::storage::threadAllocations().count) {}
+  ~Measure() {
+    stats_.wall_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                          std::chrono::steady_clock::now() - wall_)
+                          .count();
+    stats_.cpu_ns += threadCpuNanoseconds() - cpu_;
+    stats_.allocations += csql::storage::threadAllocations().count - allocations_;
+    csql::storage::HardwareCounts now;
+    if (counted_ && csql::storage::HardwareCounters::read(now)) {
+      stats_.counted = true;
+      stats_.counters.cycles += now.cycles - counters_.cycles;
+      stats_.counters.instructions += now.instructions - counters_.instructions;
+      stats_.counters.cache_misses += now.cache_misses - counters_.cache_misses;
+      stats_.counters.branch_misses += now.branch_misses - counters_.branch_misses;
+      stats_.counters.multiplexed = stats_.counters.multiplexed || now.multiplexed;
+    }
+  }
+
+ private:
+  csql::storage::OperatorStats& stats_;
+  csql::storage::HardwareCounts counters_;
+  bool counted_;  // read first and last, so that they count as little of the rest as they can
+  std::chrono::steady_clock::time_point wall_;
+  uint64_t cpu_;
+  size_t allocations_;
+};
+
+}  // namespace
+
+namespace csql {
+namespace storage {
+
+ProfiledTable::ProfiledTable(std::shared_ptr<ITable> table, std::shared_ptr<OperatorStats> stats)
+    : table_(table), stats_(stats) {}
+
+std::shared_ptr<ProfiledTable> ProfiledTable::create(std::shared_ptr<ITable> table,
+                                                     std::shared_ptr<OperatorStats> stats) {
+  auto table_ = std::make_shared<ProfiledTable>(table, stats);
+  for (auto column : table->getColumns()) {
+    table_->columns_.push_back(column);
+  }
+  table_->name_ = table->getName();
+  return table_;
+}
+
+std::shared_ptr<TableIterator> ProfiledTable::getIterator() {
+  return std::make_shared<ProfiledIterator>(
+      std::dynamic_pointer_cast<ProfiledTable>(shared_from_this()));
+}
+
+ProfiledIterator::ProfiledIterator(std::shared_ptr<ProfiledTable> table) : table_(table) {
+  auto& stats = *table_->stats_;
+  {
+    Measure measure(stats);
+    it_ = table_->table_->getIterator();
+  }
+  stats.loops++;
+  stats.rows += it_->hasValue() ? 1 : 0;
+}
+
+bool ProfiledIterator::hasValue() const {
+  return it_->hasValue();
+}
+
+ProfiledIterator& ProfiledIterator::operator++() {
+  auto& stats = *table_->stats_;
+  {
+    Measure measure(stats);
+    ++(*it_);
+  }
+  stats.rows += it_->hasValue() ? 1 : 0;
+  return *this;
+}
+
+std::shared_ptr<Row> ProfiledIterator::operator*() {
+  Measure measure(*table_->stats_);
+  return **it_;
+}
+
+std::shared_ptr<Iterator> ProfiledIterator::getMemoryIterator() {
+  return it_->getMemoryIterator();
+}
+
+}  // namespace storage
+}  // namespace csql
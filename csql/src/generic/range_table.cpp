@@ -0,0 +1,30 @@
+#include <memory>
+
+#include "memory/cell.h"
+#include "table.h"
+
+namespace csql {
+namespace storage {
+
+RangeTable::RangeTable(std::shared_ptr<StorageTable> table, std::shared_ptr<Cell> start,
+                       std::shared_ptr<Cell> end)
+    : table_(table), start_(start), end_(end) {}
+
+std::shared_ptr<RangeTable> RangeTable::create(std::shared_ptr<StorageTable> table,
+                                               std::shared_ptr<Cell> start,
+                                               std::shared_ptr<Cell> end) {
+  auto table_ = std::make_shared<RangeTable>(table, start, end);
+  for (auto column : table->getColumns()) {
+    table_->columns_.push_back(column);
+  }
+  table_->name_ = table->getName();
+  return table_;
+}
+
+std::shared_ptr<TableIterator> RangeTable::getIterator() {
+  return std::make_shared<StorageTableIterator>(table_,
+                                                table_->storage_->getRangeIterator(start_, end_));
+}
+
+}  // namespace storage
+}  // namespace csql
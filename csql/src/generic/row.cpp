@@ -1,5 +1,6 @@
 #include "row.h"
 
+#include <limits>
 #include <memory>
 
 #include "column.h"
@@ -27,6 +28,11 @@ bool isBytesEq(const std::string& left, const std::string& right) {
   return left == right;
 }
 
+}  // namespace
+
+namespace csql {
+namespace storage {
+
 std::shared_ptr<csql::Expr> applyUnaryOpToLiteral(csql::OperatorType opType,
                                                   std::shared_ptr<csql::Expr> operand) {
   if (!operand->isLiteral()) {
@@ -34,6 +40,9 @@ std::shared_ptr<csql::Expr> applyUnaryOpToLiteral(csql::OperatorType opType,
   }
 
   if (opType == csql::OperatorType::kOpParenthesis) return operand;
+  if (opType == csql::OperatorType::kOpIsNull) {
+    return csql::Expr::makeLiteral(operand->isType(csql::ExprType::kExprLiteralNull));
+  }
   if (operand->isType(csql::ExprType::kExprLiteralNull)) {
     return csql::Expr::makeNullLiteral();
   }
@@ -138,10 +147,17 @@ std::shared_ptr<csql::Expr> applyBinaryOpToLiterals(std::shared_ptr<csql::Expr>
       return csql::Expr::makeLiteral(left->ival - right->ival);
     if (opType == csql::OperatorType::kOpAsterisk)
       return csql::Expr::makeLiteral(left->ival * right->ival);
-    if (opType == csql::OperatorType::kOpSlash)
-      return csql::Expr::makeLiteral(left->ival / right->ival);
-    if (opType == csql::OperatorType::kOpPercentage)
-      return csql::Expr::makeLiteral(left->ival % right->ival);
+    if (opType == csql::OperatorType::kOpSlash || opType == csql::OperatorType::kOpPercentage) {
+      // Both trap rather than give a value
+      if (right->ival == 0) throw std::runtime_error("Division by zero");
+      if (right->ival == -1 && left->ival == std::numeric_limits<int32_t>::min()) {
+        if (opType == csql::OperatorType::kOpPercentage) return csql::Expr::makeLiteral(0);
+        throw std::runtime_error("Integer overflow");
+      }
+      return csql::Expr::makeLiteral(opType == csql::OperatorType::kOpSlash
+                                         ? left->ival / right->ival
+                                         : left->ival % right->ival);
+    }
     throw std::runtime_error("Invalid operation on ints: " + std::to_string(opType));
   }
   if (left->isType(csql::ExprType::kExprLiteralBool)) {
@@ -186,11 +202,6 @@ std::shared_ptr<csql::Expr> applyBinaryOpToLiterals(std::shared_ptr<csql::Expr>
   throw std::runtime_error("Invalid operation on literals: " + std::to_string(opType));
 }
 
-}  // namespace
-
-namespace csql {
-namespace storage {
-
 Row::Row(std::shared_ptr<ITable> table, std::shared_ptr<Cell> cell) : table_(table), cell_(cell) {}
 
 template <>
@@ -243,7 +254,7 @@ bool Row::isNull(std::string columnName) const {
 
 std::ostream& operator<<(std::ostream& stream, const Row& row) {
   auto table = row.table_.lock();
-  auto columns = table->getColumns();
+  const auto& columns = table->getColumns();
   for (size_t i = 0; i < columns.size(); i++) {
     auto column = columns[i];
     std::string data;
@@ -273,7 +284,7 @@ std::shared_ptr<Expr> Row::getColumnValue(size_t index) {
   if (!table) {
     throw std::runtime_error("Table not found");
   }
-  auto columns = table->getColumns();
+  const auto& columns = table->getColumns();
   if (isNull(index)) {
     return Expr::makeNullLiteral();
   }
@@ -304,7 +315,7 @@ size_t Row::getIndexOfColumn(std::string columnName) const {
   if (!table) {
     throw std::runtime_error("Table not found");
   }
-  auto columns = table->getColumns();
+  const auto& columns = table->getColumns();
   for (size_t i = 0; i < columns.size(); i++) {
     if (columns[i]->getName() == columnName) {
       return i;
@@ -318,7 +329,7 @@ size_t Row::getIndexOfColumn(std::shared_ptr<Column> column) const {
   if (!table) {
     throw std::runtime_error("Table not found");
   }
-  auto columns = table->getColumns();
+  const auto& columns = table->getColumns();
   for (size_t i = 0; i < columns.size(); i++) {
     if (columns[i] == column) {
       return i;
@@ -336,22 +347,56 @@ std::shared_ptr<Expr> Row::evaluate(std::shared_ptr<Expr> expr) {
       throw std::runtime_error("Table not found");
     }
     return getColumnValue(table->getColumn(expr));
+  } else if (expr->isType(kExprParameter)) {
+    if (!expr->expr) {
+      throw std::runtime_error("Parameter is not bound: " + std::to_string(expr->ival));
+    }
+    return expr->expr;
   } else if (expr->isLiteral()) {
     return expr;
   } else if (expr->isType(kExprOperator)) {
-    if (isUnaryOperator(expr->opType)) {
-      auto operand = evaluate(expr->expr);
-      return applyUnaryOpToLiteral(expr->opType, operand);
-    } else if (isBinaryOperator(expr->opType)) {
-      auto operand1 = evaluate(expr->expr);
-      auto operand2 = evaluate(expr->expr2);
-      return applyBinaryOpToLiterals(operand1, expr->opType, operand2);
-    } else {
-      throw std::runtime_error("Unknown operator type: " + std::to_string(expr->opType));
+    if (expr->memoSlot < 0) {
+      return evaluateOperator(expr);
     }
+    size_t slot = expr->memoSlot;
+    if (memo_.size() <= slot) {
+      memo_.resize(slot + 1);
+    }
+    if (!memo_[slot]) {
+      memo_[slot] = evaluateOperator(expr);
+    }
+    return memo_[slot];
   }
   throw std::runtime_error("Invalid expression type: " + std::to_string(expr->type));
 }
 
+std::shared_ptr<Expr> Row::evaluateOperator(const std::shared_ptr<Expr>& expr) {
+  if (expr->opType == kOpAnd || expr->opType == kOpOr) {
+    // Short circuit. Anything but two booleans gives false, which decides AND on a false left
+    // side; OR on a true one only when the right side gives a boolean too.
+    auto left = evaluate(expr->expr);
+    if (left->type == kExprLiteralBool) {
+      bool value = left->ival;
+      if (value == (expr->opType == kOpOr) &&
+          (expr->opType == kOpAnd || expr->expr2->isBoolean())) {
+        return left;
+      }
+      auto right = evaluate(expr->expr2);
+      if (right->type != kExprLiteralBool) return Expr::makeLiteral(false);
+      return expr->opType == kOpOr && value ? left : right;
+    }
+    return applyBinaryOpToLiterals(left, expr->opType, evaluate(expr->expr2));
+  }
+  if (isUnaryOperator(expr->opType)) {
+    auto operand = evaluate(expr->expr);
+    return applyUnaryOpToLiteral(expr->opType, operand);
+  } else if (isBinaryOperator(expr->opType)) {
+    auto operand1 = evaluate(expr->expr);
+    auto operand2 = evaluate(expr->expr2);
+    return applyBinaryOpToLiterals(operand1, expr->opType, operand2);
+  }
+  throw std::runtime_error("Unknown operator type: " + std::to_string(expr->opType));
+}
+
 }  // namespace storage
 }  // namespace csql
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include <memory>
 #include <ostream>
+#include <vector>
 
 #include "../memory/cell.h"
 #include "memory/iterator.h"
@@ -19,6 +20,11 @@ class Iterator;
 class WhereClauseIterator;
 class FilteredTableIterator;
 
+// Operators applied to literal operands, as Row::evaluate does; throw on invalid operands.
+std::shared_ptr<Expr> applyUnaryOpToLiteral(OperatorType opType, std::shared_ptr<Expr> operand);
+std::shared_ptr<Expr> applyBinaryOpToLiterals(std::shared_ptr<Expr> left, OperatorType opType,
+                                              std::shared_ptr<Expr> right);
+
 class Row {
  public:
   Row(std::shared_ptr<ITable> table, std::shared_ptr<Cell> cell);
@@ -40,11 +46,15 @@ class Row {
   friend class Iterator;
   friend class WhereClauseIterator;
   friend class FilteredTableIterator;
+  friend class ConjunctOrder;
+  friend class JoinTable;
   friend class JoinTableIterator;
+  friend class HashJoinIterator;
   friend class EvaluateIterator;
 
  private:
   std::shared_ptr<Expr> evaluate(std::shared_ptr<Expr> expr);
+  std::shared_ptr<Expr> evaluateOperator(const std::shared_ptr<Expr>& expr);
   std::shared_ptr<Expr> getColumnValue(size_t index);
   std::shared_ptr<Expr> getColumnValue(std::string columnName);
   std::shared_ptr<Expr> getColumnValue(std::shared_ptr<Column> column);
@@ -55,6 +65,8 @@ class Row {
  private:
   std::weak_ptr<ITable> table_;
   std::shared_ptr<Cell> cell_;
+  // Values of the common subexpressions evaluated on this row, by Expr::memoSlot.
+  std::vector<std::shared_ptr<Expr>> memo_;
 };
 }  // namespace storage
 }  // namespace csql
\ No newline at end of file
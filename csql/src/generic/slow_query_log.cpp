@@ -0,0 +1,96 @@
+#include "slow_query_log.h"
+
+#include <ctime>
+#include <iomanip>
+#include <stdexcept>
+#include <utility>
+
+#include "trace.h"
+
+namespace csql {
+namespace storage {
+
+SlowQueryLog::SlowQueryLog(const std::string& filename, std::chrono::nanoseconds threshold)
+    : file_(filename, std::ios::app), threshold_(threshold.count()) {
+  if (!file_) {
+    throw std::runtime_error("Cannot open file: " + filename);
+  }
+  writer_ = std::thread([this] { write(); });
+}
+
+SlowQueryLog::~SlowQueryLog() {
+  close();
+}
+
+void SlowQueryLog::close() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stopping_) return;
+    stopping_ = true;
+  }
+  queued_.notify_one();
+  writer_.join();
+}
+
+bool SlowQueryLog::isSlow(uint64_t nanoseconds) const {
+  return nanoseconds >= threshold_;
+}
+
+void SlowQueryLog::report(uint64_t start, uint64_t rows, const std::string& sql,
+                          const std::vector<std::shared_ptr<Expr>>& parameters,
+                          std::shared_ptr<QueryPlan> plan) {
+  uint64_t nanoseconds = Tracer::now() - start;
+  if (!isSlow(nanoseconds)) return;
+
+  Entry entry{std::chrono::system_clock::now(), nanoseconds, rows, sql, {}, "", ""};
+  for (const auto& parameter : parameters) {
+    entry.parameters.push_back(parameter ? parameter->toString() : "NULL");
+  }
+  if (plan) {
+    entry.plan = plan->explain();
+    entry.mermaid = plan->toMermaid();
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stopping_) return;  // closed meanwhile
+    entries_.push_back(std::move(entry));
+  }
+  queued_.notify_one();
+}
+
+void SlowQueryLog::write() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    queued_.wait(lock, [this] { return stopping_ || !entries_.empty(); });
+    if (entries_.empty()) return;  // stopping
+    std::deque<Entry> entries;
+    entries.swap(entries_);
+    lock.unlock();
+
+    for (const auto& entry : entries) {
+      std::time_t time = std::chrono::system_clock::to_time_t(entry.finished);
+      std::tm utc;
+      gmtime_r(&time, &utc);
+      file_ << "# " << std::put_time(&utc, "%Y-%m-%dT%H:%M:%SZ") << " " << std::fixed
+            << std::setprecision(3) << entry.nanoseconds / 1e6 << " ms, " << entry.rows
+            << " rows\n"
+            << entry.sql << "\n";
+      if (!entry.parameters.empty()) {
+        file_ << "-- parameters:";
+        for (size_t i = 0; i < entry.parameters.size(); i++) {
+          file_ << (i ? ", " : " ") << entry.parameters[i];
+        }
+        file_ << "\n";
+      }
+      if (!entry.plan.empty()) {
+        file_ << "-- plan:\n" << entry.plan << "-- mermaid:\n" << entry.mermaid;
+      }
+      file_ << "\n";
+    }
+    file_.flush();
+    lock.lock();
+  }
+}
+
+}  // namespace storage
+}  // namespace csql
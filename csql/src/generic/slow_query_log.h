@@ -0,0 +1,61 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "generic/planning/planning.h"
+#include "sql/expr.h"
+
+namespace csql {
+namespace storage {
+
+// Appends the statements slower than a threshold to a file. Entries are written by a thread
+// of its own, so that a slow statement does not also wait for the disk.
+class SlowQueryLog {
+ public:
+  struct Entry {
+    std::chrono::system_clock::time_point finished;
+    uint64_t nanoseconds;  // from the start of parsing until the statement is done
+    uint64_t rows;         // returned by a query, inserted or deleted otherwise
+    std::string sql;
+    std::vector<std::string> parameters;
+    std::string plan;     // QueryPlan::explain, empty without a plan
+    std::string mermaid;  // QueryPlan::toMermaid
+  };
+
+  SlowQueryLog(const std::string& filename, std::chrono::nanoseconds threshold);
+  SlowQueryLog(const SlowQueryLog&) = delete;
+  SlowQueryLog& operator=(const SlowQueryLog&) = delete;
+  virtual ~SlowQueryLog();  // see close()
+
+  // Writes the entries still queued and stops the writer; later reports are dropped.
+  void close();
+  bool isSlow(uint64_t nanoseconds) const;
+  // Queues an entry for a statement that started at `start` (Tracer::now) and is done now,
+  // when it is slow. `parameters` and `plan` are read before returning.
+  void report(uint64_t start, uint64_t rows, const std::string& sql,
+              const std::vector<std::shared_ptr<Expr>>& parameters,
+              std::shared_ptr<QueryPlan> plan);
+
+ private:
+  void write();
+
+  std::ofstream file_;
+  uint64_t threshold_;
+  std::mutex mutex_;
+  std::condition_variable queued_;
+  std::deque<Entry> entries_;
+  bool stopping_ = false;
+  std::thread writer_;
+};
+
+}  // namespace storage
+}  // namespace csql
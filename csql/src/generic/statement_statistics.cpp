@@ -0,0 +1,156 @@
+#include "statement_statistics.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <limits>
+#include <thread>
+#include <unordered_set>
+
+#include "appender.h"
+#include "sql/statements/create.h"
+#include "table.h"
+
+namespace {
+
+int32_t clamped(uint64_t value) {
+  return static_cast<int32_t>(
+      std::min<uint64_t>(value, std::numeric_limits<int32_t>::max()));
+}
+
+}  // namespace
+
+namespace csql {
+namespace storage {
+
+StatementStatistics::StatementStatistics() : slots_(new Slot[kCapacity]) {}
+
+StatementStatistics::~StatementStatistics() {
+  for (size_t i = 0; i < kCapacity; i++) {
+    delete slots_[i].text.load(std::memory_order_relaxed);
+  }
+}
+
+uint64_t StatementStatistics::fingerprint(const std::string& normalized) {
+  uint64_t hash = 14695981039346656037ull;  // FNV-1a
+  for (unsigned char c : normalized) {
+    hash = (hash ^ c) * 1099511628211ull;
+  }
+  return hash ? hash : 1;  // 0 marks a free slot
+}
+
+StatementStatistics::Slot* StatementStatistics::find(uint64_t fingerprint,
+                                                     const std::string& normalized) {
+  for (size_t i = 0; i < kCapacity; i++) {
+    Slot& slot = slots_[(fingerprint + i) & (kCapacity - 1)];
+    uint64_t current = slot.fingerprint.load(std::memory_order_acquire);
+    if (current == 0 &&
+        slot.fingerprint.compare_exchange_strong(current, fingerprint,
+                                                 std::memory_order_acq_rel)) {
+      slot.text.store(new std::string(normalized), std::memory_order_release);
+      return &slot;
+    }
+    if (current == fingerprint) {
+      const std::string* text;
+      while (!(text = slot.text.load(std::memory_order_acquire))) {
+        std::this_thread::yield();  // claimed, the text is stored right after
+      }
+      if (*text == normalized) {
+        return &slot;
+      }
+    }
+  }
+  return nullptr;
+}
+
+void StatementStatistics::record(const std::string& normalized, const Usage& usage) {
+  Slot* slot = find(fingerprint(normalized), normalized);
+  if (!slot) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  slot->calls.fetch_add(1, std::memory_order_relaxed);
+  slot->total_ns.fetch_add(usage.nanoseconds, std::memory_order_relaxed);
+  slot->rows.fetch_add(usage.rows, std::memory_order_relaxed);
+  slot->full_scans.fetch_add(usage.full_scans, std::memory_order_relaxed);
+  slot->range_scans.fetch_add(usage.range_scans, std::memory_order_relaxed);
+  uint64_t max = slot->max_ns.load(std::memory_order_relaxed);
+  while (usage.nanoseconds > max &&
+         !slot->max_ns.compare_exchange_weak(max, usage.nanoseconds,
+                                             std::memory_order_relaxed)) {
+  }
+}
+
+std::vector<StatementStatistics::Entry> StatementStatistics::entries() const {
+  std::vector<Entry> entries;
+  for (size_t i = 0; i < kCapacity; i++) {
+    const Slot& slot = slots_[i];
+    const std::string* text = slot.text.load(std::memory_order_acquire);
+    if (!text) continue;  // free, or claimed and not recorded yet
+    entries.push_back(Entry{slot.fingerprint.load(std::memory_order_relaxed), *text,
+                            slot.calls.load(std::memory_order_relaxed),
+                            slot.total_ns.load(std::memory_order_relaxed),
+                            slot.max_ns.load(std::memory_order_relaxed),
+                            slot.rows.load(std::memory_order_relaxed),
+                            slot.full_scans.load(std::memory_order_relaxed),
+                            slot.range_scans.load(std::memory_order_relaxed)});
+    if (!entries.back().text.empty() && entries.back().text.back() == ' ') {
+      entries.back().text.pop_back();
+    }
+  }
+  return entries;
+}
+
+size_t StatementStatistics::dropped() const {
+  return dropped_.load(std::memory_order_relaxed);
+}
+
+std::shared_ptr<StorageTable> StatementStatistics::toTable() const {
+  auto statements = entries();
+  size_t width = 1;
+  for (const auto& entry : statements) {
+    width = std::max(width, entry.text.size());
+  }
+
+  auto createStatement = std::make_shared<CreateStatement>(CreateType::kCreateTable);
+  createStatement->tableName = kTableName;
+  createStatement->columns = std::make_shared<std::vector<std::shared_ptr<ColumnDefinition>>>();
+  auto addColumn = [&](const char* name, ColumnType type, bool key = false) {
+    auto constraints = std::make_shared<std::unordered_set<ConstraintType>>();
+    if (key) {
+      constraints->insert(ConstraintType::Key);
+    }
+    createStatement->columns->push_back(
+        std::make_shared<ColumnDefinition>(name, type, constraints, nullptr));
+  };
+  addColumn("fingerprint", ColumnType(DataType::STRING, 16));
+  addColumn("query", ColumnType(DataType::STRING, width), true);
+  for (const char* name : {"calls", "total_us", "mean_us", "max_us", "rows", "full_scans",
+                           "range_scans"}) {
+    addColumn(name, ColumnType(DataType::INT32));
+  }
+  auto table = StorageTable::create(createStatement);
+  {
+    Appender appender(table);
+    for (const auto& entry : statements) {
+      char fingerprint[17];
+      std::snprintf(fingerprint, sizeof(fingerprint), "%016llx",
+                    static_cast<unsigned long long>(entry.fingerprint));
+      uint64_t mean = entry.calls ? entry.total_ns / entry.calls : 0;
+      appender.append(fingerprint)
+          .append(entry.text)
+          .append(clamped(entry.calls))
+          .append(clamped(entry.total_ns / 1000))
+          .append(clamped(mean / 1000))
+          .append(clamped(entry.max_ns / 1000))
+          .append(clamped(entry.rows))
+          .append(clamped(entry.full_scans))
+          .append(clamped(entry.range_scans))
+          .endRow();
+    }
+    appender.flush();
+  }
+  return table;
+}
+
+}  // namespace storage
+}  // namespace csql
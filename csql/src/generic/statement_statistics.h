@@ -0,0 +1,83 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace csql {
+namespace storage {
+
+class StorageTable;
+
+// Workload statistics by statement fingerprint, in the manner of pg_stat_statements: calls,
+// time, rows and how the tables were read, summed over every execution of a statement whose
+// literals and placeholders are the only difference.
+//
+// Fingerprints live in a fixed open-addressing table whose slots are claimed by a
+// compare-and-swap and then updated with relaxed atomic additions, so that recording never
+// takes a lock. A slot is matched by fingerprint and then by text, statements whose
+// fingerprints collide get a slot each. Statements arriving once it is full are counted as dropped.
+class StatementStatistics {
+ public:
+  static constexpr size_t kCapacity = 1024;
+  // Name under which the statistics can be queried, see toTable().
+  static constexpr const char* kTableName = "csql_stat_statements";
+
+  // What one execution did.
+  struct Usage {
+    uint64_t nanoseconds;  // from the start of parsing until the statement is done
+    uint64_t rows;         // returned by a query, inserted or deleted otherwise
+    uint64_t full_scans;   // tables read from the first row to the last
+    uint64_t range_scans;  // tables read through a key range
+  };
+  struct Entry {
+    uint64_t fingerprint;
+    std::string text;  // normalized
+    uint64_t calls;
+    uint64_t total_ns;
+    uint64_t max_ns;
+    uint64_t rows;
+    uint64_t full_scans;
+    uint64_t range_scans;
+  };
+
+  StatementStatistics();
+  StatementStatistics(const StatementStatistics&) = delete;
+  StatementStatistics& operator=(const StatementStatistics&) = delete;
+  virtual ~StatementStatistics();
+
+  // Of the text of PlanCache::normalize.
+  static uint64_t fingerprint(const std::string& normalized);
+
+  void record(const std::string& normalized, const Usage& usage);
+  // The statements recorded so far, in no particular order.
+  std::vector<Entry> entries() const;
+  size_t dropped() const;
+
+  // Snapshot of entries() as a table with the columns fingerprint (hex), query (KEY), calls,
+  // total_us, mean_us, max_us, rows, full_scans and range_scans.
+  std::shared_ptr<StorageTable> toTable() const;
+
+ private:
+  struct Slot {
+    std::atomic<uint64_t> fingerprint{0};  // 0 while free
+    std::atomic<const std::string*> text{nullptr};  // set right after the slot is claimed
+    std::atomic<uint64_t> calls{0};
+    std::atomic<uint64_t> total_ns{0};
+    std::atomic<uint64_t> max_ns{0};
+    std::atomic<uint64_t> rows{0};
+    std::atomic<uint64_t> full_scans{0};
+    std::atomic<uint64_t> range_scans{0};
+  };
+  // Slot holding `normalized`, claimed for it when missing; nullptr when full.
+  Slot* find(uint64_t fingerprint, const std::string& normalized);
+
+  std::unique_ptr<Slot[]> slots_;
+  std::atomic<size_t> dropped_{0};
+};
+
+}  // namespace storage
+}  // namespace csql
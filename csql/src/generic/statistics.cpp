@@ -0,0 +1,292 @@
+#include "statistics.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "column.h"
+#include "table.h"
+
+namespace {
+
+// splitmix64 finalizer, std::hash of an integer is the integer itself.
+uint64_t mix(uint64_t value) {
+  value += 0x9e3779b97f4a7c15ULL;
+  value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+  return value ^ (value >> 31);
+}
+
+// Order preserving position of a byte string, from its first 6 bytes.
+double prefixPosition(std::string_view bytes) {
+  double position = 0;
+  double scale = 1;
+  for (size_t i = 0; i < std::min<size_t>(bytes.size(), 6); i++) {
+    scale /= 256;
+    position += static_cast<uint8_t>(bytes[i]) * scale;
+  }
+  return position;
+}
+
+}  // namespace
+
+namespace csql {
+namespace storage {
+
+void HyperLogLog::add(uint64_t hash) {
+  size_t index = hash >> (64 - kPrecision);
+  uint64_t rest = hash << kPrecision;
+  uint8_t rank = rest ? std::countl_zero(rest) + 1 : 64 - kPrecision + 1;
+  registers_[index] = std::max(registers_[index], rank);
+}
+
+double HyperLogLog::estimate() const {
+  constexpr double m = size_t(1) << kPrecision;
+  double sum = 0;
+  size_t zeros = 0;
+  for (uint8_t rank : registers_) {
+    sum += std::ldexp(1.0, -rank);
+    zeros += rank == 0;
+  }
+  double estimate = 0.7213 / (1 + 1.079 / m) * m * m / sum;
+  if (estimate <= 2.5 * m && zeros > 0) {  // linear counting for small cardinalities
+    estimate = m * std::log(m / zeros);
+  }
+  return estimate;
+}
+
+ColumnStatistics::ColumnStatistics(const ColumnType& type) : type_(type) {}
+
+void ColumnStatistics::build(std::vector<double>& positions) {
+  histogram_.clear();
+  if (positions.empty()) return;
+  std::sort(positions.begin(), positions.end());
+  size_t depth = (positions.size() + kBuckets - 1) / kBuckets;
+  size_t start = 0;
+  while (start < positions.size()) {
+    size_t end = std::min(start + depth, positions.size());
+    // Equal values share a bucket, so that an upper bound counts all of its occurrences.
+    double upper = positions[end - 1];
+    end = std::upper_bound(positions.begin() + end - 1, positions.end(), upper) -
+          positions.begin();
+    size_t equal = positions.begin() + end -
+                   std::lower_bound(positions.begin() + start, positions.begin() + end, upper);
+    histogram_.push_back(HistogramBucket{.upper = upper, .count = end - start, .equal = equal});
+    start = end;
+  }
+}
+
+void ColumnStatistics::add(const Cell& cell, size_t index) {
+  if (cell.isNull(index)) {
+    nulls_++;
+    return;
+  }
+  values_++;
+  double value = position(cell, index);
+  extend(value);
+  distinct_.add(hash(cell, index));
+  if (histogram_.empty()) return;
+  auto bucket = std::lower_bound(
+      histogram_.begin(), histogram_.end(), value,
+      [](const HistogramBucket& bucket, double value) { return bucket.upper < value; });
+  if (bucket == histogram_.end()) {
+    bucket = std::prev(histogram_.end());
+    bucket->upper = value;
+    bucket->equal = 0;
+  }
+  bucket->count++;
+  bucket->equal += bucket->upper == value;
+}
+
+void ColumnStatistics::remove(const Cell& cell, size_t index) {
+  if (cell.isNull(index)) {
+    nulls_ -= nulls_ > 0;
+    return;
+  }
+  values_ -= values_ > 0;
+  double value = position(cell, index);
+  auto bucket = std::lower_bound(
+      histogram_.begin(), histogram_.end(), value,
+      [](const HistogramBucket& bucket, double value) { return bucket.upper < value; });
+  if (bucket != histogram_.end() && bucket->count > 0) {
+    bucket->count--;
+    bucket->equal -= bucket->upper == value && bucket->equal > 0;
+  }
+}
+
+size_t ColumnStatistics::nulls() const {
+  return nulls_;
+}
+
+size_t ColumnStatistics::values() const {
+  return values_;
+}
+
+double ColumnStatistics::distinct() const {
+  if (values_ == 0) return 0;
+  return std::clamp(distinct_.estimate(), 1.0, static_cast<double>(values_));
+}
+
+std::optional<double> ColumnStatistics::min() const {
+  return min_;
+}
+
+std::optional<double> ColumnStatistics::max() const {
+  return max_;
+}
+
+double ColumnStatistics::fractionBelow(double position) const {
+  if (values_ == 0 || position <= *min_) return 0;
+  if (position > *max_) return 1;
+  if (histogram_.empty()) {  // only min and max, assume a uniform spread
+    return (position - *min_) / (*max_ - *min_);
+  }
+  size_t total = this->total();
+  if (total == 0) return 0;
+  double below = 0;
+  double lower = *min_;
+  for (const auto& bucket : histogram_) {
+    if (position > bucket.upper) {
+      below += bucket.count;
+    } else {
+      if (position > lower && bucket.upper > lower) {  // spread the others evenly
+        below += (bucket.count - bucket.equal) * (position - lower) / (bucket.upper - lower);
+      }
+      break;
+    }
+    lower = bucket.upper;
+  }
+  return std::min(below / total, 1.0);
+}
+
+std::optional<double> ColumnStatistics::fractionEqual(double position) const {
+  auto bucket = std::lower_bound(
+      histogram_.begin(), histogram_.end(), position,
+      [](const HistogramBucket& bucket, double value) { return bucket.upper < value; });
+  size_t total = this->total();
+  if (bucket == histogram_.end() || bucket->upper != position || total == 0) {
+    return std::nullopt;
+  }
+  return static_cast<double>(bucket->equal) / total;
+}
+
+size_t ColumnStatistics::total() const {
+  size_t total = 0;
+  for (const auto& bucket : histogram_) {
+    total += bucket.count;
+  }
+  return total;
+}
+
+double ColumnStatistics::position(const Cell& cell, size_t index) const {
+  switch (type_.data_type) {
+    case DataType::INT32:
+      return cell.get<int32_t>(index);
+    case DataType::BOOL:
+      return cell.get<bool>(index);
+    case DataType::STRING:
+      return prefixPosition(*static_cast<std::string*>(cell.values[index]));
+    case DataType::BYTES:
+      return prefixPosition(std::string_view(static_cast<const char*>(cell.values[index]),
+                                             std::min<size_t>(type_.length, 6)));
+    default:
+      throw std::runtime_error("Invalid data type");
+  }
+}
+
+std::optional<double> ColumnStatistics::position(const Expr& literal) const {
+  switch (type_.data_type) {
+    case DataType::INT32:
+    case DataType::BOOL:
+      if (literal.type == kExprLiteralInt || literal.type == kExprLiteralBool) {
+        return literal.ival;
+      }
+      break;
+    case DataType::STRING:
+    case DataType::BYTES:
+      if (literal.type == kExprLiteralString || literal.type == kExprLiteralBytes) {
+        return prefixPosition(literal.name);
+      }
+      break;
+    default:
+      break;
+  }
+  return std::nullopt;
+}
+
+void ColumnStatistics::extend(double position) {
+  min_ = min_ ? std::min(*min_, position) : position;
+  max_ = max_ ? std::max(*max_, position) : position;
+}
+
+uint64_t ColumnStatistics::hash(const Cell& cell, size_t index) const {
+  switch (type_.data_type) {
+    case DataType::INT32:
+      return mix(static_cast<uint32_t>(cell.get<int32_t>(index)));
+    case DataType::BOOL:
+      return mix(cell.get<bool>(index));
+    case DataType::STRING:
+      return mix(std::hash<std::string>()(*static_cast<std::string*>(cell.values[index])));
+    case DataType::BYTES:
+      return mix(std::hash<std::string_view>()(
+          std::string_view(static_cast<const char*>(cell.values[index]), type_.length)));
+    default:
+      throw std::runtime_error("Invalid data type");
+  }
+}
+
+TableStatistics::TableStatistics(size_t rows, std::vector<ColumnStatistics> columns)
+    : rows_(rows), columns_(std::move(columns)) {}
+
+std::shared_ptr<TableStatistics> TableStatistics::create(StorageTable& table) {
+  std::vector<ColumnStatistics> columns;
+  for (const auto& column : table.columns_) {
+    columns.emplace_back(column->type());
+  }
+  auto statistics = std::make_shared<TableStatistics>(0, std::move(columns));
+  std::vector<std::vector<double>> positions(table.columns_.size());
+  auto it = table.storage_->getIterator();
+  while (it->hasValue()) {
+    auto cell = it->get();
+    it->next();
+    statistics->add(*cell);
+    for (size_t i = 0; i < positions.size(); i++) {
+      if (!cell->isNull(i)) {
+        positions[i].push_back(statistics->columns_[i].position(*cell, i));
+      }
+    }
+  }
+  for (size_t i = 0; i < positions.size(); i++) {
+    statistics->columns_[i].build(positions[i]);
+  }
+  return statistics;
+}
+
+void TableStatistics::add(const Cell& cell) {
+  rows_++;
+  for (size_t i = 0; i < columns_.size(); i++) {
+    columns_[i].add(cell, i);
+  }
+}
+
+void TableStatistics::remove(const Cell& cell) {
+  rows_ -= rows_ > 0;
+  for (size_t i = 0; i < columns_.size(); i++) {
+    columns_[i].remove(cell, i);
+  }
+}
+
+size_t TableStatistics::rows() const {
+  return rows_;
+}
+
+const ColumnStatistics& TableStatistics::column(size_t index) const {
+  return columns_.at(index);
+}
+
+}  // namespace storage
+}  // namespace csql
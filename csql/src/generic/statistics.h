@@ -0,0 +1,100 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "memory/cell.h"
+#include "sql/column_type.h"
+#include "sql/expr.h"
+
+namespace csql {
+namespace storage {
+
+class StorageTable;
+
+// Approximate number of distinct values, HyperLogLog over 2^kPrecision registers (~3% error).
+class HyperLogLog {
+ public:
+  static constexpr size_t kPrecision = 10;
+
+  void add(uint64_t hash);
+  double estimate() const;
+
+ private:
+  std::array<uint8_t, size_t(1) << kPrecision> registers_{};
+};
+
+// Non-null values in (upper bound of the previous bucket, upper], `equal` of them at upper.
+struct HistogramBucket {
+  double upper;
+  size_t count;
+  size_t equal;
+};
+
+// Statistics of one column. Values are ordered by their position on a line: integers and
+// booleans by value, strings and bytes by their first bytes.
+class ColumnStatistics {
+ public:
+  static constexpr size_t kBuckets = 64;
+
+  ColumnStatistics(const ColumnType& type);
+
+  // Builds the histogram from every value of the column, `positions` gets sorted.
+  void build(std::vector<double>& positions);
+  // Incremental maintenance. A removed value stays in the distinct count and in min/max
+  // until the next ANALYZE.
+  void add(const Cell& cell, size_t index);
+  void remove(const Cell& cell, size_t index);
+
+  size_t nulls() const;
+  size_t values() const;  // non-null ones
+  double distinct() const;
+  std::optional<double> min() const;
+  std::optional<double> max() const;
+
+  // Fraction of the non-null values strictly below `position`.
+  double fractionBelow(double position) const;
+  // Fraction of the non-null values at `position` when it is a bucket bound.
+  std::optional<double> fractionEqual(double position) const;
+
+  // Position of the value at `index` of `cell`, or of a literal of a comparable type.
+  double position(const Cell& cell, size_t index) const;
+  std::optional<double> position(const Expr& literal) const;
+
+ private:
+  void extend(double position);
+  size_t total() const;  // values counted by the histogram
+  uint64_t hash(const Cell& cell, size_t index) const;
+
+  ColumnType type_;
+  size_t nulls_ = 0;
+  size_t values_ = 0;
+  std::optional<double> min_;
+  std::optional<double> max_;
+  HyperLogLog distinct_;
+  std::vector<HistogramBucket> histogram_;
+};
+
+// Statistics of a storage table, collected by ANALYZE and kept up to date on insert and delete.
+class TableStatistics {
+ public:
+  TableStatistics(size_t rows, std::vector<ColumnStatistics> columns);
+  static std::shared_ptr<TableStatistics> create(StorageTable& table);
+
+  void add(const Cell& cell);
+  void remove(const Cell& cell);
+
+  size_t rows() const;
+  const ColumnStatistics& column(size_t index) const;
+
+ private:
+  size_t rows_;
+  std::vector<ColumnStatistics> columns_;
+};
+
+}  // namespace storage
+}  // namespace csql
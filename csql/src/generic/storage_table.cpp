@@ -1,19 +1,31 @@
 #include <cstddef>
+#include <cstring>
+#include <limits>
 #include <memory>
+#include <optional>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include "column.h"
+#include "memory/allocations.h"
 #include "memory/set_storage.h"
 #include "memory/storage.h"
 #include "row.h"
 #include "sql/column_type.h"
 #include "sql/expr.h"
+#include "statistics.h"
 #include "table.h"
 
 namespace {
 using namespace csql;
 using namespace csql::storage;
+// A row's share of the ordered set holding it: the tree node and the pointer in it, and what
+// the row keeps to free itself.
+constexpr size_t kRowOverhead = 4 * sizeof(void*) + sizeof(std::shared_ptr<Cell>) +
+                                sizeof(StoredCell) - sizeof(Cell);
+
 csql::storage::KeyComparator hash_comparator = [](std::shared_ptr<csql::storage::Cell> left,
                                                   std::shared_ptr<csql::storage::Cell> right) {
   return left < right;
@@ -70,6 +82,180 @@ csql::storage::KeyComparator get_comparator(const std::vector<size_t>& keyColumn
   };
 }
 
+// Byte representation of a non-null value, used to detect duplicates.
+std::string encodeValue(const Cell& cell, size_t index, const ColumnType& type) {
+  switch (type.data_type) {
+    case DataType::INT32: {
+      int32_t value = cell.get<int32_t>(index);
+      return std::string(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+    case DataType::STRING:
+      return cell.get<std::string>(index);
+    case DataType::BOOL:
+      return cell.get<bool>(index) ? "1" : "0";
+    case DataType::BYTES: {
+      auto bytes = cell.getBytes(index, type.length);
+      return std::string(bytes.begin(), bytes.end());
+    }
+    default:
+      throw std::runtime_error("Invalid data type");
+  }
+}
+
+// Bytes of a value kept in a unique set: its hash node and bucket, and its characters when
+// they do not fit in the string.
+size_t uniqueBytes(const std::string& value) {
+  size_t bytes = sizeof(std::string) + 3 * sizeof(void*);
+  if (value.size() > 15) bytes += value.size() + 1;
+  return bytes;
+}
+
+// Heap copy of a value, for a table keeping a row it did not create.
+void* copyValue(const Cell& cell, size_t index, const ColumnType& type) {
+  if (cell.isNull(index)) return nullptr;
+  switch (type.data_type) {
+    case DataType::INT32:
+      return new int32_t(cell.get<int32_t>(index));
+    case DataType::STRING:
+      return new std::string(*static_cast<const std::string*>(cell.values[index]));
+    case DataType::BOOL:
+      return new bool(cell.get<bool>(index));
+    case DataType::BYTES: {
+      uint8_t* bytes = new uint8_t[type.length];
+      std::memcpy(bytes, cell.values[index], type.length);
+      return bytes;
+    }
+    default:
+      throw std::runtime_error("Invalid data type");
+  }
+}
+
+// `key <op> value` taken from a conjunct of a WHERE clause, `value` being a literal or a
+// parameter.
+struct KeyBound {
+  OperatorType op;
+  std::shared_ptr<Expr> value;
+};
+
+OperatorType mirror(OperatorType op) {
+  switch (op) {
+    case kOpLess:
+      return kOpGreater;
+    case kOpLessEq:
+      return kOpGreaterEq;
+    case kOpGreater:
+      return kOpLess;
+    case kOpGreaterEq:
+      return kOpLessEq;
+    default:
+      return op;
+  }
+}
+
+bool isKeyRef(const std::shared_ptr<Expr>& expr, const Column& key, const std::string& table) {
+  return expr->type == kExprColumnRef && expr->name == key.getName() &&
+         (expr->table.empty() || expr->table == table);
+}
+
+bool isConstant(const std::shared_ptr<Expr>& expr) {
+  return expr->isLiteral() && expr->type != kExprColumnRef;
+}
+
+void collectKeyBounds(const std::shared_ptr<Expr>& expr, const Column& key,
+                      const std::string& table, std::vector<KeyBound>& bounds) {
+  if (!expr || expr->type != kExprOperator) return;
+  if (expr->opType == kOpParenthesis) {
+    collectKeyBounds(expr->expr, key, table, bounds);
+  } else if (expr->opType == kOpAnd) {
+    collectKeyBounds(expr->expr, key, table, bounds);
+    collectKeyBounds(expr->expr2, key, table, bounds);
+  } else if (expr->opType == kOpEquals || expr->opType == kOpLess ||
+             expr->opType == kOpLessEq || expr->opType == kOpGreater ||
+             expr->opType == kOpGreaterEq) {
+    if (isKeyRef(expr->expr, key, table) && isConstant(expr->expr2)) {
+      bounds.push_back(KeyBound{expr->opType, expr->expr2});
+    } else if (isKeyRef(expr->expr2, key, table) && isConstant(expr->expr)) {
+      bounds.push_back(KeyBound{mirror(expr->opType), expr->expr});
+    }
+  }
+}
+
+// Smallest value greater than `value`, none if there is no such value.
+std::optional<int32_t> successor(int32_t value) {
+  if (value == std::numeric_limits<int32_t>::max()) return std::nullopt;
+  return value + 1;
+}
+
+std::optional<std::string> successor(const std::string& value) {
+  return value + '\0';
+}
+
+// Half-open interval [lower, upper) of key values.
+template <typename T>
+struct KeyRange {
+  std::optional<T> lower;
+  std::optional<T> upper;
+  bool empty = false;
+
+  void from(const std::optional<T>& value) {
+    if (!value) {
+      empty = true;
+    } else if (!lower || *lower < *value) {
+      lower = value;
+    }
+  }
+  void to(const std::optional<T>& value) {
+    if (value && (!upper || *value < *upper)) {
+      upper = value;
+    }
+  }
+  void apply(OperatorType op, const T& value) {
+    if (op == kOpEquals) {
+      from(value);
+      to(successor(value));
+    } else if (op == kOpGreater) {
+      from(successor(value));
+    } else if (op == kOpGreaterEq) {
+      from(value);
+    } else if (op == kOpLess) {
+      to(value);
+    } else if (op == kOpLessEq) {
+      to(successor(value));
+    }
+  }
+};
+
+// Cell holding only the key, enough for the storage comparator. Owns the key, unlike the
+// cells of a table.
+template <typename T>
+struct KeyCell : public Cell {
+  KeyCell(size_t columns, size_t key, const T& value) : key(key) {
+    values.resize(columns, nullptr);
+    values[key] = new T(value);
+  }
+  ~KeyCell() override { delete static_cast<T*>(values[key]); }
+
+  size_t key;
+};
+
+template <typename T>
+std::shared_ptr<Cell> makeKeyCell(size_t columns, size_t key, const T& value) {
+  return std::make_shared<KeyCell<T>>(columns, key, value);
+}
+
+template <typename T>
+std::pair<std::shared_ptr<Cell>, std::shared_ptr<Cell>> makeKeyRange(
+    const KeyRange<T>& range, size_t columns, size_t key) {
+  if (range.empty || (range.lower && range.upper && !(*range.lower < *range.upper))) {
+    auto cell = makeKeyCell(columns, key, range.lower ? *range.lower : T());
+    return {cell, cell};
+  }
+  std::shared_ptr<Cell> start, end;
+  if (range.lower) start = makeKeyCell(columns, key, *range.lower);
+  if (range.upper) end = makeKeyCell(columns, key, *range.upper);
+  return {start, end};
+}
+
 }  // namespace
 
 namespace csql {
@@ -93,11 +279,14 @@ std::shared_ptr<StorageTable> StorageTable::create(
       keyColumns.push_back(i);
       keyColumnTypes.push_back(column->type());
     }
+    i++;
   }
 
   table->storage_ = std::make_shared<SetStorage>(get_comparator(keyColumns, keyColumnTypes));
+  table->key_columns_ = keyColumns;
 
   table->name_ = createStatement->tableName;
+  table->memory_ = MemoryTracker::create(table->name_);
   return table;
 }
 
@@ -116,92 +305,275 @@ std::shared_ptr<StorageTable> StorageTable::create(std::shared_ptr<CreateStateme
   }
   table->name_ = createStatement->tableName;
   table->storage_ = std::make_shared<SetStorage>(get_comparator(keyColumns, keyColumnTypes));
+  table->key_columns_ = keyColumns;
+  table->memory_ = MemoryTracker::create(table->name_);
+  // Rows are copied out of the query's arenas, which are reused once the rows are released
+  std::vector<std::shared_ptr<StoredCell>> cells;
+  size_t bytes = 0;
   auto it = refTable->getIterator();
   while (it->hasValue()) {
-    table->storage_->insert((*(*it))->cell_);
+    auto row = *(*it);
+    auto cell = table->allocateRows(1)[0];
+    cell->values.reserve(table->columns_.size());
+    for (size_t i = 0; i < table->columns_.size(); i++) {
+      cell->values.push_back(copyValue(*row->cell_, i, table->columns_[i]->type()));
+    }
+    bytes += table->cellBytes(*cell) + kRowOverhead + table->addUnique(*cell);
+    cells.push_back(cell);
     ++(*it);
   }
+  table->memory_->charge(bytes);
+  table->track(cells);
+  table->storage_->insert(std::vector<std::shared_ptr<Cell>>(cells.begin(), cells.end()));
+  table->updateStatsVersion();
+  for (auto column : table->columns_) {
+    if (column->sequence_) {
+      column->sequence_->observe(column->maxValue());
+    }
+  }
   return table;
 }
 
 void StorageTable::addColumn(std::shared_ptr<Column> column) {
   columns_.push_back(column);
   column->table_ = shared_from_this();
+  value_types_->push_back(column->type().data_type);
+  if (column->isUnique() || column->is_key_) {
+    unique_values_.emplace(columns_.size() - 1, std::unordered_set<std::string>());
+  }
+}
+
+void StorageTable::setMemoryParent(std::shared_ptr<MemoryTracker> parent) {
+  memory_->setParent(parent);  // stored rows keep the tracker to release themselves
 }
 
 size_t StorageTable::getRowsCount() const {
   return storage_->size();
 }
 
+size_t StorageTable::statsVersion() const {
+  return stats_version_;
+}
+
+void StorageTable::updateStatsVersion() {
+  size_t rows = storage_->size();
+  size_t drift = rows > stats_rows_ ? rows - stats_rows_ : stats_rows_ - rows;
+  if (drift > stats_rows_ / 10) {
+    stats_version_++;
+    stats_rows_ = rows;
+  }
+}
+
+void StorageTable::analyze() {
+  statistics_ = TableStatistics::create(*this);
+  stats_version_++;  // plans were built on guesses
+  stats_rows_ = storage_->size();
+}
+
+std::shared_ptr<const TableStatistics> StorageTable::statistics() const {
+  return statistics_;
+}
+
+bool StorageTable::isLeadingKey(const Column& column) const {
+  return !key_columns_.empty() && columns_[key_columns_.front()].get() == &column;
+}
+
+bool StorageTable::hasKeyRange(std::shared_ptr<Expr> predicate) const {
+  if (key_columns_.size() != 1) return false;
+  const Column& key = *columns_[key_columns_.front()];
+  DataType type = key.type().data_type;
+  if (type != DataType::INT32 && type != DataType::STRING) return false;
+
+  std::vector<KeyBound> bounds;
+  collectKeyBounds(predicate, key, name_, bounds);
+  return !bounds.empty();
+}
+
+std::shared_ptr<VirtualTable> StorageTable::range(std::shared_ptr<Expr> predicate) {
+  if (!hasKeyRange(predicate)) {
+    throw std::runtime_error("No key range in predicate");
+  }
+  size_t index = key_columns_.front();
+  const Column& key = *columns_[index];
+  std::vector<KeyBound> bounds;
+  collectKeyBounds(predicate, key, name_, bounds);
+
+  // Values of another type are left to the filter above the scan.
+  std::pair<std::shared_ptr<Cell>, std::shared_ptr<Cell>> cells;
+  if (key.type().data_type == DataType::INT32) {
+    KeyRange<int32_t> range;
+    for (const auto& bound : bounds) {
+      auto value = bound.value->type == kExprParameter ? bound.value->expr : bound.value;
+      if (value && value->type == kExprLiteralInt) range.apply(bound.op, value->ival);
+    }
+    cells = makeKeyRange(range, columns_.size(), index);
+  } else {
+    KeyRange<std::string> range;
+    for (const auto& bound : bounds) {
+      auto value = bound.value->type == kExprParameter ? bound.value->expr : bound.value;
+      if (value && value->type == kExprLiteralString) range.apply(bound.op, value->name);
+    }
+    cells = makeKeyRange(range, columns_.size(), index);
+  }
+  return RangeTable::create(shared_from_this(), cells.first, cells.second);
+}
+
 void StorageTable::insert(std::shared_ptr<InsertStatement> insertStatement) {
-  std::shared_ptr<Cell> cell = std::make_shared<Cell>();
-  if (insertStatement->insertType == InsertType::kInsertKeysValues) {
-    for (auto column : columns_) {
-      bool found = false;
-      for (const auto& columnValue : *insertStatement->columnValues) {
-        if (column->getName() == columnValue->name) {
-          cell->values.push_back(column->createValue(columnValue->value));
-          found = true;
-          break;
+  std::vector<std::vector<size_t>> pending(columns_.size());
+  auto cells = createCells(insertStatement, pending);
+  insert(cells, pending);
+}
+
+void StorageTable::insert(std::vector<std::shared_ptr<StoredCell>> cells,
+                          const std::vector<std::vector<size_t>>& pending) {
+  // Nothing is taken from the sequences until the batch is known to fit, a rejected batch
+  // frees its values with its cells.
+  size_t unique = checkUnique(cells);
+  for (size_t i = 0; i < columns_.size(); i++) {
+    if (unique_values_.count(i) > 0) {
+      unique += pending[i].size() * uniqueBytes(std::string(sizeof(int32_t), '\0'));
+    }
+  }
+  size_t bytes = unique;
+  for (const auto& cell : cells) {
+    bytes += cellBytes(*cell) + kRowOverhead;
+  }
+  for (const auto& rows : pending) {
+    bytes += rows.size() * sizeof(int32_t);
+  }
+  memory_->charge(bytes);
+  try {
+    for (size_t i = 0; i < columns_.size(); i++) {
+      if (!columns_[i]->sequence_) continue;
+      for (const auto& cell : cells) {  // keep the counter ahead of explicit values
+        if (!cell->isNull(i)) {
+          columns_[i]->sequence_->observe(cell->get<int32_t>(i));
         }
       }
-      if (!found) {
-        cell->values.push_back(column->createValue());
+      if (pending[i].empty()) continue;
+      SequenceRange range(*columns_[i]->sequence_, pending[i].size());
+      for (size_t row : pending[i]) {
+        cells[row]->values[i] = new int32_t(range.next());
       }
     }
-  } else {
-    for (size_t i = 0; i < columns_.size(); i++) {
-      if (i < insertStatement->columnValues->size()) {
-        cell->values.push_back(
-            columns_[i]->createValue(insertStatement->columnValues->at(i)->value));
-      } else {
-        cell->values.push_back(columns_[i]->createValue());
-      }
+  } catch (...) {  // the sequence is exhausted
+    memory_->release(bytes);
+    throw;
+  }
+  track(cells);  // the ids add up to what was charged for them
+  storage_->insert(std::vector<std::shared_ptr<Cell>>(cells.begin(), cells.end()));
+  size_t added = 0;
+  for (const auto& cell : cells) {
+    added += addUnique(*cell);
+  }
+  if (added < unique) {
+    memory_->release(unique - added);
+  }
+  if (statistics_) {
+    for (const auto& cell : cells) {
+      statistics_->add(*cell);
     }
   }
+  updateStatsVersion();
+}
 
-  std::vector<size_t> unique_columns;
-  for (size_t i = 0; i < columns_.size(); i++) {
-    if (columns_[i]->isUnique() || columns_[i]->is_key_) {
-      unique_columns.push_back(i);
-    }
+void StorageTable::track(const std::vector<std::shared_ptr<StoredCell>>& cells) {
+  for (const auto& cell : cells) {
+    cell->bytes = cellBytes(*cell) + kRowOverhead;
+    cell->memory = memory_;
   }
+}
 
-  std::shared_ptr<Row> newRow = std::make_shared<Row>(shared_from_this(), cell);
+std::vector<std::shared_ptr<StoredCell>> StorageTable::allocateRows(size_t count) const {
+  countAllocation(count * sizeof(StoredCell));
+  std::vector<std::shared_ptr<StoredCell>> cells;
+  cells.reserve(count);
+  for (size_t i = 0; i < count; i++) {
+    auto cell = std::make_shared<StoredCell>();
+    cell->types = value_types_;
+    cells.push_back(std::move(cell));
+  }
+  return cells;
+}
 
-  if (!unique_columns.empty()) {
-    auto it = getIterator();
-    bool unique = true;
-    while (it->hasValue()) {
-      auto row = *(*it);
-      ++(*it);
-      for (auto i : unique_columns) {
-        auto column = columns_[i];
-        switch (column->type().data_type) {
-          case DataType::INT32:
-            unique &= row->get<int32_t>(i) != newRow->get<int32_t>(i);
-            break;
-          case DataType::STRING:
-            unique &= row->get<std::string>(i) != newRow->get<std::string>(i);
-            break;
-          case DataType::BOOL:
-            unique &= row->get<bool>(i) != newRow->get<bool>(i);
-            break;
-          case DataType::BYTES:
-            unique &= row->get<std::vector<uint8_t>>(i) != newRow->get<std::vector<uint8_t>>(i);
-            break;
-          default:
-            throw std::runtime_error("Invalid data type");
+std::vector<std::shared_ptr<StoredCell>> StorageTable::createCells(
+    std::shared_ptr<InsertStatement> insertStatement, std::vector<std::vector<size_t>>& pending) {
+  const auto& rows = insertStatement->rows;
+  auto cells = allocateRows(rows.size());
+
+  for (size_t row = 0; row < rows.size(); row++) {
+    auto cell = cells[row];
+    cell->values.reserve(columns_.size());
+    for (size_t i = 0; i < columns_.size(); i++) {
+      std::shared_ptr<Expr> value;
+      if (insertStatement->insertType == InsertType::kInsertKeysValues) {
+        for (const auto& columnValue : *rows[row]) {
+          if (columns_[i]->getName() == columnValue->name) {
+            value = columnValue->value;
             break;
+          }
         }
+      } else if (i < rows[row]->size()) {
+        value = rows[row]->at(i)->value;
+      }
+
+      if (value) {
+        cell->values.push_back(columns_[i]->createValue(value));
+      } else if (columns_[i]->takesSequenceValue()) {
+        cell->values.push_back(nullptr);
+        pending[i].push_back(row);
+      } else {
+        cell->values.push_back(columns_[i]->createValue());
+      }
+    }
+  }
+  return cells;
+}
+
+size_t StorageTable::checkUnique(const std::vector<std::shared_ptr<StoredCell>>& cells) {
+  if (unique_values_.empty()) return 0;
+
+  // Each value is looked up among the stored ones and the batch's, never in the rows.
+  std::unordered_map<size_t, std::unordered_set<std::string>> batch;
+  uint64_t probes = 0;
+  size_t bytes = 0;
+  for (const auto& cell : cells) {
+    for (const auto& [i, stored] : unique_values_) {
+      if (cell->isNull(i)) continue;
+      probes++;
+      auto value = encodeValue(*cell, i, columns_[i]->type());
+      bytes += uniqueBytes(value);
+      if (stored.count(value) > 0 || !batch[i].insert(std::move(value)).second) {
+        unique_probes_.fetch_add(probes, std::memory_order_relaxed);
+        throw std::runtime_error("Duplicate key");
       }
     }
-    if (!unique) {
-      throw std::runtime_error("Duplicate key");
+  }
+  unique_probes_.fetch_add(probes, std::memory_order_relaxed);
+  return bytes;
+}
+
+size_t StorageTable::addUnique(const Cell& cell) {
+  size_t bytes = 0;
+  for (auto& [i, stored] : unique_values_) {
+    if (cell.isNull(i)) continue;
+    auto value = encodeValue(cell, i, columns_[i]->type());
+    size_t valueBytes = uniqueBytes(value);
+    if (stored.insert(std::move(value)).second) {
+      bytes += valueBytes;
     }
   }
+  return bytes;
+}
 
-  storage_->insert(cell);
+void StorageTable::removeUnique(const Cell& cell) {
+  for (auto& [i, stored] : unique_values_) {
+    if (cell.isNull(i)) continue;
+    auto value = encodeValue(cell, i, columns_[i]->type());
+    if (stored.erase(value) > 0) {
+      memory_->release(uniqueBytes(value));
+    }
+  }
 }
 
 void StorageTable::delete_(std::shared_ptr<DeleteStatement> deleteStatement) {
@@ -213,11 +585,16 @@ void StorageTable::delete_(std::shared_ptr<DeleteStatement> deleteStatement) {
       throw std::runtime_error("Expected boolean expression");
     }
     if (expr->ival) {
+      if (statistics_) {
+        statistics_->remove(*row->cell_);
+      }
+      removeUnique(*row->cell_);
       storage_->remove(it->getMemoryIterator());
     } else {
       ++(*it);
     }
   }
+  updateStatsVersion();
 }
 
 void StorageTable::update(std::shared_ptr<UpdateStatement> updateStatement) {
@@ -228,6 +605,14 @@ std::shared_ptr<VirtualTable> StorageTable::filter(std::shared_ptr<Expr> whereCl
   return FilteredTable::create(shared_from_this(), whereClause);
 }
 
+uint64_t StorageTable::rowsScanned() const {
+  return rows_scanned_.load(std::memory_order_relaxed);
+}
+
+uint64_t StorageTable::uniqueProbes() const {
+  return unique_probes_.load(std::memory_order_relaxed);
+}
+
 std::shared_ptr<TableIterator> StorageTable::getIterator() {
   return std::make_shared<StorageTableIterator>(shared_from_this(), storage_->getIterator());
 }
@@ -8,6 +8,7 @@
 #include <vector>
 
 #include "column.h"
+#include "memory/arena.h"
 #include "memory/iterator.h"
 #include "row.h"
 #include "sql/column_type.h"
@@ -20,12 +21,17 @@ StorageTableIterator::StorageTableIterator(std::shared_ptr<StorageTable> table,
                                            std::shared_ptr<Iterator> iterator)
     : iterator_(iterator), table_(table) {}
 
+StorageTableIterator::~StorageTableIterator() {
+  table_->rows_scanned_.fetch_add(scanned_, std::memory_order_relaxed);
+}
+
 bool StorageTableIterator::hasValue() const {
   return iterator_->hasValue();
 }
 
 std::shared_ptr<Row> StorageTableIterator::operator*() {
-  return std::make_shared<Row>(table_, iterator_->get());
+  scanned_++;
+  return std::allocate_shared<Row>(ArenaAllocator<Row>(rows_.get()), table_, iterator_->get());
 }
 
 StorageTableIterator& StorageTableIterator::operator++() {
@@ -41,6 +47,11 @@ ColumnType ITable::predictType(std::shared_ptr<Expr> expr) {
   if (expr->type == kExprColumnRef) {
     auto column = getColumn(expr);
     return column->type();
+  } else if (expr->type == kExprParameter) {
+    if (!expr->expr) {
+      throw std::runtime_error("Parameter is not bound: " + std::to_string(expr->ival));
+    }
+    return predictType(expr->expr);
   } else if (expr->type == kExprLiteralInt) {
     return ColumnType(DataType::INT32);
   } else if (expr->type == kExprLiteralString) {
@@ -97,21 +108,74 @@ ColumnType ITable::predictType(std::shared_ptr<Expr> expr) {
   }
 }
 
+TrackedCell::~TrackedCell() {
+  if (memory) memory->release(bytes);
+}
+
+StoredCell::~StoredCell() {
+  for (size_t i = 0; i < values.size(); i++) {
+    freeValue((*types)[i], values[i]);
+  }
+}
+
 const std::string& ITable::getName() const {
   return name_;
 }
 
+const std::shared_ptr<MemoryTracker>& ITable::memory() const {
+  return memory_;
+}
+
+size_t ITable::cellBytes(const Cell& cell) const {
+  size_t bytes = sizeof(Cell) + cell.values.capacity() * sizeof(void*);
+  for (size_t i = 0; i < cell.values.size() && i < columns_.size(); i++) {
+    if (!cell.values[i]) continue;
+    const ColumnType& type = columns_[i]->type();
+    switch (type.data_type) {
+      case DataType::INT32:
+        bytes += sizeof(int32_t);
+        break;
+      case DataType::BOOL:
+        bytes += sizeof(bool);
+        break;
+      case DataType::STRING: {
+        auto value = static_cast<const std::string*>(cell.values[i]);
+        bytes += sizeof(std::string);
+        if (value->capacity() > 15) bytes += value->capacity() + 1;  // not stored inline
+      } break;
+      case DataType::BYTES:
+        bytes += type.length;
+        break;
+      default:
+        break;
+    }
+  }
+  return bytes;
+}
+
+void ITable::charge(TrackedCell& cell) const {
+  if (!memory_) return;
+  size_t bytes = cellBytes(cell);
+  memory_->charge(bytes);
+  cell.memory = memory_;
+  cell.bytes = bytes;
+}
+
 const std::vector<std::shared_ptr<Column>>& ITable::getColumns() {
   return columns_;
 }
 
 std::shared_ptr<Column> ITable::getColumn(std::shared_ptr<Expr> columnExpr) {
   if (columnExpr->type == kExprColumnRef) {
+    std::shared_ptr<Column> byName;  // qualifier naming a derived table
     for (const auto& column : columns_) {
-      if (column->getName() == columnExpr->name) {
+      if (column->getName() != columnExpr->name) continue;
+      if (columnExpr->table.empty() || column->isFrom(columnExpr->table)) {
         return column;
       }
+      if (!byName) byName = column;
     }
+    if (byName) return byName;
   } else {
     throw std::runtime_error("Unsupported expression type: " + columnExpr->toString());
   }
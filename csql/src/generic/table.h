@@ -1,19 +1,26 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
 #include <memory>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include "../memory/iterator.h"
+#include "../memory/memory_tracker.h"
 #include "../memory/storage.h"
 #include "../sql/statements/create.h"
 #include "../sql/statements/insert.h"
 #include "column.h"
+#include "hardware_counters.h"
 #include "row.h"
 #include "sql/column_type.h"
 #include "sql/statements/delete.h"
 #include "sql/statements/select.h"
 #include "sql/statements/update.h"
+#include "table_locks.h"
 
 namespace csql {
 namespace storage {
@@ -25,6 +32,7 @@ class WhereClauseIterator;
 class FilteredTable;
 class Row;
 class Column;
+class TableStatistics;
 
 class TableIterator {
  public:
@@ -39,6 +47,23 @@ class TableIterator {
 
 class VirtualTable;
 
+// A row built by an operator, its bytes charged to the operator's tracker until it is
+// destroyed, see ITable::charge.
+struct TrackedCell : public Cell {
+  ~TrackedCell() override;
+
+  std::shared_ptr<MemoryTracker> memory;
+  size_t bytes = 0;
+};
+
+// A row of a StorageTable, owning its values. They are freed, and its bytes released, when
+// the last reference goes: the table's storage, or an iterator still holding a deleted row.
+struct StoredCell : public TrackedCell {
+  ~StoredCell() override;
+
+  std::shared_ptr<const std::vector<DataType>> types;  // of the values, by column
+};
+
 class ITable {
  public:
   virtual ~ITable() = default;
@@ -60,9 +85,18 @@ class ITable {
 
   virtual void exportToCSV(const std::string& filename);
 
+  // Bytes held by the table, or by the operator while it runs; nullptr when it holds none.
+  const std::shared_ptr<MemoryTracker>& memory() const;
+
  protected:
+  // Estimated heap bytes of `cell`, a row of this table.
+  size_t cellBytes(const Cell& cell) const;
+  // Charges `cell` to memory_, throws MemoryLimitExceeded.
+  void charge(TrackedCell& cell) const;
+
   std::vector<std::shared_ptr<Column>> columns_;
   std::string name_;
+  std::shared_ptr<MemoryTracker> memory_;
 };  // namespace storage
 
 class StorageTable : public ITable, public std::enable_shared_from_this<StorageTable> {
@@ -82,14 +116,69 @@ class StorageTable : public ITable, public std::enable_shared_from_this<StorageT
   std::shared_ptr<TableIterator> getIterator() override;
 
   size_t getRowsCount() const;
+  // Bumped whenever the row count drifts by more than a tenth, plans built on older
+  // statistics should be replanned.
+  size_t statsVersion() const;
+  bool isLeadingKey(const Column& column) const;  // storage is ordered by this column
+  // Moves the table's memory under `parent`, throws MemoryLimitExceeded when it does not fit.
+  void setMemoryParent(std::shared_ptr<MemoryTracker> parent);
+
+  // Collects column statistics, maintained on insert and delete from then on.
+  void analyze();
+  // nullptr until the table is analyzed.
+  std::shared_ptr<const TableStatistics> statistics() const;
+
+  // Rows read by its iterators, counted when an iterator is released.
+  uint64_t rowsScanned() const;
+  // Values looked up to check UNIQUE and KEY columns on insert.
+  uint64_t uniqueProbes() const;
+
+  // Whether `predicate` compares the key against literals or parameters, see range().
+  bool hasKeyRange(std::shared_ptr<Expr> predicate) const;
+  // Rows whose key satisfies the key comparisons of `predicate`, looked up in the ordered
+  // storage. Parameters are read at call time; the rest of the predicate is not checked.
+  std::shared_ptr<VirtualTable> range(std::shared_ptr<Expr> predicate);
 
  private:
   void addColumn(std::shared_ptr<Column> column);
+  // Empty rows for this table, one allocation each so that a deleted row is freed alone.
+  std::vector<std::shared_ptr<StoredCell>> allocateRows(size_t count) const;
+  std::vector<std::shared_ptr<StoredCell>> createCells(
+      std::shared_ptr<InsertStatement> insertStatement, std::vector<std::vector<size_t>>& pending);
+  // Assigns AUTOINCREMENT values to `pending[column]` rows, validates and stores the batch.
+  void insert(std::vector<std::shared_ptr<StoredCell>> cells,
+              const std::vector<std::vector<size_t>>& pending);
+  // Hands the bytes charged for `cells` over to the rows, released when they are destroyed.
+  void track(const std::vector<std::shared_ptr<StoredCell>>& cells);
+  // Throws when a value of a UNIQUE or KEY column is stored already or repeated in `cells`,
+  // returns the bytes their values will take in unique_values_ otherwise.
+  size_t checkUnique(const std::vector<std::shared_ptr<StoredCell>>& cells);
+  // Adds the values of `cell` to unique_values_ and returns their bytes, for the caller to
+  // charge. Removing them releases their bytes.
+  size_t addUnique(const Cell& cell);
+  void removeUnique(const Cell& cell);
+  void updateStatsVersion();
 
   std::shared_ptr<IStorage> storage_;
+  std::vector<size_t> key_columns_;
+  std::shared_ptr<std::vector<DataType>> value_types_ = std::make_shared<std::vector<DataType>>();
+  size_t stats_version_ = 0;
+  size_t stats_rows_ = 0;  // row count at the last stats version bump
+  std::shared_ptr<TableStatistics> statistics_;
+  std::atomic<uint64_t> rows_scanned_{0};
+  std::atomic<uint64_t> unique_probes_{0};
+  // Encoded values of each UNIQUE and KEY column, by column index, charged to memory_.
+  std::unordered_map<size_t, std::unordered_set<std::string>> unique_values_;
+  // Shared by the statements reading the table, exclusive to one changing it, see TableLocks.
+  TableLock lock_;
   friend class TableIterator;
+  friend class StorageTableIterator;
   friend class Column;
   friend class Row;
+  friend class Appender;
+  friend class RangeTable;
+  friend class TableStatistics;
+  friend class TableLocks;
 
   friend std::ostream& operator<<(std::ostream& stream, const Row& row);
 };
@@ -97,7 +186,7 @@ class StorageTable : public ITable, public std::enable_shared_from_this<StorageT
 class StorageTableIterator : public TableIterator {
  public:
   StorageTableIterator(std::shared_ptr<StorageTable> table, std::shared_ptr<Iterator> iterator);
-  virtual ~StorageTableIterator() = default;
+  virtual ~StorageTableIterator();
 
   virtual bool hasValue() const override;
   virtual StorageTableIterator& operator++() override;
@@ -107,6 +196,8 @@ class StorageTableIterator : public TableIterator {
  protected:
   std::shared_ptr<StorageTable> table_;
   std::shared_ptr<Iterator> iterator_;
+  uint64_t scanned_ = 0;  // rows read, added to the table once released
+  BatchArena rows_;
   friend class StorageTable;
 };
 
@@ -121,25 +212,46 @@ class VirtualTable : public ITable, public std::enable_shared_from_this<VirtualT
   std::shared_ptr<VirtualTable> filter(std::shared_ptr<Expr> whereClause) override;
 };
 
+enum class JoinStrategy {
+  kNestedLoop,      // rescan the right side for every left row
+  kHashBuildLeft,   // hash the left side, probe with the right one
+  kHashBuildRight,  // hash the right side, probe with the left one
+};
+
 class JoinTable : public VirtualTable {
  public:
   JoinTable(std::shared_ptr<ITable> left, std::shared_ptr<ITable> right,
-            std::shared_ptr<Expr> onClause, OperatorType joinType);
-  static std::shared_ptr<JoinTable> create(std::shared_ptr<ITable> left,
-                                           std::shared_ptr<ITable> right,
-                                           std::shared_ptr<Expr> onClause, OperatorType joinType);
+            std::shared_ptr<Expr> onClause, OperatorType joinType,
+            JoinStrategy strategy = JoinStrategy::kNestedLoop);
+  // Only the columns `columns` may refer to are carried, every column when nullptr.
+  static std::shared_ptr<JoinTable> create(
+      std::shared_ptr<ITable> left, std::shared_ptr<ITable> right, std::shared_ptr<Expr> onClause,
+      OperatorType joinType, JoinStrategy strategy = JoinStrategy::kNestedLoop,
+      std::shared_ptr<std::vector<std::shared_ptr<Expr>>> columns = nullptr);
   virtual ~JoinTable() = default;
 
+  // Hash strategies fall back to the nested loop when the ON clause has no equality
+  // between a left and a right column.
   std::shared_ptr<TableIterator> getIterator() override;
 
   friend class JoinTableIterator;
   friend class InnerJoinIterator;
+  friend class HashJoinIterator;
 
  private:
+  // The row and its values are allocated in `arena`.
+  std::shared_ptr<Row> merge(std::shared_ptr<Row> left, std::shared_ptr<Row> right,
+                             const std::shared_ptr<Arena>& arena);
+  // Pairs of (left, right) column indices compared with = in the ON clause.
+  std::vector<std::pair<size_t, size_t>> equalityKeys();
+  bool isReferenced(const Column& column, const std::vector<std::shared_ptr<Expr>>& columns) const;
+
   std::shared_ptr<ITable> left_;
   std::shared_ptr<ITable> right_;
   std::shared_ptr<Expr> onClause_;
   OperatorType joinType_;
+  JoinStrategy strategy_;
+  std::vector<size_t> sources_;  // per column, its index among the left then right columns
 };
 
 class JoinTableIterator : public TableIterator {
@@ -156,8 +268,10 @@ class JoinTableIterator : public TableIterator {
   std::shared_ptr<TableIterator> leftTableIterator_;
   std::shared_ptr<TableIterator> rightTableIterator_;
   std::shared_ptr<Row> row_;
+  BatchArena rows_;
 
   bool match();
+  // Starts the right side over for the next left row, if there is one.
   void resetRight();
   std::shared_ptr<Row> mergeRows();
 };
@@ -169,6 +283,35 @@ class InnerJoinIterator : public JoinTableIterator {
   InnerJoinIterator& operator++() override;
 };
 
+// Inner equi-join: hashes the build side once, then looks every probe row up.
+class HashJoinIterator : public TableIterator {
+ public:
+  HashJoinIterator(std::shared_ptr<JoinTable> table, bool buildLeft,
+                   const std::vector<std::pair<size_t, size_t>>& keys);
+  virtual ~HashJoinIterator();
+
+  bool hasValue() const override;
+  HashJoinIterator& operator++() override;
+  std::shared_ptr<Row> operator*() override;
+  std::shared_ptr<Iterator> getMemoryIterator() override;
+
+ private:
+  void findMatch();  // moves to the next build/probe pair satisfying the ON clause
+  static bool joinKey(Row& row, const std::vector<size_t>& columns, std::string& key);
+
+  std::shared_ptr<JoinTable> table_;
+  bool buildLeft_;
+  std::vector<size_t> buildKeys_;
+  std::vector<size_t> probeKeys_;
+  std::unordered_map<std::string, std::vector<std::shared_ptr<Row>>> buckets_;
+  std::shared_ptr<TableIterator> probe_;
+  const std::vector<std::shared_ptr<Row>>* matches_ = nullptr;  // bucket of the probe row
+  size_t match_ = 0;
+  std::shared_ptr<Row> row_;
+  size_t charged_ = 0;  // bytes of buckets_
+  BatchArena rows_;
+};
+
 class OuterJoinIterator : public JoinTableIterator {
  public:
   OuterJoinIterator(std::shared_ptr<JoinTable> table);
@@ -176,11 +319,49 @@ class OuterJoinIterator : public JoinTableIterator {
   OuterJoinIterator& operator++() override;
 };
 
+// The conjuncts of a where clause, evaluated one after another until one rejects the row, in
+// an order learned from the rows seen: every kReorderInterval rows they are sorted by cost per
+// row over the fraction of rows they reject, so that cheap and selective ones run first. The
+// cost is timed on one row in kSampleInterval. A conjunct with a division may raise on the
+// rows the ones before it reject, so none moves across it.
+class ConjunctOrder {
+ public:
+  static constexpr size_t kReorderInterval = 1024;
+  static constexpr size_t kSampleInterval = 16;
+
+  ConjunctOrder(std::shared_ptr<Expr> whereClause);
+
+  bool accepts(Row& row);
+  // In the order they are evaluated in.
+  std::vector<std::shared_ptr<Expr>> getConjuncts() const;
+
+ private:
+  struct Conjunct {
+    std::shared_ptr<Expr> expr;
+    bool divides = false;
+    size_t evaluated = 0;
+    size_t passed = 0;
+    size_t sampled = 0;
+    double nanoseconds = 0;  // spent on the sampled rows
+  };
+  void reorder();
+
+  std::vector<Conjunct> conjuncts_;
+  size_t rows_ = 0;
+};
+
+// Rows examined and accepted by a where clause, summed over the iterators of a filter step.
+struct FilterCounts {
+  std::atomic<uint64_t> examined{0};
+  std::atomic<uint64_t> passed{0};
+};
+
 class WhereClauseIterator : public TableIterator {
  public:
   WhereClauseIterator(std::shared_ptr<TableIterator> tableIterator,
-                      std::shared_ptr<Expr> whereClause);
-  virtual ~WhereClauseIterator() = default;
+                      std::shared_ptr<ConjunctOrder> conjuncts,
+                      std::shared_ptr<FilterCounts> counts = nullptr);
+  virtual ~WhereClauseIterator();  // adds its rows to the counts
 
   bool hasValue() const override;
   WhereClauseIterator& operator++() override;
@@ -188,16 +369,26 @@ class WhereClauseIterator : public TableIterator {
   std::shared_ptr<Iterator> getMemoryIterator() override;
 
  protected:
+  // Moves to the next row accepted by the where clause, starting with the current one.
+  void skipRejected();
+  void flushCounts();
+
   std::shared_ptr<TableIterator> tableIterator_;
-  std::shared_ptr<Expr> whereClause_;
+  std::shared_ptr<ConjunctOrder> conjuncts_;
+  std::shared_ptr<Row> row_;  // the accepted row, already evaluated by the where clause
+  std::shared_ptr<FilterCounts> counts_;
+  uint64_t examined_ = 0;
+  uint64_t passed_ = 0;
   friend class StorageTable;
 };
 
 class FilteredTable : public VirtualTable {
  public:
-  FilteredTable(std::shared_ptr<ITable> table, std::shared_ptr<Expr> whereClause);
+  FilteredTable(std::shared_ptr<ITable> table, std::shared_ptr<Expr> whereClause,
+                std::shared_ptr<FilterCounts> counts = nullptr);
   static std::shared_ptr<FilteredTable> create(std::shared_ptr<ITable> table,
-                                               std::shared_ptr<Expr> whereClause);
+                                               std::shared_ptr<Expr> whereClause,
+                                               std::shared_ptr<FilterCounts> counts = nullptr);
   virtual ~FilteredTable() = default;
 
   std::shared_ptr<TableIterator> getIterator() override;
@@ -210,6 +401,26 @@ class FilteredTable : public VirtualTable {
  private:
   std::shared_ptr<ITable> table_;
   std::shared_ptr<Expr> whereClause_;
+  std::shared_ptr<ConjunctOrder> conjuncts_;  // shared by the iterators, which learn its order
+  std::shared_ptr<FilterCounts> counts_;      // nullptr when not counted
+};
+
+// Rows of a storage table with start <= key < end, nullptr meaning unbounded.
+class RangeTable : public VirtualTable {
+ public:
+  RangeTable(std::shared_ptr<StorageTable> table, std::shared_ptr<Cell> start,
+             std::shared_ptr<Cell> end);
+  static std::shared_ptr<RangeTable> create(std::shared_ptr<StorageTable> table,
+                                            std::shared_ptr<Cell> start,
+                                            std::shared_ptr<Cell> end);
+  virtual ~RangeTable() = default;
+
+  std::shared_ptr<TableIterator> getIterator() override;
+
+ private:
+  std::shared_ptr<StorageTable> table_;
+  std::shared_ptr<Cell> start_;
+  std::shared_ptr<Cell> end_;
 };
 
 class EvaluatedTable;
@@ -226,6 +437,7 @@ class EvaluateIterator : public TableIterator {
  protected:
   std::shared_ptr<EvaluatedTable> table_;
   std::shared_ptr<TableIterator> it_;
+  BatchArena rows_;
   friend class EvaluatedTable;
 };
 
@@ -251,5 +463,50 @@ class EvaluatedTable : public VirtualTable {
   std::shared_ptr<std::vector<std::shared_ptr<Expr>>> expressions_;
 };
 
+// What a plan step did while run by EXPLAIN ANALYZE, summed over the iterators it opened.
+// Times and allocations include the steps below it.
+struct OperatorStats {
+  size_t loops = 0;  // iterators opened
+  size_t rows = 0;   // rows produced
+  uint64_t wall_ns = 0;
+  uint64_t cpu_ns = 0;  // of the executing thread
+  size_t allocations = 0;
+  bool counted = false;  // whether `counters` were read, see HardwareCounters
+  HardwareCounts counters;
+};
+
+// Passes the rows of `table` through, counting them into `stats` along with the time and the
+// allocations spent producing them.
+class ProfiledTable : public VirtualTable {
+ public:
+  ProfiledTable(std::shared_ptr<ITable> table, std::shared_ptr<OperatorStats> stats);
+  static std::shared_ptr<ProfiledTable> create(std::shared_ptr<ITable> table,
+                                               std::shared_ptr<OperatorStats> stats);
+  virtual ~ProfiledTable() = default;
+
+  std::shared_ptr<TableIterator> getIterator() override;
+
+  friend class ProfiledIterator;
+
+ private:
+  std::shared_ptr<ITable> table_;
+  std::shared_ptr<OperatorStats> stats_;
+};
+
+class ProfiledIterator : public TableIterator {
+ public:
+  ProfiledIterator(std::shared_ptr<ProfiledTable> table);
+  virtual ~ProfiledIterator() = default;
+
+  bool hasValue() const override;
+  ProfiledIterator& operator++() override;
+  std::shared_ptr<Row> operator*() override;
+  std::shared_ptr<Iterator> getMemoryIterator() override;
+
+ private:
+  std::shared_ptr<ProfiledTable> table_;
+  std::shared_ptr<TableIterator> it_;
+};
+
 }  // namespace storage
 }  // namespace csql
\ No newline at end of file
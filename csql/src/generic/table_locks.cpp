@@ -0,0 +1,172 @@
+#include "table_locks.h"
+
+#include <algorithm>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_set>
+#include <utility>
+
+#include "table.h"
+
+namespace csql {
+namespace storage {
+
+namespace {
+
+std::mutex locks_mutex;  // guards every TableLock and `waits`
+
+struct Wait {
+  const TableLock* lock;
+  bool exclusive;
+};
+
+std::unordered_map<std::thread::id, Wait> waits;  // threads blocked in TableLock::lock
+
+}  // namespace
+
+TableLock::Outcome TableLock::lock(std::thread::id owner, bool exclusive) {
+  std::unique_lock<std::mutex> guard(locks_mutex);
+  if (writes_ > 0 && writer_ == owner) {
+    if (exclusive) {
+      writes_++;
+    } else {
+      readers_[owner]++;
+    }
+    return Outcome::kLocked;
+  }
+  auto reader = readers_.find(owner);
+  if (reader != readers_.end()) {
+    if (exclusive) return Outcome::kReadByOwner;
+    reader->second++;  // does not queue behind a waiting writer it would block
+    return Outcome::kLocked;
+  }
+  if (!available(exclusive)) {
+    if (exclusive) waiting_writers_.push_back(owner);
+    waits[owner] = Wait{this, exclusive};
+    Outcome outcome = Outcome::kLocked;
+    while (!available(exclusive)) {
+      if (closesCycle(owner, exclusive)) {
+        outcome = Outcome::kDeadlock;
+        break;
+      }
+      released_.wait(guard);
+    }
+    waits.erase(owner);
+    if (exclusive) {
+      waiting_writers_.erase(
+          std::find(waiting_writers_.begin(), waiting_writers_.end(), owner));
+    }
+    if (outcome != Outcome::kLocked) {
+      released_.notify_all();  // readers queued behind this writer
+      return outcome;
+    }
+  }
+  if (exclusive) {
+    writer_ = owner;
+    writes_ = 1;
+  } else {
+    readers_[owner] = 1;
+  }
+  return Outcome::kLocked;
+}
+
+void TableLock::unlock(std::thread::id owner, bool exclusive) {
+  {
+    std::lock_guard<std::mutex> guard(locks_mutex);
+    if (exclusive) {
+      if (--writes_ == 0) writer_ = std::thread::id();
+    } else {
+      auto reader = readers_.find(owner);
+      if (--reader->second == 0) readers_.erase(reader);
+    }
+  }
+  released_.notify_all();
+}
+
+bool TableLock::available(bool exclusive) const {
+  if (exclusive) return writes_ == 0 && readers_.empty();
+  return writes_ == 0 && waiting_writers_.empty();
+}
+
+std::vector<std::thread::id> TableLock::blockers(std::thread::id thread, bool exclusive) const {
+  std::vector<std::thread::id> threads;
+  if (writes_ > 0 && writer_ != thread) {
+    threads.push_back(writer_);
+  }
+  if (exclusive) {
+    for (const auto& [reader, holds] : readers_) {
+      if (reader != thread) threads.push_back(reader);
+    }
+  } else {
+    for (auto writer : waiting_writers_) {
+      if (writer != thread) threads.push_back(writer);
+    }
+  }
+  return threads;
+}
+
+bool TableLock::closesCycle(std::thread::id owner, bool exclusive) const {
+  // Follows the threads in the way to the locks they wait for, looking for `owner`
+  std::vector<std::pair<std::thread::id, Wait>> pending = {{owner, Wait{this, exclusive}}};
+  std::unordered_set<std::thread::id> seen;
+  while (!pending.empty()) {
+    auto [thread, wait] = pending.back();
+    pending.pop_back();
+    for (auto blocker : wait.lock->blockers(thread, wait.exclusive)) {
+      if (blocker == owner) return true;
+      if (!seen.insert(blocker).second) continue;
+      auto blocked = waits.find(blocker);
+      if (blocked != waits.end()) {
+        pending.emplace_back(blocker, blocked->second);
+      }
+    }
+  }
+  return false;
+}
+
+TableLocks::~TableLocks() {
+  for (auto it = locks_.rbegin(); it != locks_.rend(); ++it) {
+    if (it->second.held) {
+      it->second.table->lock_.unlock(owner_, it->second.exclusive);
+    }
+  }
+}
+
+void TableLocks::read(std::shared_ptr<StorageTable> table) {
+  add(table, false);
+}
+
+void TableLocks::write(std::shared_ptr<StorageTable> table) {
+  add(table, true);
+}
+
+void TableLocks::add(std::shared_ptr<StorageTable> table, bool exclusive) {
+  if (!table) return;
+  auto& lock = locks_[table.get()];
+  if (lock.held) {
+    throw std::runtime_error("Tables are already locked");
+  }
+  lock.table = table;
+  lock.exclusive = lock.exclusive || exclusive;
+}
+
+void TableLocks::acquire() {
+  owner_ = std::this_thread::get_id();
+  for (auto& [key, lock] : locks_) {
+    if (lock.held) continue;
+    switch (lock.table->lock_.lock(owner_, lock.exclusive)) {
+      case TableLock::Outcome::kLocked:
+        break;
+      case TableLock::Outcome::kReadByOwner:
+        throw std::runtime_error("Table is read by a query still open on this thread: " +
+                                 lock.table->getName());
+      case TableLock::Outcome::kDeadlock:
+        throw std::runtime_error("Deadlock waiting for table " + lock.table->getName() +
+                                 ", held by a thread waiting for this one");
+    }
+    lock.held = true;
+  }
+}
+
+}  // namespace storage
+}  // namespace csql
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace csql {
+namespace storage {
+
+class StorageTable;
+
+// Reader/writer lock of a stored table. Holds are recorded with the thread they are taken
+// for, so that thread can take the table again while it holds it, and can be given back
+// from any thread. New readers queue behind waiting writers. All table locks share one
+// mutex, so that a thread about to wait can follow who waits for whom and fail instead of
+// closing a cycle.
+class TableLock {
+ public:
+  enum class Outcome {
+    kLocked,
+    kReadByOwner,  // `owner` reads the table and asked to write it, it would wait for itself
+    kDeadlock,     // `owner` would wait for a thread that waits for it
+  };
+
+  // Blocks until `owner` holds the table, unless the outcome is an error.
+  Outcome lock(std::thread::id owner, bool exclusive);
+  void unlock(std::thread::id owner, bool exclusive);
+
+ private:
+  bool available(bool exclusive) const;
+  // Threads that keep `thread` from taking the lock.
+  std::vector<std::thread::id> blockers(std::thread::id thread, bool exclusive) const;
+  bool closesCycle(std::thread::id owner, bool exclusive) const;
+
+  std::condition_variable released_;
+  std::unordered_map<std::thread::id, size_t> readers_;  // shared holds by thread
+  std::thread::id writer_;                               // holds exclusively, when writes_ > 0
+  size_t writes_ = 0;
+  std::vector<std::thread::id> waiting_writers_;
+};
+
+// Locks a statement holds on the stored tables it touches: shared on the ones it reads,
+// exclusive on the ones it changes. They are all taken by acquire(), in address order so
+// that statements never wait on each other in a cycle, and released with the object, on
+// whichever thread drops it.
+//
+// The locks are taken for the thread calling acquire(). A statement reading a table that a
+// query still open on the same thread reads goes ahead, one writing it throws instead of
+// waiting for itself. Threads that keep queries open while they write other tables can
+// still wait on each other in a cycle: the statement that would close it throws instead.
+class TableLocks {
+ public:
+  TableLocks() = default;
+  TableLocks(const TableLocks&) = delete;
+  TableLocks& operator=(const TableLocks&) = delete;
+  virtual ~TableLocks();
+
+  void read(std::shared_ptr<StorageTable> table);
+  void write(std::shared_ptr<StorageTable> table);
+
+  // Blocks until every table added is locked.
+  void acquire();
+
+ private:
+  struct Lock {
+    std::shared_ptr<StorageTable> table;
+    bool exclusive = false;
+    bool held = false;
+  };
+
+  void add(std::shared_ptr<StorageTable> table, bool exclusive);
+
+  std::map<const StorageTable*, Lock> locks_;  // ordered by address
+  std::thread::id owner_;                      // the thread the locks were taken for
+};
+
+}  // namespace storage
+}  // namespace csql
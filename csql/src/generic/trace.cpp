@@ -0,0 +1,166 @@
+#include "trace.h"
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+thread_local uint32_t thread_number = 0;  // 0 until the thread records something
+thread_local uint32_t span_depth = 0;
+std::atomic<uint32_t> threads{0};
+
+csql::storage::TraceRing& ring() {
+  static csql::storage::TraceRing ring(csql::storage::Tracer::kCapacity);
+  return ring;
+}
+
+const char* levelName(csql::storage::TraceLevel level) {
+  switch (level) {
+    case csql::storage::TraceLevel::kError:
+      return "ERROR";
+    case csql::storage::TraceLevel::kWarning:
+      return "WARNING";
+    case csql::storage::TraceLevel::kInfo:
+      return "INFO";
+    case csql::storage::TraceLevel::kDebug:
+      return "DEBUG";
+    case csql::storage::TraceLevel::kTrace:
+      return "TRACE";
+    default:
+      return "OFF";
+  }
+}
+
+}  // namespace
+
+namespace csql {
+namespace storage {
+
+std::ostream& operator<<(std::ostream& stream, const TraceEvent& event) {
+  stream << event.timestamp_ns << " [" << event.thread << "] " << levelName(event.level) << " "
+         << std::string(event.depth * 2, ' ') << event.message;
+  if (event.duration_ns) {
+    stream << " " << event.duration_ns << " ns";
+  }
+  return stream;
+}
+
+TraceRing::TraceRing(size_t capacity) {
+  size_t size = 1;
+  while (size < capacity) size <<= 1;
+  slots_.reset(new Slot[size]);
+  for (size_t i = 0; i < size; i++) {
+    slots_[i].sequence.store(i, std::memory_order_relaxed);
+  }
+  mask_ = size - 1;
+}
+
+bool TraceRing::push(TraceEvent event) {
+  size_t position = write_.load(std::memory_order_relaxed);
+  while (true) {
+    Slot& slot = slots_[position & mask_];
+    size_t sequence = slot.sequence.load(std::memory_order_acquire);
+    if (sequence == position) {
+      if (write_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+        slot.event = std::move(event);
+        slot.sequence.store(position + 1, std::memory_order_release);
+        return true;
+      }
+    } else if (sequence < position) {  // not read yet since the last round
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    } else {
+      position = write_.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+bool TraceRing::pop(TraceEvent& event) {
+  size_t position = read_.load(std::memory_order_relaxed);
+  while (true) {
+    Slot& slot = slots_[position & mask_];
+    size_t sequence = slot.sequence.load(std::memory_order_acquire);
+    if (sequence == position + 1) {
+      if (read_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+        event = std::move(slot.event);
+        slot.sequence.store(position + mask_ + 1, std::memory_order_release);
+        return true;
+      }
+    } else if (sequence < position + 1) {  // nothing published there yet
+      return false;
+    } else {
+      position = read_.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+size_t TraceRing::dropped() const {
+  return dropped_.load(std::memory_order_relaxed);
+}
+
+std::atomic<int> Tracer::level_{static_cast<int>(TraceLevel::kOff)};
+
+void Tracer::setLevel(TraceLevel level) {
+  level_.store(static_cast<int>(level), std::memory_order_relaxed);
+}
+
+TraceLevel Tracer::level() {
+  return static_cast<TraceLevel>(level_.load(std::memory_order_relaxed));
+}
+
+void Tracer::emit(TraceLevel level, std::string message) {
+  while (!message.empty() && message.back() == '\n') {
+    message.pop_back();
+  }
+  emit(TraceEvent{level, now(), 0, thread(), span_depth, std::move(message)});
+}
+
+void Tracer::emit(TraceEvent event) {
+  ring().push(std::move(event));
+}
+
+size_t Tracer::drain(std::vector<TraceEvent>& events) {
+  size_t count = 0;
+  TraceEvent event;
+  while (ring().pop(event)) {
+    events.push_back(std::move(event));
+    count++;
+  }
+  return count;
+}
+
+size_t Tracer::dropped() {
+  return ring().dropped();
+}
+
+uint64_t Tracer::now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+uint32_t Tracer::thread() {
+  if (!thread_number) {
+    thread_number = threads.fetch_add(1, std::memory_order_relaxed) + 1;
+  }
+  return thread_number;
+}
+
+void TraceSpan::start(TraceLevel level, const char* name) {
+  level_ = level;
+  name_ = name;
+  start_ = Tracer::now();
+  span_depth++;
+}
+
+void TraceSpan::finish() {
+  span_depth--;
+  uint64_t end = Tracer::now();
+  Tracer::emit(TraceEvent{level_, start_, end - start_, Tracer::thread(), span_depth, name_});
+}
+
+}  // namespace storage
+}  // namespace csql
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Levels above this one are compiled out, 0 leaves no tracing at all.
+#ifndef CSQL_TRACE_LEVEL
+#define CSQL_TRACE_LEVEL 5
+#endif
+
+namespace csql {
+namespace storage {
+
+enum class TraceLevel {
+  kOff = 0,
+  kError = 1,
+  kWarning = 2,
+  kInfo = 3,   // spans around parse, plan, optimize and execute
+  kDebug = 4,  // statements
+  kTrace = 5,  // plan steps
+};
+
+struct TraceEvent {
+  TraceLevel level;
+  uint64_t timestamp_ns;  // steady clock, the start of a span
+  uint64_t duration_ns;   // spans only
+  uint32_t thread;        // numbered in order of their first event
+  uint32_t depth;         // spans open on the thread around this event
+  std::string message;    // the name of a span
+};
+
+std::ostream& operator<<(std::ostream& stream, const TraceEvent& event);
+
+// Bounded multi-producer queue of events, lock-free: a slot is claimed by a compare-and-swap
+// of the write position and published through its sequence number. Events arriving when it
+// is full are dropped and counted rather than waited for.
+class TraceRing {
+ public:
+  TraceRing(size_t capacity);  // rounded up to a power of two
+  TraceRing(const TraceRing&) = delete;
+  TraceRing& operator=(const TraceRing&) = delete;
+
+  bool push(TraceEvent event);
+  bool pop(TraceEvent& event);
+  size_t dropped() const;
+
+ private:
+  struct Slot {
+    std::atomic<size_t> sequence;
+    TraceEvent event;
+  };
+
+  std::unique_ptr<Slot[]> slots_;
+  size_t mask_;
+  alignas(64) std::atomic<size_t> write_{0};
+  alignas(64) std::atomic<size_t> read_{0};
+  std::atomic<size_t> dropped_{0};
+};
+
+// Process-wide tracing. Nothing is recorded until a level is set; events then go to a
+// TraceRing of kCapacity events, taken out by drain().
+class Tracer {
+ public:
+  static constexpr size_t kCapacity = 8192;
+
+  static void setLevel(TraceLevel level);
+  static TraceLevel level();
+  static bool enabled(TraceLevel level) {
+    return static_cast<int>(level) <= level_.load(std::memory_order_relaxed);
+  }
+
+  static void emit(TraceLevel level, std::string message);
+  static void emit(TraceEvent event);
+  // Appends the recorded events to `events` in the order they were recorded.
+  static size_t drain(std::vector<TraceEvent>& events);
+  static size_t dropped();
+
+  static uint64_t now();
+  static uint32_t thread();
+
+ private:
+  static std::atomic<int> level_;
+
+  friend class TraceSpan;
+};
+
+// Records the time until the end of the scope as one event, when `level` is traced.
+class TraceSpan {
+ public:
+  TraceSpan(TraceLevel level, const char* name)
+      : active_(static_cast<int>(level) <= CSQL_TRACE_LEVEL && Tracer::enabled(level)) {
+    if (active_) start(level, name);
+  }
+  TraceSpan(const TraceSpan&) = delete;
+  TraceSpan& operator=(const TraceSpan&) = delete;
+  ~TraceSpan() {
+    if (active_) finish();
+  }
+
+ private:
+  void start(TraceLevel level, const char* name);
+  void finish();
+
+  bool active_;
+  TraceLevel level_;
+  const char* name_;
+  uint64_t start_;
+};
+
+}  // namespace storage
+}  // namespace csql
+
+// Records `message`, anything that can be streamed, at `level`. It is only evaluated when
+// the level is traced.
+#define CSQL_TRACE(level, message)                                                  \
+  do {                                                                              \
+    if constexpr (static_cast<int>(level) <= CSQL_TRACE_LEVEL) {                    \
+      if (::csql::storage::Tracer::enabled(level)) {                                \
+        std::ostringstream csql_trace_stream;                                       \
+        csql_trace_stream << message;                                               \
+        ::csql::storage::Tracer::emit(level, csql_trace_stream.str());              \
+      }                                                                             \
+    }                                                                               \
+  } while (false)
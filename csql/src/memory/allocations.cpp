@@ -0,0 +1,20 @@
+#include "allocations.h"
+
+namespace {
+thread_local csql::storage::AllocationCount allocations;
+}  // namespace
+
+namespace csql {
+namespace storage {
+
+AllocationCount threadAllocations() {
+  return allocations;
+}
+
+void countAllocation(size_t bytes) {
+  allocations.count++;
+  allocations.bytes += bytes;
+}
+
+}  // namespace storage
+}  // namespace csql
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+
+namespace csql {
+namespace storage {
+
+// Allocations made by the engine on the calling thread since it started. They are counted
+// where the engine allocates: the arenas, nodes made outside of one and the values and cells
+// of stored rows; what the standard containers allocate for themselves is not.
+struct AllocationCount {
+  size_t count = 0;
+  size_t bytes = 0;
+};
+
+AllocationCount threadAllocations();
+// Adds an allocation of `bytes` to threadAllocations().
+void countAllocation(size_t bytes);
+
+}  // namespace storage
+}  // namespace csql
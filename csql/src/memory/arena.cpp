@@ -0,0 +1,91 @@
+#include "arena.h"
+
+#include <cstdint>
+
+#include "allocations.h"
+
+namespace {
+thread_local std::shared_ptr<csql::storage::Arena> current_arena;
+}  // namespace
+
+namespace csql {
+namespace storage {
+
+Arena::Arena(size_t chunkSize) : chunkSize_(chunkSize) {}
+
+Arena::~Arena() {
+  destroyObjects();
+}
+
+void* Arena::allocate(size_t size, size_t alignment) {
+  countAllocation(size);
+  size_t padding = (alignment - reinterpret_cast<uintptr_t>(next_) % alignment) % alignment;
+  if (!next_ || padding + size > remaining_) {
+    if (size + alignment > chunkSize_ / 4) {  // large blocks get a chunk of their own
+      blocks_.emplace_back(new std::byte[size + alignment]);
+      std::byte* block = blocks_.back().get();
+      block += (alignment - reinterpret_cast<uintptr_t>(block) % alignment) % alignment;
+      allocated_ += size;
+      return block;
+    }
+    if (used_ == chunks_.size()) {
+      chunks_.emplace_back(new std::byte[chunkSize_]);
+    }
+    next_ = chunks_[used_++].get();
+    remaining_ = chunkSize_;
+    padding = (alignment - reinterpret_cast<uintptr_t>(next_) % alignment) % alignment;
+  }
+  std::byte* result = next_ + padding;
+  next_ = result + size;
+  remaining_ -= padding + size;
+  allocated_ += size;
+  return result;
+}
+
+size_t Arena::allocated() const {
+  return allocated_;
+}
+
+void Arena::reset() {
+  destroyObjects();
+  blocks_.clear();
+  used_ = 0;
+  next_ = nullptr;
+  remaining_ = 0;
+  allocated_ = 0;
+}
+
+void Arena::destroyObjects() {
+  for (auto it = destructors_.rbegin(); it != destructors_.rend(); ++it) {
+    it->second(it->first);
+  }
+  destructors_.clear();
+}
+
+const std::shared_ptr<Arena>& BatchArena::get() {
+  if (!arena_) {
+    arena_ = std::make_shared<Arena>();
+  } else if (arena_->allocated() >= kBatchBytes) {
+    if (arena_.use_count() == 1) {
+      arena_->reset();
+    } else {
+      arena_ = std::make_shared<Arena>();
+    }
+  }
+  return arena_;
+}
+
+const std::shared_ptr<Arena>& Arena::current() {
+  return current_arena;
+}
+
+ArenaScope::ArenaScope(std::shared_ptr<Arena> arena) : previous_(current_arena) {
+  current_arena = std::move(arena);
+}
+
+ArenaScope::~ArenaScope() {
+  current_arena = std::move(previous_);
+}
+
+}  // namespace storage
+}  // namespace csql
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "allocations.h"
+
+namespace csql {
+namespace storage {
+
+// Bump allocator for short-lived node graphs. Memory is only given back when the arena is
+// destroyed or reset, all at once.
+class Arena {
+ public:
+  Arena(size_t chunkSize = 4096);
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+  virtual ~Arena();
+
+  void* allocate(size_t size, size_t alignment);
+  size_t allocated() const;  // bytes handed out since created or reset
+
+  // Constructs a T in the arena, destroyed along with the arena.
+  template <typename T, typename... Args>
+  T* create(Args&&... args) {
+    T* object = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    if constexpr (!std::is_trivially_destructible_v<T>) {
+      destructors_.emplace_back(object, [](void* object) { static_cast<T*>(object)->~T(); });
+    }
+    return object;
+  }
+
+  // Destroys what create() made and rewinds, keeping the chunks for what comes next. Nothing
+  // allocated before may still be in use.
+  void reset();
+
+  // Arena of the innermost ArenaScope on this thread, nullptr outside of any.
+  static const std::shared_ptr<Arena>& current();
+
+ private:
+  void destroyObjects();
+
+  std::vector<std::unique_ptr<std::byte[]>> chunks_;  // of chunkSize_, the first used_ in use
+  std::vector<std::unique_ptr<std::byte[]>> blocks_;  // too large for a chunk
+  std::vector<std::pair<void*, void (*)(void*)>> destructors_;
+  size_t used_ = 0;
+  std::byte* next_ = nullptr;
+  size_t remaining_ = 0;
+  size_t chunkSize_;
+  size_t allocated_ = 0;
+
+  friend class ArenaScope;
+};
+
+// Makes `arena` the current one for makeNode() until the scope ends.
+class ArenaScope {
+ public:
+  ArenaScope(std::shared_ptr<Arena> arena);
+  ArenaScope(const ArenaScope&) = delete;
+  ArenaScope& operator=(const ArenaScope&) = delete;
+  ~ArenaScope();
+
+ private:
+  std::shared_ptr<Arena> previous_;
+};
+
+// Arenas for the rows an operator hands out one at a time, each pinning the arena it came
+// from. Once a batch worth of bytes is allocated the arena is reset when no row of it is left,
+// and left to its rows for a new one otherwise.
+class BatchArena {
+ public:
+  static constexpr size_t kBatchBytes = 64 * 1024;
+
+  const std::shared_ptr<Arena>& get();
+
+ private:
+  std::shared_ptr<Arena> arena_;
+};
+
+// Allocator handing out arena memory. Every copy shares ownership of the arena, so nodes
+// created with allocate_shared keep it alive until the last of them is released.
+template <typename T>
+class ArenaAllocator {
+ public:
+  using value_type = T;
+
+  ArenaAllocator(std::shared_ptr<Arena> arena) : arena_(std::move(arena)) {}
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U>& other) : arena_(other.arena_) {}
+
+  T* allocate(size_t n) {
+    return static_cast<T*>(arena_->allocate(n * sizeof(T), alignof(T)));
+  }
+  void deallocate(T*, size_t) {}
+
+  template <typename U>
+  bool operator==(const ArenaAllocator<U>& other) const {
+    return arena_ == other.arena_;
+  }
+
+ private:
+  std::shared_ptr<Arena> arena_;
+
+  template <typename U>
+  friend class ArenaAllocator;
+};
+
+// std::make_shared from the current arena, or from the heap when there is none.
+template <typename T, typename... Args>
+std::shared_ptr<T> makeNode(Args&&... args) {
+  if (const auto& arena = Arena::current()) {
+    return std::allocate_shared<T>(ArenaAllocator<T>(arena), std::forward<Args>(args)...);
+  }
+  countAllocation(sizeof(T));
+  return std::make_shared<T>(std::forward<Args>(args)...);
+}
+
+}  // namespace storage
+}  // namespace csql
@@ -3,6 +3,7 @@
 #include <iostream>
 #include <string>
 
+
 namespace csql {
 namespace storage {
 
@@ -30,5 +31,24 @@ bool Cell::isNull(size_t index) const {
   return values[index] == nullptr;
 }
 
+void freeValue(DataType type, void* value) {
+  switch (type) {
+    case DataType::INT32:
+      delete static_cast<int32_t*>(value);
+      break;
+    case DataType::BOOL:
+      delete static_cast<bool*>(value);
+      break;
+    case DataType::STRING:
+      delete static_cast<std::string*>(value);
+      break;
+    case DataType::BYTES:
+      delete[] static_cast<uint8_t*>(value);
+      break;
+    default:
+      break;
+  }
+}
+
 }  // namespace storage
 }  // namespace csql
\ No newline at end of file
@@ -25,5 +25,8 @@ struct Cell {
   std::vector<void*> values;
 };
 
+// Frees a heap value of `type`, as made by Column::createValue.
+void freeValue(DataType type, void* value);
+
 }  // namespace storage
 }  // namespace csql
\ No newline at end of file
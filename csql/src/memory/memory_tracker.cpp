@@ -0,0 +1,111 @@
+#include "memory_tracker.h"
+
+#include <utility>
+
+namespace {
+thread_local std::shared_ptr<csql::storage::MemoryTracker> current_query;
+}  // namespace
+
+namespace csql {
+namespace storage {
+
+MemoryTracker::MemoryTracker(std::string name, std::shared_ptr<MemoryTracker> parent,
+                             size_t limit)
+    : name_(std::move(name)), parent_(std::move(parent)), limit_(limit) {}
+
+std::shared_ptr<MemoryTracker> MemoryTracker::create(std::string name,
+                                                     std::shared_ptr<MemoryTracker> parent,
+                                                     size_t limit) {
+  return std::make_shared<MemoryTracker>(std::move(name), std::move(parent), limit);
+}
+
+MemoryTracker::~MemoryTracker() {
+  size_t bytes = current_.load(std::memory_order_relaxed);
+  if (parent_ && bytes) {
+    parent_->release(bytes);
+  }
+}
+
+bool MemoryTracker::tryAdd(size_t bytes) {
+  size_t limit = limit_.load(std::memory_order_relaxed);
+  size_t current = current_.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+  if (limit != kUnlimited && current > limit) {
+    current_.fetch_sub(bytes, std::memory_order_relaxed);
+    return false;
+  }
+  size_t peak = peak_.load(std::memory_order_relaxed);
+  while (current > peak &&
+         !peak_.compare_exchange_weak(peak, current, std::memory_order_relaxed)) {
+  }
+  return true;
+}
+
+void MemoryTracker::charge(size_t bytes) {
+  for (MemoryTracker* tracker = this; tracker; tracker = tracker->parent_.get()) {
+    if (!tracker->tryAdd(bytes)) {
+      for (MemoryTracker* added = this; added != tracker; added = added->parent_.get()) {
+        added->current_.fetch_sub(bytes, std::memory_order_relaxed);
+      }
+      throw MemoryLimitExceeded("Memory limit exceeded: " + tracker->name_ + " holds " +
+                                std::to_string(tracker->current()) + " of " +
+                                std::to_string(tracker->limit()) + " bytes, " +
+                                std::to_string(bytes) + " more requested");
+    }
+  }
+}
+
+void MemoryTracker::release(size_t bytes) {
+  for (MemoryTracker* tracker = this; tracker; tracker = tracker->parent_.get()) {
+    tracker->current_.fetch_sub(bytes, std::memory_order_relaxed);
+  }
+}
+
+void MemoryTracker::setParent(std::shared_ptr<MemoryTracker> parent) {
+  size_t bytes = current();
+  if (parent) {
+    parent->charge(bytes);
+  }
+  if (parent_) {
+    parent_->release(bytes);
+  }
+  parent_ = std::move(parent);
+}
+
+size_t MemoryTracker::current() const {
+  return current_.load(std::memory_order_relaxed);
+}
+
+size_t MemoryTracker::peak() const {
+  return peak_.load(std::memory_order_relaxed);
+}
+
+size_t MemoryTracker::limit() const {
+  return limit_.load(std::memory_order_relaxed);
+}
+
+void MemoryTracker::setLimit(size_t limit) {
+  limit_.store(limit, std::memory_order_relaxed);
+}
+
+const std::string& MemoryTracker::name() const {
+  return name_;
+}
+
+const std::shared_ptr<MemoryTracker>& MemoryTracker::parent() const {
+  return parent_;
+}
+
+const std::shared_ptr<MemoryTracker>& MemoryTracker::query() {
+  return current_query;
+}
+
+MemoryScope::MemoryScope(std::shared_ptr<MemoryTracker> tracker) : previous_(current_query) {
+  current_query = std::move(tracker);
+}
+
+MemoryScope::~MemoryScope() {
+  current_query = std::move(previous_);
+}
+
+}  // namespace storage
+}  // namespace csql
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+namespace csql {
+namespace storage {
+
+class MemoryLimitExceeded : public std::runtime_error {
+ public:
+  using std::runtime_error::runtime_error;
+};
+
+// Bytes held by a part of the engine: the database, a table or a query, and the operators of
+// a query. A charge counts towards the tracker and all of its parents, and fails without
+// effect when any of them would go over its limit. What is still charged when a tracker is
+// destroyed is released from its parents.
+class MemoryTracker {
+ public:
+  static constexpr size_t kUnlimited = 0;
+
+  MemoryTracker(std::string name, std::shared_ptr<MemoryTracker> parent, size_t limit);
+  static std::shared_ptr<MemoryTracker> create(std::string name,
+                                               std::shared_ptr<MemoryTracker> parent = nullptr,
+                                               size_t limit = kUnlimited);
+  MemoryTracker(const MemoryTracker&) = delete;
+  MemoryTracker& operator=(const MemoryTracker&) = delete;
+  virtual ~MemoryTracker();
+
+  // Throws MemoryLimitExceeded, naming the tracker whose limit was hit.
+  void charge(size_t bytes);
+  void release(size_t bytes);
+
+  size_t current() const;
+  size_t peak() const;  // highest current() so far
+  size_t limit() const;
+  void setLimit(size_t limit);
+  const std::string& name() const;
+  const std::shared_ptr<MemoryTracker>& parent() const;
+  // Moves what the tracker holds under `parent`, throws MemoryLimitExceeded when it does not
+  // fit there. Not safe while the tracker is charged or released by another thread.
+  void setParent(std::shared_ptr<MemoryTracker> parent);
+
+  // Tracker of the query planned or executed on this thread by the innermost MemoryScope,
+  // nullptr outside of any.
+  static const std::shared_ptr<MemoryTracker>& query();
+
+ private:
+  // Adds `bytes` unless it would exceed the limit.
+  bool tryAdd(size_t bytes);
+
+  std::string name_;
+  std::shared_ptr<MemoryTracker> parent_;
+  std::atomic<size_t> limit_;
+  std::atomic<size_t> current_{0};
+  std::atomic<size_t> peak_{0};
+
+  friend class MemoryScope;
+};
+
+// Makes `tracker` the one the operators built meanwhile on this thread charge, see
+// MemoryTracker::query().
+class MemoryScope {
+ public:
+  MemoryScope(std::shared_ptr<MemoryTracker> tracker);
+  MemoryScope(const MemoryScope&) = delete;
+  MemoryScope& operator=(const MemoryScope&) = delete;
+  ~MemoryScope();
+
+ private:
+  std::shared_ptr<MemoryTracker> previous_;
+};
+
+}  // namespace storage
+}  // namespace csql
@@ -0,0 +1,43 @@
+#include "sequence.h"
+
+#include <limits>
+#include <stdexcept>
+
+namespace csql {
+namespace storage {
+
+int32_t Sequence::next() {
+  return reserve(1);
+}
+
+int32_t Sequence::reserve(int32_t count) {
+  int32_t current = value_.load();
+  do {
+    if (current > std::numeric_limits<int32_t>::max() - count) {
+      throw std::runtime_error("AUTOINCREMENT exhausted");
+    }
+  } while (!value_.compare_exchange_weak(current, current + count));
+  return current + 1;
+}
+
+void Sequence::observe(int32_t value) {
+  int32_t current = value_.load();
+  while (current < value && !value_.compare_exchange_weak(current, value)) {
+  }
+}
+
+int32_t Sequence::current() const {
+  return value_.load();
+}
+
+int32_t SequenceRange::next() {
+  if (left_ == 0) {
+    next_ = sequence_.reserve(size_);
+    left_ = size_;
+  }
+  left_--;
+  return next_++;
+}
+
+}  // namespace storage
+}  // namespace csql
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace csql {
+namespace storage {
+
+// Monotonic counter backing an AUTOINCREMENT column. It lives in memory with its table, like
+// the rows: a table filled from existing rows (CREATE TABLE AS SELECT) seeds it once from
+// Column::maxValue().
+class Sequence {
+ public:
+  Sequence(int32_t start = 0) : value_(start) {}
+
+  int32_t next();
+  // Reserves `count` consecutive values and returns the first one. Throws when they would go
+  // past INT32_MAX, leaving the counter as it was.
+  int32_t reserve(int32_t count);
+  // Makes sure values handed out later are greater than `value`.
+  void observe(int32_t value);
+  int32_t current() const;
+
+ private:
+  std::atomic<int32_t> value_;  // last value handed out
+};
+
+// Per-inserter cache of a reserved range, so a batch touches the shared counter once.
+class SequenceRange {
+ public:
+  SequenceRange(Sequence& sequence, int32_t size) : sequence_(sequence), size_(size) {}
+
+  int32_t next();
+
+ private:
+  Sequence& sequence_;
+  int32_t size_;
+  int32_t next_ = 0;
+  int32_t left_ = 0;  // reserved values not handed out yet
+};
+
+}  // namespace storage
+}  // namespace csql
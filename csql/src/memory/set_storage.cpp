@@ -1,5 +1,6 @@
 #include "set_storage.h"
 
+#include <algorithm>
 #include <memory>
 
 #include "memory/cell.h"
@@ -19,6 +20,26 @@ void SetStorage::insert(std::shared_ptr<Cell> cell) {
   cells_.insert(cell);
 }
 
+void SetStorage::insert(std::vector<std::shared_ptr<Cell>> cells) {
+  std::sort(cells.begin(), cells.end(), comparator_);  // sorted keys make every hint exact
+
+  std::vector<Set::iterator> hints;
+  hints.reserve(cells.size());
+  for (size_t i = 0; i < cells.size(); i++) {
+    if (i > 0 && !comparator_(cells[i - 1], cells[i])) {
+      throw std::runtime_error("Key already exists");
+    }
+    auto hint = cells_.lower_bound(cells[i]);
+    if (hint != cells_.end() && !comparator_(cells[i], *hint)) {
+      throw std::runtime_error("Key already exists");
+    }
+    hints.push_back(hint);
+  }
+  for (size_t i = 0; i < cells.size(); i++) {
+    cells_.emplace_hint(hints[i], cells[i]);
+  }
+}
+
 void SetStorage::remove(std::shared_ptr<Iterator> it) {
   auto it_ = std::dynamic_pointer_cast<SetIterator>(it);
   if (!it_) {
@@ -36,6 +57,16 @@ std::shared_ptr<RangeIterator> SetStorage::getRangeIterator(std::shared_ptr<Cell
   return std::make_shared<SetRangeIterator>(start, end, shared_from_this());
 }
 
+std::shared_ptr<Cell> SetStorage::front() {
+  if (cells_.empty()) return nullptr;
+  return *cells_.begin();
+}
+
+std::shared_ptr<Cell> SetStorage::back() {
+  if (cells_.empty()) return nullptr;
+  return *cells_.rbegin();
+}
+
 size_t SetStorage::size() {
   return cells_.size();
 }
@@ -63,7 +94,7 @@ std::shared_ptr<Cell> SetIterator::get() {
 SetRangeIterator::SetRangeIterator(std::shared_ptr<Cell> start, std::shared_ptr<Cell> end,
                                    std::shared_ptr<SetStorage> storage)
     : RangeIterator(start, end), storage_(storage) {
-  if (storage->comparator_(end, start)) {  // end < start
+  if (start && end && storage->comparator_(end, start)) {  // end < start
     throw std::runtime_error("Invalid range");
   }
   if (!start) {
@@ -19,11 +19,14 @@ class SetStorage : public IStorage, public std::enable_shared_from_this<SetStora
   SetStorage(KeyComparator comparator) : cells_(comparator), comparator_(comparator) {}
 
   void insert(std::shared_ptr<Cell> cell) override;
+  void insert(std::vector<std::shared_ptr<Cell>> cells) override;
   void remove(std::shared_ptr<Iterator> it) override;
   bool containsKey(std::shared_ptr<Cell> cell) override;
   std::shared_ptr<Iterator> getIterator() override;
   std::shared_ptr<RangeIterator> getRangeIterator(std::shared_ptr<Cell> start,
                                                   std::shared_ptr<Cell> end) override;
+  std::shared_ptr<Cell> front() override;
+  std::shared_ptr<Cell> back() override;
 
   size_t size() override;
   void clear() override;
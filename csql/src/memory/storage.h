@@ -18,6 +18,8 @@ class IStorage {
   virtual ~IStorage() = default;
 
   virtual void insert(std::shared_ptr<Cell> cell) = 0;
+  // Inserts all cells or none of them.
+  virtual void insert(std::vector<std::shared_ptr<Cell>> cells) = 0;
   virtual void remove(std::shared_ptr<Iterator> it) = 0;
   virtual bool containsKey(std::shared_ptr<Cell> cell) = 0;
 
@@ -25,6 +27,10 @@ class IStorage {
   virtual std::shared_ptr<RangeIterator> getRangeIterator(std::shared_ptr<Cell> start,
                                                           std::shared_ptr<Cell> end) = 0;
 
+  // Cells with the smallest/largest key, nullptr when empty.
+  virtual std::shared_ptr<Cell> front() = 0;
+  virtual std::shared_ptr<Cell> back() = 0;
+
   virtual size_t size() = 0;
 
   virtual void clear() = 0;
@@ -6,6 +6,7 @@
 #include <sstream>
 #include <string>
 
+#include "memory/arena.h"
 #include "statements/select.h"
 
 namespace csql {
@@ -20,7 +21,8 @@ Expr::Expr(ExprType type)
       ival2(0),
       columnType(DataType::UNKNOWN, 0),
       opType(kOpNone),
-      distinct(false) {}
+      distinct(false),
+      memoSlot(-1) {}
 
 bool isUnaryOperator(OperatorType op) {
   return op == kOpUnaryMinus || op == kOpNot || op == kOpIsNull || op == kOpExists ||
@@ -102,12 +104,12 @@ bool operator<(OperatorType lhs, OperatorType rhs) {
 }
 
 std::shared_ptr<Expr> Expr::make(ExprType type) {
-  std::shared_ptr<Expr> e = std::make_shared<Expr>(type);
+  std::shared_ptr<Expr> e = storage::makeNode<Expr>(type);
   return e;
 }
 
 std::shared_ptr<Expr> Expr::makeOpUnary(OperatorType op, std::shared_ptr<Expr> expr) {
-  std::shared_ptr<Expr> e = std::make_shared<Expr>(kExprOperator);
+  std::shared_ptr<Expr> e = storage::makeNode<Expr>(kExprOperator);
   e->opType = op;
   e->expr = expr;
   e->expr2 = nullptr;
@@ -116,7 +118,7 @@ std::shared_ptr<Expr> Expr::makeOpUnary(OperatorType op, std::shared_ptr<Expr> e
 
 std::shared_ptr<Expr> Expr::makeOpBinary(std::shared_ptr<Expr> expr1, OperatorType op,
                                          std::shared_ptr<Expr> expr2) {
-  std::shared_ptr<Expr> e = std::make_shared<Expr>(kExprOperator);
+  std::shared_ptr<Expr> e = storage::makeNode<Expr>(kExprOperator);
   e->opType = op;
   e->expr = expr1;
   e->expr2 = expr2;
@@ -124,7 +126,7 @@ std::shared_ptr<Expr> Expr::makeOpBinary(std::shared_ptr<Expr> expr1, OperatorTy
 }
 
 std::shared_ptr<Expr> Expr::makeLiteral(int32_t val) {
-  std::shared_ptr<Expr> e = std::make_shared<Expr>(kExprLiteralInt);
+  std::shared_ptr<Expr> e = storage::makeNode<Expr>(kExprLiteralInt);
   e->ival = val;
   return e;
 }
@@ -138,12 +140,12 @@ std::shared_ptr<Expr> Expr::makeLiteral(const std::string& val) {
   }
   if ((val[0] == '\'' && val[val.size() - 1] == '\'') ||
       (val[0] == '"' && val[val.size() - 1] == '"')) {
-    std::shared_ptr<Expr> e = std::make_shared<Expr>(kExprLiteralString);
+    std::shared_ptr<Expr> e = storage::makeNode<Expr>(kExprLiteralString);
     e->name = val.substr(1, val.size() - 2);
     return e;
   }
   if (val[0] == '0' && val.size() > 2 && val[1] == 'x') {
-    std::shared_ptr<Expr> e = std::make_shared<Expr>(kExprLiteralBytes);
+    std::shared_ptr<Expr> e = storage::makeNode<Expr>(kExprLiteralBytes);
 
     // Remove the 0x prefix
     std::string bytes = val.substr(2);
@@ -180,13 +182,13 @@ std::shared_ptr<Expr> Expr::makeLiteral(const std::string& val) {
 }
 
 std::shared_ptr<Expr> Expr::makeLiteral(bool val) {
-  std::shared_ptr<Expr> e = std::make_shared<Expr>(kExprLiteralBool);
+  std::shared_ptr<Expr> e = storage::makeNode<Expr>(kExprLiteralBool);
   e->ival = (int)val;
   return e;
 }
 
 std::shared_ptr<Expr> Expr::makeLiteral(std::vector<uint8_t> val) {
-  std::shared_ptr<Expr> e = std::make_shared<Expr>(kExprLiteralBytes);
+  std::shared_ptr<Expr> e = storage::makeNode<Expr>(kExprLiteralBytes);
   e->name = "";
   for (int8_t byte : val) {
     e->name += byte;
@@ -195,18 +197,18 @@ std::shared_ptr<Expr> Expr::makeLiteral(std::vector<uint8_t> val) {
 }
 
 std::shared_ptr<Expr> Expr::makeStringLiteral(const std::string& val) {
-  std::shared_ptr<Expr> e = std::make_shared<Expr>(kExprLiteralString);
+  std::shared_ptr<Expr> e = storage::makeNode<Expr>(kExprLiteralString);
   e->name = val;
   return e;
 }
 
 std::shared_ptr<Expr> Expr::makeNullLiteral() {
-  std::shared_ptr<Expr> e = std::make_shared<Expr>(kExprLiteralNull);
+  std::shared_ptr<Expr> e = storage::makeNode<Expr>(kExprLiteralNull);
   return e;
 }
 
 std::shared_ptr<Expr> Expr::makeColumnRef(const std::string& name) {
-  std::shared_ptr<Expr> e = std::make_shared<Expr>(kExprColumnRef);
+  std::shared_ptr<Expr> e = storage::makeNode<Expr>(kExprColumnRef);
   size_t dot_pos = name.find('.');
   if (dot_pos != std::string::npos) {
     e->table = name.substr(0, dot_pos);
@@ -219,38 +221,44 @@ std::shared_ptr<Expr> Expr::makeColumnRef(const std::string& name) {
 }
 
 std::shared_ptr<Expr> Expr::makeColumnRef(const std::string& table, const std::string& name) {
-  std::shared_ptr<Expr> e = std::make_shared<Expr>(kExprColumnRef);
+  std::shared_ptr<Expr> e = storage::makeNode<Expr>(kExprColumnRef);
   e->name = name;
   e->table = table;
   return e;
 }
 
 std::shared_ptr<Expr> Expr::makeTableRef(const std::string& name) {
-  std::shared_ptr<Expr> e = std::make_shared<Expr>(kExprTableRef);
+  std::shared_ptr<Expr> e = storage::makeNode<Expr>(kExprTableRef);
   e->name = name;
   return e;
 }
 
 std::shared_ptr<Expr> Expr::makeStar(void) {
-  std::shared_ptr<Expr> e = std::make_shared<Expr>(kExprStar);
+  std::shared_ptr<Expr> e = storage::makeNode<Expr>(kExprStar);
   return e;
 }
 
 std::shared_ptr<Expr> Expr::makeStar(const std::string& table) {
-  std::shared_ptr<Expr> e = std::make_shared<Expr>(kExprStar);
+  std::shared_ptr<Expr> e = storage::makeNode<Expr>(kExprStar);
   e->table = table;
   return e;
 }
 
+std::shared_ptr<Expr> Expr::makeParameter(int id) {
+  std::shared_ptr<Expr> e = storage::makeNode<Expr>(kExprParameter);
+  e->ival = id;
+  return e;
+}
+
 std::shared_ptr<Expr> Expr::makeSelect(std::shared_ptr<SelectStatement> select) {
-  std::shared_ptr<Expr> e = std::make_shared<Expr>(kExprSelect);
+  std::shared_ptr<Expr> e = storage::makeNode<Expr>(kExprSelect);
   e->select = select;
   return e;
 }
 
 std::shared_ptr<Expr> Expr::makeJoin(std::shared_ptr<Expr> source1, std::shared_ptr<Expr> source2,
                                      std::shared_ptr<Expr> on, OperatorType joinType) {
-  std::shared_ptr<Expr> e = std::make_shared<Expr>(kExprJoin);
+  std::shared_ptr<Expr> e = storage::makeNode<Expr>(kExprJoin);
   e->opType = joinType;
   e->expr = source1;
   e->expr2 = source2;
@@ -265,7 +273,8 @@ bool Expr::isType(ExprType exprType) const {
 
 bool Expr::isLiteral() const {
   return isType(kExprLiteralInt) || isType(kExprLiteralString) || isType(kExprLiteralNull) ||
-         isType(kExprLiteralBool) || isType(kExprLiteralBytes) || isType(kExprColumnRef);
+         isType(kExprLiteralBool) || isType(kExprLiteralBytes) || isType(kExprColumnRef) ||
+         isType(kExprParameter);
 }
 
 bool Expr::hasTable() const {
@@ -276,6 +285,13 @@ bool Expr::hasAlias() const {
   return alias != "";
 }
 
+bool Expr::isBoolean() const {
+  if (type == kExprLiteralBool) return true;
+  if (type != kExprOperator) return false;
+  return isComparisonOperator(opType) || opType == kOpIsNull || opType == kOpAnd ||
+         opType == kOpOr;
+}
+
 std::string Expr::getName() const {
   return name;
 }
@@ -300,6 +316,8 @@ bool operator==(const Expr& lhs, const Expr& rhs) {
     return lhs.table == rhs.table;
   } else if (lhs.type == kExprTableRef) {
     return lhs.name == rhs.name;
+  } else if (lhs.type == kExprParameter) {
+    return lhs.ival == rhs.ival;
   } else {
     throw std::runtime_error("Unsupported expression type: " + std::to_string(lhs.type));
   }
@@ -421,6 +439,13 @@ std::ostream& operator<<(std::ostream& stream, const Expr& expr) {
     case kExprTableRef:
       stream << expr.name;
       break;
+    case kExprParameter:
+      if (expr.expr) {
+        stream << *expr.expr;
+      } else {
+        stream << "?";
+      }
+      break;
     default:
       stream << "UNKNOWN_EXPR";
   }
@@ -522,6 +547,9 @@ std::string Expr::toMermaid(std::string node_name, bool subexpr) const {
     case kExprTableRef:
       result = node_name + "(" + name + ")";
       break;
+    case kExprParameter:
+      result = node_name + "[?]";
+      break;
   }
   result = result + "\n";
   if (expr) {
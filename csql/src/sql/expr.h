@@ -25,6 +25,7 @@ enum ExprType {
   kExprOperator,
   kExprSelect,
   kExprJoin,
+  kExprParameter,  // ? placeholder, `ival` is its index and `expr` the bound value
 };
 
 // Operator types. These are important for expressions of type kExprOperator.
@@ -99,6 +100,8 @@ struct Expr {
 
   OperatorType opType;
   bool distinct;
+  // Slot of the row memo holding the value of a common subexpression, -1 when not shared.
+  int32_t memoSlot;
 
   // Convenience accessor methods.
 
@@ -106,6 +109,8 @@ struct Expr {
   bool isLiteral() const;
   bool hasTable() const;
   bool hasAlias() const;
+  // Whether evaluating it always gives a boolean, from its operator alone.
+  bool isBoolean() const;
   std::string getName() const;
 
   // Static constructors.
@@ -1,24 +1,9 @@
 #pragma once
 
-#include <boost/regex/v5/regex_fwd.hpp>
-#include <regex>
-#include <string>
+#include <array>
+#include <cstddef>
 #include <string_view>
 
-namespace {
-const std::string join(const std::vector<std::string> &v, const std::string &delim) {
-  std::string s;
-  for (size_t i = 0; i < v.size(); ++i) {
-    s += v[i];
-    if (i != v.size() - 1) {
-      s += delim;
-    }
-  }
-  return s;
-}
-
-}  // namespace
-
 namespace csql {
 
 enum class TokenType {
@@ -35,44 +20,73 @@ enum class TokenType {
   WHITESPACE,
   TERMINAL,
   STRING,
+  PARAMETER,
 };
 
 namespace token {
-const std::string PUNCTUATION = "[,\\:\\{\\}]";
-const std::string WHITESPACE = "[ \\n]";
-const std::string KEYWORDS =
-    "SELECT|INSERT|CREATE|DELETE|UPDATE|DROP|TO|FROM|WHERE|AND|OR|TABLE|ORDERED INDEX|UNORDERED "
-    "INDEX|AUTOINCREMENT|UNIQUE|KEY|TRUE|FALSE|IS NULL|IS NOT "
-    "NULL|NULL|NOT|SET|JOIN|ON|AS|LIMIT|OFFSET|FULL|INNER|LEFT|RIGHT|CROSS";
-const std::string TYPE = "BOOL|INT32|STRING\\[\\d+\\]|BYTES\\[\\d+\\]";
-const std::string NAME = "[a-zA-Z_][a-zA-Z_0-9]*";
-const std::string COLUMN_NAME = NAME + "\\." + NAME;  // table.column
-const std::string ALL_COLS = "\\*";
-const std::string OPERATOR = ">=|>|<=|<|=|!=|\\(|\\)|\\||\\+|\\-|\\*|\\/|\\%|\\&|\\~";
-const std::string INTEGER = "\\d+";
-const std::string HEX = "0x[0-9a-fA-F]+";
-const std::string TERMINAL = ";";
-const std::string STRING = R"((\"[^\"]*\")|(\'[^\']*\'))";
 
-const std::string ALL = "(" +
-                        join(
-                            {
-                                TYPE,
-                                COLUMN_NAME,
-                                NAME,
-                                KEYWORDS,
-                                NAME,
-                                ALL_COLS,
-                                OPERATOR,
-                                HEX,
-                                INTEGER,
-                                PUNCTUATION,
-                                WHITESPACE,
-                                TERMINAL,
-                                STRING,
-                            },
-                            ")|(") +
-                        ")";
+// Single-word keywords. Multi-word ones (IS NULL, ORDERED INDEX, ...) are assembled by the
+// tokenizer from their lead word.
+constexpr std::array<std::string_view, 32> KEYWORDS = {
+    "SELECT", "INSERT", "CREATE", "DELETE", "UPDATE", "DROP",  "TO",    "FROM",
+    "WHERE",  "AND",    "OR",     "TABLE",  "AUTOINCREMENT",   "UNIQUE", "KEY",
+    "TRUE",   "FALSE",  "NULL",   "NOT",    "SET",    "JOIN",  "ON",    "AS",
+    "LIMIT",  "OFFSET", "FULL",   "INNER",  "LEFT",   "RIGHT", "CROSS", "ANALYZE",
+    "EXPLAIN",
+};
+
+constexpr std::string_view IS_NULL = "IS NULL";
+constexpr std::string_view IS_NOT_NULL = "IS NOT NULL";
+constexpr std::string_view ORDERED_INDEX = "ORDERED INDEX";
+constexpr std::string_view UNORDERED_INDEX = "UNORDERED INDEX";
+
+constexpr char upper(char c) {
+  return (c >= 'a' && c <= 'z') ? static_cast<char>(c - 'a' + 'A') : c;
+}
+
+// Perfect hash over KEYWORDS: every keyword lands in its own slot.
+constexpr size_t KEYWORD_SLOTS = 64;
+constexpr size_t keywordHash(std::string_view word) {
+  if (word.empty()) return 0;
+  return (word.size() * 6 + upper(word[0]) * 7 + upper(word[word.size() > 1 ? 1 : 0]) * 6 +
+          upper(word.back())) %
+         KEYWORD_SLOTS;
+}
+
+constexpr std::array<std::string_view, KEYWORD_SLOTS> makeKeywordTable() {
+  std::array<std::string_view, KEYWORD_SLOTS> table{};
+  for (auto keyword : KEYWORDS) {
+    table[keywordHash(keyword)] = keyword;
+  }
+  return table;
+}
+
+constexpr std::array<std::string_view, KEYWORD_SLOTS> KEYWORD_TABLE = makeKeywordTable();
+
+constexpr bool isPerfect() {
+  auto table = makeKeywordTable();
+  size_t used = 0;
+  for (size_t i = 0; i < table.size(); i++) {
+    used += table[i].empty() ? 0 : 1;
+  }
+  return used == KEYWORDS.size();
+}
+static_assert(isPerfect(), "keyword hash has collisions");
+
+constexpr bool equalsIgnoreCase(std::string_view word, std::string_view keyword) {
+  if (word.size() != keyword.size()) return false;
+  for (size_t i = 0; i < word.size(); i++) {
+    if (upper(word[i]) != keyword[i]) return false;
+  }
+  return true;
+}
+
+// Canonical (upper case) keyword for `word`, empty if it is not a keyword.
+constexpr std::string_view findKeyword(std::string_view word) {
+  std::string_view keyword = KEYWORD_TABLE[keywordHash(word)];
+  return equalsIgnoreCase(word, keyword) ? keyword : std::string_view();
+}
+
 }  // namespace token
 
-}  // namespace csql
\ No newline at end of file
+}  // namespace csql
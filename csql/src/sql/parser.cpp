@@ -1,20 +1,22 @@
 #include "sql/parser.h"
 
-#include <boost/regex.hpp>
-#include <boost/regex/v5/regex_match.hpp>
+#include <algorithm>
 #include <cstring>
-#include <iostream>
 #include <memory>
 #include <string>
 #include <unordered_set>
 #include <vector>
 
+#include "generic/trace.h"
+#include "memory/arena.h"
 #include "sql/column_type.h"
 #include "sql/expr.h"
 #include "sql/grammar.h"
 #include "sql/parser_result.h"
 #include "sql/statements/create.h"
+#include "sql/statements/analyze.h"
 #include "sql/statements/delete.h"
+#include "sql/statements/explain.h"
 #include "sql/statements/insert.h"
 #include "sql/statements/select.h"
 #include "sql/statements/update.h"
@@ -22,6 +24,28 @@
 
 namespace {
 
+std::string uppercase(std::string_view str) {
+  std::string upper(str);
+  std::transform(upper.begin(), upper.end(), upper.begin(), ::toupper);
+  return upper;
+}
+
+// `until` lists the closing tokens separated by '|', a backslash escapes the next character.
+bool isUntil(std::string_view value, std::string_view until) {
+  std::string alternative;
+  for (size_t i = 0; i <= until.size(); i++) {
+    if (i == until.size() || until[i] == '|') {
+      if (value == alternative) return true;
+      alternative.clear();
+    } else if (until[i] == '\\' && i + 1 < until.size()) {
+      alternative += until[++i];
+    } else {
+      alternative += until[i];
+    }
+  }
+  return false;
+}
+
 csql::ColumnType columnTypeFromString(const std::string &type) {
   if (type == "BOOL") {
     return csql::ColumnType(csql::DataType::BOOL);
@@ -86,7 +110,7 @@ std::shared_ptr<csql::ColumnDefinition> parseColumnDefinition(
     result->setErrorDetails("Expected column type", 0, 0, token);
     return nullptr;
   }
-  type = columnTypeFromString(token.value);
+  type = columnTypeFromString(uppercase(token.value));
 
   token = tokenizer.nextToken();
   if (token.value == "=") {
@@ -96,7 +120,7 @@ std::shared_ptr<csql::ColumnDefinition> parseColumnDefinition(
       result->setErrorDetails("Expected string, integer, hex or boolean", 0, 0, token);
       return nullptr;
     }
-    default_value = csql::Expr::makeLiteral(token.value);
+    default_value = csql::Expr::makeLiteral(std::string(token.value));
     token = tokenizer.nextToken();
   }
 
@@ -109,11 +133,25 @@ std::shared_ptr<csql::ColumnDefinition> parseColumnDefinition(
     return nullptr;
   }
 
-  return std::make_shared<csql::ColumnDefinition>(
-      name, type, std::make_shared<std::unordered_set<csql::ConstraintType>>(constraints),
+  return csql::storage::makeNode<csql::ColumnDefinition>(
+      name, type, csql::storage::makeNode<std::unordered_set<csql::ConstraintType>>(constraints),
       default_value);
 }
 
+// Value of an INSERT column: a literal or a ? placeholder.
+std::shared_ptr<csql::Expr> parseValue(const csql::Token &token,
+                                       std::shared_ptr<csql::SQLParserResult> result) {
+  if (token.type == csql::TokenType::PARAMETER) {
+    return result->addParameter();
+  }
+  if (token.type != csql::TokenType::STRING && token.type != csql::TokenType::INTEGER &&
+      token.type != csql::TokenType::HEX && token.value != "TRUE" && token.value != "FALSE") {
+    result->setErrorDetails("Expected string, integer, hex, boolean or ?", 0, 0, token);
+    return nullptr;
+  }
+  return csql::Expr::makeLiteral(std::string(token.value));
+}
+
 std::shared_ptr<csql::ColumnValueDefinition> parseColumnValueDefinition(
     csql::SQLTokenizer &tokenizer, std::shared_ptr<csql::SQLParserResult> result, bool &hasComma,
     bool &hasParen) {
@@ -124,19 +162,17 @@ std::shared_ptr<csql::ColumnValueDefinition> parseColumnValueDefinition(
   }
 
   if (token.type == csql::TokenType::NAME) {
-    std::string name = token.value;
+    std::string name(token.value);
     token = tokenizer.nextToken();
     if (token.value != "=") {
       result->setErrorDetails("Expected =", 0, 0, token);
       return nullptr;
     }
     token = tokenizer.nextToken();
-    if (token.type != csql::TokenType::STRING && token.type != csql::TokenType::INTEGER &&
-        token.type != csql::TokenType::HEX && token.value != "TRUE" && token.value != "FALSE") {
-      result->setErrorDetails("Expected string, integer, hex or boolean", 0, 0, token);
+    std::shared_ptr<csql::Expr> value = parseValue(token, result);
+    if (!value) {
       return nullptr;
     }
-    std::string value = token.value;
 
     token = tokenizer.nextToken();
     if (token.value == ",") {
@@ -147,14 +183,12 @@ std::shared_ptr<csql::ColumnValueDefinition> parseColumnValueDefinition(
       result->setErrorDetails("Expected , or )", 0, 0, token);
       return nullptr;
     }
-    return std::make_shared<csql::ColumnValueDefinition>(name, csql::Expr::makeLiteral(value));
-  } else if (token.type != csql::TokenType::STRING && token.type != csql::TokenType::INTEGER &&
-             token.type != csql::TokenType::HEX && token.value != "TRUE" &&
-             token.value != "FALSE") {
-    result->setErrorDetails("Expected string, integer, hex or boolean", 0, 0, token);
-    return nullptr;
+    return csql::storage::makeNode<csql::ColumnValueDefinition>(name, value);
   } else {
-    std::string value = token.value;
+    std::shared_ptr<csql::Expr> value = parseValue(token, result);
+    if (!value) {
+      return nullptr;
+    }
     token = tokenizer.nextToken();
     if (token.value == ",") {
       hasComma = true;
@@ -164,24 +198,22 @@ std::shared_ptr<csql::ColumnValueDefinition> parseColumnValueDefinition(
       result->setErrorDetails("Expected , or )", 0, 0, token);
       return nullptr;
     }
-    return std::make_shared<csql::ColumnValueDefinition>(csql::Expr::makeLiteral(value));
+    return csql::storage::makeNode<csql::ColumnValueDefinition>(value);
   }
 }
 
-bool parseInsert(csql::SQLTokenizer &tokenizer, std::shared_ptr<csql::SQLParserResult> result) {
+std::shared_ptr<csql::ColumnValues> parseInsertRow(csql::SQLTokenizer &tokenizer,
+                                                   std::shared_ptr<csql::SQLParserResult> result) {
   csql::Token token = tokenizer.nextToken();
   if (token.value != "(") {
     result->setErrorDetails("Expected (", 0, 0, token);
-    return false;
+    return nullptr;
   }
 
   bool hasComma = false;
   bool hasParen = false;
 
-  std::string tableName;
-
-  std::shared_ptr<std::vector<std::shared_ptr<csql::ColumnValueDefinition>>> columnValues =
-      std::make_shared<std::vector<std::shared_ptr<csql::ColumnValueDefinition>>>();
+  std::shared_ptr<csql::ColumnValues> columnValues = csql::storage::makeNode<csql::ColumnValues>();
 
   while (!hasParen) {
     std::shared_ptr<csql::ColumnValueDefinition> columnValue =
@@ -189,11 +221,26 @@ bool parseInsert(csql::SQLTokenizer &tokenizer, std::shared_ptr<csql::SQLParserR
     if (columnValue) {
       columnValues->push_back(columnValue);
     } else if (!hasParen) {
-      return false;
+      return nullptr;
     }
   }
+  return columnValues;
+}
+
+bool parseInsert(csql::SQLTokenizer &tokenizer, std::shared_ptr<csql::SQLParserResult> result) {
+  std::string tableName;
+  std::vector<std::shared_ptr<csql::ColumnValues>> rows;
+
+  csql::Token token;
+  do {  // insert (...), (...), ... to table
+    std::shared_ptr<csql::ColumnValues> columnValues = parseInsertRow(tokenizer, result);
+    if (!columnValues) {
+      return false;
+    }
+    rows.push_back(columnValues);
+    token = tokenizer.nextToken();
+  } while (token.value == ",");
 
-  token = tokenizer.nextToken();
   if (token.value != "TO") {
     result->setErrorDetails("Expected TO", 0, 0, token);
     return false;
@@ -207,20 +254,23 @@ bool parseInsert(csql::SQLTokenizer &tokenizer, std::shared_ptr<csql::SQLParserR
   tableName = token.value;
 
   csql::InsertType insertType = csql::InsertType::kUnknown;
-  for (const auto &columnValue : *columnValues) {
-    if (insertType == csql::InsertType::kUnknown) {
-      insertType = columnValue->isNamed ? csql::InsertType::kInsertKeysValues
-                                        : csql::InsertType::kInsertValues;
-    } else if ((insertType == csql::InsertType::kInsertKeysValues && !columnValue->isNamed) ||
-               (insertType == csql::InsertType::kInsertValues && columnValue->isNamed)) {
-      result->setErrorDetails("Cannot mix named and unnamed values", 0, 0, token);
-      return false;
+  for (const auto &columnValues : rows) {
+    for (const auto &columnValue : *columnValues) {
+      if (insertType == csql::InsertType::kUnknown) {
+        insertType = columnValue->isNamed ? csql::InsertType::kInsertKeysValues
+                                          : csql::InsertType::kInsertValues;
+      } else if ((insertType == csql::InsertType::kInsertKeysValues && !columnValue->isNamed) ||
+                 (insertType == csql::InsertType::kInsertValues && columnValue->isNamed)) {
+        result->setErrorDetails("Cannot mix named and unnamed values", 0, 0, token);
+        return false;
+      }
     }
   }
 
   std::shared_ptr<csql::InsertStatement> insertStatement =
-      std::make_shared<csql::InsertStatement>(insertType, csql::Expr::makeTableRef(tableName));
-  insertStatement->columnValues = columnValues;
+      csql::storage::makeNode<csql::InsertStatement>(insertType,
+                                                     csql::Expr::makeTableRef(tableName));
+  insertStatement->rows = rows;
 
   result->addStatement(insertStatement);
   return true;
@@ -282,9 +332,13 @@ std::shared_ptr<csql::Expr> parseExpr(csql::SQLTokenizer &tokenizer,
         result->setErrorDetails("Subquery must be in parenthesis", 0, 0, token);
         return nullptr;
       }
-      left = csql::Expr::makeSelect(parseSelect(tokenizer, result, until));
+      auto select = parseSelect(tokenizer, result, until);
+      if (!select) {
+        return nullptr;
+      }
+      return csql::Expr::makeSelect(select);  // its WHERE clause took the closing parenthesis
     } else if (token.type == csql::TokenType::NAME) {
-      left = csql::Expr::makeTableRef(token.value);
+      left = csql::Expr::makeTableRef(std::string(token.value));
     } else {
       result->setErrorDetails("Expected table reference", 0, 0, token);
       return nullptr;
@@ -304,11 +358,11 @@ std::shared_ptr<csql::Expr> parseExpr(csql::SQLTokenizer &tokenizer,
     } else if (token.value == "~") {
       left = csql::Expr::makeOpUnary(csql::OperatorType::kOpBitNot, parseExpr(tokenizer, result));
     } else if (token.type == csql::TokenType::INTEGER) {
-      left = csql::Expr::makeLiteral(std::stoi(token.value));
+      left = csql::Expr::makeLiteral(std::stoi(std::string(token.value)));
     } else if (token.type == csql::TokenType::STRING) {
-      left = csql::Expr::makeLiteral(token.value);
+      left = csql::Expr::makeLiteral(std::string(token.value));
     } else if (token.type == csql::TokenType::HEX) {
-      left = csql::Expr::makeLiteral(token.value);
+      left = csql::Expr::makeLiteral(std::string(token.value));
     } else if (token.value == "TRUE") {
       left = csql::Expr::makeLiteral(true);
     } else if (token.value == "FALSE") {
@@ -317,8 +371,10 @@ std::shared_ptr<csql::Expr> parseExpr(csql::SQLTokenizer &tokenizer,
       left = csql::Expr::makeNullLiteral();
     } else if (token.value == "*") {
       left = csql::Expr::makeStar();
+    } else if (token.type == csql::TokenType::PARAMETER) {
+      left = result->addParameter();
     } else if (token.type == csql::TokenType::NAME || token.type == csql::TokenType::COLUMN_NAME) {
-      left = csql::Expr::makeColumnRef(token.value);
+      left = csql::Expr::makeColumnRef(std::string(token.value));
     } else {
       result->setErrorDetails("Expected expression", 0, 0, token);
       return nullptr;
@@ -329,12 +385,12 @@ std::shared_ptr<csql::Expr> parseExpr(csql::SQLTokenizer &tokenizer,
   }
 
   token = tokenizer.nextToken();
-  boost::regex re(until.data());
-  while (token.type != csql::TokenType::TERMINAL && !boost::regex_match(token.value, re)) {
-    if (token.type != csql::TokenType::OPERATOR && token.value != "OR" && token.value != "AND" &&
-        token.value != "IS NULL" && token.value != "IS NOT NULL" && token.value != "JOIN" &&
-        token.value != "INNER" && token.value != "LEFT" && token.value != "RIGHT" &&
-        token.value != "FULL" && token.value != "CROSS") {
+  while (token.type != csql::TokenType::TERMINAL && !isUntil(token.value, until)) {
+    if (token.type != csql::TokenType::OPERATOR && token.type != csql::TokenType::ALL_COLS &&
+        token.value != "OR" && token.value != "AND" && token.value != "IS NULL" &&
+        token.value != "IS NOT NULL" && token.value != "JOIN" && token.value != "INNER" &&
+        token.value != "LEFT" && token.value != "RIGHT" && token.value != "FULL" &&
+        token.value != "CROSS") {
       result->setErrorDetails("Expected operator", 0, 0, token);
       return nullptr;
     }
@@ -359,7 +415,7 @@ std::shared_ptr<csql::Expr> parseExpr(csql::SQLTokenizer &tokenizer,
       } else if (token.value == "JOIN") {
         op = csql::OperatorType::kOpInnerJoin;
       } else {
-        result->setErrorDetails("Unknown join type: " + token.value, 0, 0, token);
+        result->setErrorDetails("Unknown join type: " + std::string(token.value), 0, 0, token);
         return nullptr;
       }
       if (token.value != "JOIN") {
@@ -445,7 +501,7 @@ std::shared_ptr<csql::SelectStatement> parseSelect(csql::SQLTokenizer &tokenizer
                                                    const std::string_view until) {
   csql::Token token = tokenizer.get();
   std::shared_ptr<std::vector<std::shared_ptr<csql::Expr>>> selectList =
-      std::make_shared<std::vector<std::shared_ptr<csql::Expr>>>();
+      csql::storage::makeNode<std::vector<std::shared_ptr<csql::Expr>>>();
 
   while (token.value != "FROM") {
     std::shared_ptr<csql::Expr> expr = parseExpr(tokenizer, result);
@@ -484,10 +540,10 @@ std::shared_ptr<csql::SelectStatement> parseSelect(csql::SQLTokenizer &tokenizer
   }
 
   std::shared_ptr<csql::SelectStatement> selectStatement =
-      std::make_shared<csql::SelectStatement>();
+      csql::storage::makeNode<csql::SelectStatement>();
   selectStatement->fromSource = parseExpr(tokenizer, result, "", true);
   if (!selectStatement->fromSource) {
-    std::cout << "Error parsing from source" << std::endl;
+    CSQL_TRACE(csql::storage::TraceLevel::kDebug, "Error parsing from source");
     return nullptr;
   }
   selectStatement->selectList = selectList;
@@ -514,12 +570,12 @@ bool parseCreateTable(csql::SQLTokenizer &tokenizer,
     result->setErrorDetails("Expected table name on create table", 0, 0, token);
     return false;
   }
-  std::string tableName = token.value;
+  std::string tableName(token.value);
 
   token = tokenizer.nextToken();
   if (token.value == "AS") {
     std::shared_ptr<csql::CreateStatement> createStatement =
-        std::make_shared<csql::CreateStatement>(csql::CreateType::kCreateTableAsSelect);
+        csql::storage::makeNode<csql::CreateStatement>(csql::CreateType::kCreateTableAsSelect);
     createStatement->tableName = tableName;
     createStatement->sourceRef = parseExpr(tokenizer, result, ";", true);
     if (!createStatement->sourceRef) {
@@ -535,10 +591,10 @@ bool parseCreateTable(csql::SQLTokenizer &tokenizer,
   }
 
   std::shared_ptr<csql::CreateStatement> createStatement =
-      std::make_shared<csql::CreateStatement>(csql::CreateType::kCreateTable);
+      csql::storage::makeNode<csql::CreateStatement>(csql::CreateType::kCreateTable);
   createStatement->tableName = tableName;
   createStatement->columns =
-      std::make_shared<std::vector<std::shared_ptr<csql::ColumnDefinition>>>();
+      csql::storage::makeNode<std::vector<std::shared_ptr<csql::ColumnDefinition>>>();
 
   bool hasComma = false;
   bool hasParen = false;
@@ -585,8 +641,8 @@ bool parseDelete(csql::SQLTokenizer &tokenizer, std::shared_ptr<csql::SQLParserR
   }
 
   std::shared_ptr<csql::DeleteStatement> deleteStatement =
-      std::make_shared<csql::DeleteStatement>();
-  deleteStatement->tableRef = csql::Expr::makeTableRef(token.value);
+      csql::storage::makeNode<csql::DeleteStatement>();
+  deleteStatement->tableRef = csql::Expr::makeTableRef(std::string(token.value));
 
   token = tokenizer.nextToken();
   if (token.value != "WHERE") {
@@ -604,6 +660,37 @@ bool parseDelete(csql::SQLTokenizer &tokenizer, std::shared_ptr<csql::SQLParserR
   return true;
 }
 
+bool parseAnalyze(csql::SQLTokenizer &tokenizer, std::shared_ptr<csql::SQLParserResult> result) {
+  auto analyzeStatement = csql::storage::makeNode<csql::AnalyzeStatement>();
+  csql::Token token = tokenizer.get();
+  if (token.type == csql::TokenType::NAME) {
+    analyzeStatement->tableRef = csql::Expr::makeTableRef(std::string(token.value));
+    tokenizer.nextToken();
+  } else if (token.type != csql::TokenType::TERMINAL) {
+    result->setErrorDetails("Expected table name", 0, 0, token);
+    return false;
+  }
+  result->addStatement(analyzeStatement);
+  return true;
+}
+
+bool parseExplain(csql::SQLTokenizer &tokenizer, std::shared_ptr<csql::SQLParserResult> result) {
+  auto explainStatement = csql::storage::makeNode<csql::ExplainStatement>();
+  csql::Token token = tokenizer.nextToken();
+  if (token.value == "ANALYZE") {
+    explainStatement->analyze = true;
+    token = tokenizer.nextToken();
+  }
+  if (token.value != "SELECT") {
+    result->setErrorDetails("Expected SELECT", 0, 0, token);
+    return false;
+  }
+  explainStatement->select = parseSelect(tokenizer, result);
+  if (!explainStatement->select || !result->isValid()) return false;
+  result->addStatement(explainStatement);
+  return true;
+}
+
 bool parseUpdate(csql::SQLTokenizer &tokenizer, std::shared_ptr<csql::SQLParserResult> result) {
   csql::Token token = tokenizer.nextToken();
 
@@ -611,7 +698,7 @@ bool parseUpdate(csql::SQLTokenizer &tokenizer, std::shared_ptr<csql::SQLParserR
     result->setErrorDetails("Expected table name", 0, 0, token);
     return false;
   }
-  std::string tableName = token.value;
+  std::string tableName(token.value);
 
   token = tokenizer.nextToken();
   if (token.value != "SET") {
@@ -620,7 +707,7 @@ bool parseUpdate(csql::SQLTokenizer &tokenizer, std::shared_ptr<csql::SQLParserR
   }
 
   std::shared_ptr<std::vector<std::shared_ptr<csql::ColumnValueDefinition>>> columnValues =
-      std::make_shared<std::vector<std::shared_ptr<csql::ColumnValueDefinition>>>();
+      csql::storage::makeNode<std::vector<std::shared_ptr<csql::ColumnValueDefinition>>>();
 
   token = tokenizer.nextToken();
   while (token.value != "WHERE") {
@@ -628,7 +715,7 @@ bool parseUpdate(csql::SQLTokenizer &tokenizer, std::shared_ptr<csql::SQLParserR
       result->setErrorDetails("Expected column name", 0, 0, token);
       return false;
     }
-    std::string columnName = token.value;
+    std::string columnName(token.value);
 
     token = tokenizer.nextToken();
     if (token.value != "=") {
@@ -641,7 +728,8 @@ bool parseUpdate(csql::SQLTokenizer &tokenizer, std::shared_ptr<csql::SQLParserR
       return false;
     }
 
-    columnValues->push_back(std::make_shared<csql::ColumnValueDefinition>(columnName, value));
+    columnValues->push_back(
+        csql::storage::makeNode<csql::ColumnValueDefinition>(columnName, value));
 
     token = tokenizer.get();
     if (token.value == ",") {
@@ -658,7 +746,7 @@ bool parseUpdate(csql::SQLTokenizer &tokenizer, std::shared_ptr<csql::SQLParserR
   }
 
   std::shared_ptr<csql::UpdateStatement> updateStatement =
-      std::make_shared<csql::UpdateStatement>();
+      csql::storage::makeNode<csql::UpdateStatement>();
 
   updateStatement->table = csql::Expr::makeTableRef(tableName);
   updateStatement->columnValues = columnValues;
@@ -672,6 +760,7 @@ bool parseUpdate(csql::SQLTokenizer &tokenizer, std::shared_ptr<csql::SQLParserR
 namespace csql {
 
 bool SQLParser::parse(const std::string &sql, std::shared_ptr<SQLParserResult> result) {
+  storage::TraceSpan span(storage::TraceLevel::kInfo, "parse");
   SQLTokenizer tokenizer(sql);
 
   Token token = tokenizer.nextToken();
@@ -692,6 +781,10 @@ bool SQLParser::parse(const std::string &sql, std::shared_ptr<SQLParserResult> r
       result->addStatement(selectStatement);
     } else if (token.value == "DELETE") {
       if (!parseDelete(tokenizer, result)) return false;
+    } else if (token.value == "ANALYZE") {
+      if (!parseAnalyze(tokenizer, result)) return false;
+    } else if (token.value == "EXPLAIN") {
+      if (!parseExplain(tokenizer, result)) return false;
     } else {
       result->setErrorDetails("Unknown keyword", 0, 0, token);
       return false;
@@ -1,5 +1,4 @@
 #pragma once
-#include <boost/regex.hpp>
 #include <string>
 
 #include "parser_result.h"
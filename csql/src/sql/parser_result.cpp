@@ -3,9 +3,12 @@
 
 #include <algorithm>
 
+#include "generic/trace.h"
 #include "sql/parser.h"
 #include "sql/statements/create.h"
+#include "sql/statements/analyze.h"
 #include "sql/statements/delete.h"
+#include "sql/statements/explain.h"
 #include "sql/statements/insert.h"
 #include "sql/statements/select.h"
 #include "sql/statements/update.h"
@@ -45,8 +48,8 @@ bool SQLParserResult::isValid() const {
 }
 
 const std::string SQLParserResult::errorMsg() const {
-  return errorMsg_ + "\n" + "Got: " + token_.value +
-         "\nToken type: " + tokenTypeToString(token_.type);
+  return errorMsg_ + "\n" + "Got: " + tokenValue_ +
+         "\nToken type: " + tokenTypeToString(tokenType_);
 }
 
 int SQLParserResult::errorLine() const {
@@ -67,16 +70,28 @@ void SQLParserResult::setErrorDetails(std::string errorMsg, int errorLine, int e
   errorMsg_ = errorMsg;
   errorLine_ = errorLine;
   errorColumn_ = errorColumn;
-  token_ = token;
-  std::cout << this->errorMsg() << std::endl;
+  tokenType_ = token.type;
+  tokenValue_ = token.value;
+  CSQL_TRACE(storage::TraceLevel::kDebug, "Parse error: " << this->errorMsg());
 }
 
 const std::vector<std::shared_ptr<SQLStatement>>& SQLParserResult::getStatements() const {
   return statements_;
 }
 
+std::shared_ptr<Expr> SQLParserResult::addParameter() {
+  std::shared_ptr<Expr> parameter = Expr::makeParameter(parameters_.size());
+  parameters_.push_back(parameter);
+  return parameter;
+}
+
+const std::vector<std::shared_ptr<Expr>>& SQLParserResult::getParameters() const {
+  return parameters_;
+}
+
 void SQLParserResult::reset() {
   statements_.clear();
+  parameters_.clear();
 
   isValid_ = false;
   errorMsg_ = nullptr;
@@ -97,6 +112,10 @@ std::ostream& operator<<(std::ostream& stream, const SQLParserResult& result) {
         stream << *std::dynamic_pointer_cast<DeleteStatement>(stmt);
       } else if (stmt->is(kStmtUpdate)) {
         stream << *std::dynamic_pointer_cast<UpdateStatement>(stmt);
+      } else if (stmt->is(kStmtAnalyze)) {
+        stream << *std::dynamic_pointer_cast<AnalyzeStatement>(stmt);
+      } else if (stmt->is(kStmtExplain)) {
+        stream << *std::dynamic_pointer_cast<ExplainStatement>(stmt);
       } else {
         stream << "Unknown statement";
       }
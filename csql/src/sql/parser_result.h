@@ -23,15 +23,20 @@ class SQLParserResult {
   std::shared_ptr<SQLStatement> popStatement();
   std::shared_ptr<SQLStatement> getStatement(size_t index) const;
   const std::vector<std::shared_ptr<SQLStatement>>& getStatements() const;
+  // Creates the next ? placeholder; ids follow the order of appearance in the text.
+  std::shared_ptr<Expr> addParameter();
+  const std::vector<std::shared_ptr<Expr>>& getParameters() const;
   void reset();
 
  private:
   std::vector<std::shared_ptr<SQLStatement>> statements_;
+  std::vector<std::shared_ptr<Expr>> parameters_;
   bool isValid_;
   std::string errorMsg_;
   int errorLine_;
   int errorColumn_;
-  Token token_;
+  TokenType tokenType_;
+  std::string tokenValue_;  // copied, tokens only live as long as the tokenizer
 };
 
 std::ostream& operator<<(std::ostream& stream, const SQLParserResult& result);
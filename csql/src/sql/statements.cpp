@@ -1,7 +1,9 @@
 #include <string>
 
+#include "sql/statements/analyze.h"
 #include "sql/statements/create.h"
 #include "sql/statements/delete.h"
+#include "sql/statements/explain.h"
 #include "sql/statements/insert.h"
 #include "sql/statements/select.h"
 #include "sql/statements/update.h"
@@ -67,9 +69,12 @@ ColumnValueDefinition::ColumnValueDefinition(std::shared_ptr<Expr> value)
 InsertStatement::InsertStatement(InsertType type, std::shared_ptr<Expr> table)
     : SQLStatement(kStmtInsert), insertType(type), tableRef(table) {}
 
-void InsertStatement::setColumnValues(
-    std::shared_ptr<std::vector<std::shared_ptr<ColumnValueDefinition>>> columnValues) {
-  this->columnValues = columnValues;
+void InsertStatement::setColumnValues(std::shared_ptr<ColumnValues> columnValues) {
+  rows = {columnValues};
+}
+
+void InsertStatement::addRow(std::shared_ptr<ColumnValues> columnValues) {
+  rows.push_back(columnValues);
 }
 
 std::ostream& operator<<(std::ostream& stream, const ColumnValueDefinition& column_value) {
@@ -82,24 +87,22 @@ std::ostream& operator<<(std::ostream& stream, const ColumnValueDefinition& colu
 
 std::ostream& operator<<(std::ostream& stream, const InsertStatement& insert_statement) {
   stream << "INSERT INTO " << *insert_statement.tableRef << " ";
-  if (insert_statement.insertType == InsertType::kInsertKeysValues) {
+  if (insert_statement.insertType != InsertType::kInsertKeysValues) {
+    stream << "VALUES ";
+  }
+  for (size_t row = 0; row < insert_statement.rows.size(); row++) {
+    const auto& columnValues = *insert_statement.rows[row];
     stream << "(";
-    for (size_t i = 0; i < insert_statement.columnValues->size(); i++) {
-      stream << *insert_statement.columnValues->at(i);
-      if (i + 1 < insert_statement.columnValues->size()) {
+    for (size_t i = 0; i < columnValues.size(); i++) {
+      stream << *columnValues[i];
+      if (i + 1 < columnValues.size()) {
         stream << ", ";
       }
     }
     stream << ")";
-  } else {
-    stream << "VALUES (";
-    for (size_t i = 0; i < insert_statement.columnValues->size(); i++) {
-      stream << *insert_statement.columnValues->at(i);
-      if (i + 1 < insert_statement.columnValues->size()) {
-        stream << ", ";
-      }
+    if (row + 1 < insert_statement.rows.size()) {
+      stream << ", ";
     }
-    stream << ")";
   }
   return stream;
 }
@@ -136,4 +139,20 @@ std::ostream& operator<<(std::ostream& stream, const DeleteStatement& delete_sta
   return stream;
 }
 
+// AnalyzeStatement
+std::ostream& operator<<(std::ostream& stream, const AnalyzeStatement& analyze_statement) {
+  stream << "ANALYZE";
+  if (analyze_statement.tableRef) {
+    stream << " " << *analyze_statement.tableRef;
+  }
+  return stream;
+}
+
+// ExplainStatement
+std::ostream& operator<<(std::ostream& stream, const ExplainStatement& explain_statement) {
+  stream << (explain_statement.analyze ? "EXPLAIN ANALYZE " : "EXPLAIN ")
+         << *explain_statement.select;
+  return stream;
+}
+
 }  // namespace csql
\ No newline at end of file
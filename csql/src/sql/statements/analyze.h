@@ -0,0 +1,20 @@
+#pragma once
+
+#include <memory>
+
+#include "../expr.h"
+#include "statement.h"
+
+namespace csql {
+
+// ANALYZE [table]: collects column statistics for one table, or for all when omitted.
+struct AnalyzeStatement : SQLStatement {
+  AnalyzeStatement() : SQLStatement(kStmtAnalyze) {}
+  ~AnalyzeStatement() override = default;
+
+  std::shared_ptr<Expr> tableRef;  // nullptr for all tables
+};
+
+std::ostream &operator<<(std::ostream &stream, const AnalyzeStatement &analyze_statement);
+
+}  // namespace csql
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <memory>
+
+#include "select.h"
+#include "statement.h"
+
+namespace csql {
+
+// EXPLAIN [ANALYZE] SELECT ...: the plan of the query, with ANALYZE also run and annotated
+// with what every step did.
+struct ExplainStatement : SQLStatement {
+  ExplainStatement() : SQLStatement(kStmtExplain) {}
+  ~ExplainStatement() override = default;
+
+  bool analyze = false;
+  std::shared_ptr<SelectStatement> select;
+};
+
+std::ostream &operator<<(std::ostream &stream, const ExplainStatement &explain_statement);
+
+}  // namespace csql
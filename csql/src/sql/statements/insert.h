@@ -20,6 +20,8 @@ struct ColumnValueDefinition {
   std::shared_ptr<Expr> value;
   bool isNamed;
 };
+typedef std::vector<std::shared_ptr<ColumnValueDefinition>> ColumnValues;
+
 enum InsertType {
   kUnknown,
   kInsertValues,
@@ -30,12 +32,12 @@ struct InsertStatement : SQLStatement {
   InsertStatement(InsertType type, std::shared_ptr<Expr> tableRef);
   ~InsertStatement() = default;
 
-  void setColumnValues(
-      std::shared_ptr<std::vector<std::shared_ptr<ColumnValueDefinition>>> columnValues);
+  void setColumnValues(std::shared_ptr<ColumnValues> columnValues);  // single row
+  void addRow(std::shared_ptr<ColumnValues> columnValues);
 
   InsertType insertType;
   std::shared_ptr<Expr> tableRef;
-  std::shared_ptr<std::vector<std::shared_ptr<ColumnValueDefinition>>> columnValues;
+  std::vector<std::shared_ptr<ColumnValues>> rows;  // one entry per inserted row
 };
 
 std::ostream &operator<<(std::ostream &, const ColumnValueDefinition &);
@@ -40,6 +40,12 @@ std::ostream& operator<<(std::ostream& stream, const SQLStatement& statement) {
     case kStmtDrop:
       stream << "DROP";
       break;
+    case kStmtAnalyze:
+      stream << "ANALYZE";
+      break;
+    case kStmtExplain:
+      stream << "EXPLAIN";
+      break;
   }
   return stream;
 }
@@ -11,6 +11,8 @@ enum StatementType {
   kStmtDelete,
   kStmtCreate,
   kStmtDrop,
+  kStmtAnalyze,
+  kStmtExplain,
 };
 
 // Base struct for every SQL statement
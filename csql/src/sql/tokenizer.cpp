@@ -1,22 +1,26 @@
 #include "tokenizer.h"
 
-#include <boost/regex.hpp>
-#include <cstring>
+#include <cctype>
 #include <string>
+#include <string_view>
 
 #include "grammar.h"
 
 namespace {
-std::string uppercase(const std::string &str) {
-  std::string upper = str;
-  std::transform(upper.begin(), upper.end(), upper.begin(), ::toupper);
-  return upper;
+bool isNameStart(char c) {
+  return std::isalpha(static_cast<unsigned char>(c)) || c == '_';
 }
 
-std::string strip(const std::string &str) {
-  std::string s = str;
-  s.erase(std::remove_if(s.begin(), s.end(), ::isspace), s.end());
-  return s;
+bool isNameChar(char c) {
+  return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+}
+
+bool isDigit(char c) {
+  return std::isdigit(static_cast<unsigned char>(c));
+}
+
+bool isHexDigit(char c) {
+  return std::isxdigit(static_cast<unsigned char>(c));
 }
 
 }  // namespace
@@ -50,66 +54,175 @@ std::string tokenTypeToString(TokenType type) {
       return "TERMINAL";
     case TokenType::STRING:
       return "STRING";
+    case TokenType::PARAMETER:
+      return "PARAMETER";
     default:
       break;
   }
   return "";
 }
 
-SQLTokenizer::SQLTokenizer(const std::string &sql) : sql_(sql) {
-  boost::regex re(token::ALL, boost::regex::icase);
-  next = boost::sregex_token_iterator(sql_.begin(), sql_.end(), re);
+SQLTokenizer::SQLTokenizer(const std::string &sql) : sql_(sql), next_(0) {
+  current_ = scan(next_);
 }
 
-const Token SQLTokenizer::get() {
-  if (next == boost::sregex_token_iterator()) {
+size_t SQLTokenizer::skipWhitespace(size_t pos) const {
+  while (pos < sql_.size() && std::isspace(static_cast<unsigned char>(sql_[pos]))) {
+    pos++;
+  }
+  return pos;
+}
+
+std::string_view SQLTokenizer::wordAt(size_t pos) const {
+  size_t end = pos;
+  while (end < sql_.size() && isNameChar(sql_[end])) {
+    end++;
+  }
+  return std::string_view(sql_).substr(pos, end - pos);
+}
+
+Token SQLTokenizer::scanWord(size_t &pos) const {
+  std::string_view source(sql_);
+  size_t start = pos;
+  std::string_view word = wordAt(pos);
+  pos += word.size();
+
+  if (pos + 1 < sql_.size() && sql_[pos] == '.' && isNameStart(sql_[pos + 1])) {
+    pos += 1 + wordAt(pos + 1).size();  // table.column
+    return Token{TokenType::COLUMN_NAME, source.substr(start, pos - start)};
+  }
+
+  if (token::equalsIgnoreCase(word, "BOOL") || token::equalsIgnoreCase(word, "INT32")) {
+    return Token{TokenType::TYPE, word};
+  }
+  if ((token::equalsIgnoreCase(word, "STRING") || token::equalsIgnoreCase(word, "BYTES")) &&
+      pos < sql_.size() && sql_[pos] == '[') {  // string[32]
+    size_t end = pos + 1;
+    while (end < sql_.size() && isDigit(sql_[end])) {
+      end++;
+    }
+    if (end > pos + 1 && end < sql_.size() && sql_[end] == ']') {
+      pos = end + 1;
+      return Token{TokenType::TYPE, source.substr(start, pos - start)};
+    }
+  }
+
+  // Multi-word keywords
+  if (token::equalsIgnoreCase(word, "IS")) {
+    size_t after = skipWhitespace(pos);
+    std::string_view second = wordAt(after);
+    if (token::equalsIgnoreCase(second, "NULL")) {
+      pos = after + second.size();
+      return Token{TokenType::KEYWORD, token::IS_NULL};
+    }
+    if (token::equalsIgnoreCase(second, "NOT")) {
+      size_t third = skipWhitespace(after + second.size());
+      if (token::equalsIgnoreCase(wordAt(third), "NULL")) {
+        pos = third + 4;
+        return Token{TokenType::KEYWORD, token::IS_NOT_NULL};
+      }
+    }
+  } else if (token::equalsIgnoreCase(word, "ORDERED") ||
+             token::equalsIgnoreCase(word, "UNORDERED")) {
+    size_t after = skipWhitespace(pos);
+    if (token::equalsIgnoreCase(wordAt(after), "INDEX")) {
+      pos = after + 5;
+      return Token{TokenType::KEYWORD, word.size() == 7 ? token::ORDERED_INDEX
+                                                        : token::UNORDERED_INDEX};
+    }
+  }
+
+  std::string_view keyword = token::findKeyword(word);
+  if (!keyword.empty()) {
+    return Token{TokenType::KEYWORD, keyword};
+  }
+  return Token{TokenType::NAME, word};
+}
+
+Token SQLTokenizer::scan(size_t &pos) const {
+  std::string_view source(sql_);
+  pos = skipWhitespace(pos);
+  if (pos >= sql_.size()) {
     return Token{TokenType::TERMINAL, ""};
   }
-  std::string value = *next;
-  TokenType type = TokenType::TERMINAL;
-
-  if (boost::regex_match(value, boost::regex(token::KEYWORDS, boost::regex::icase))) {
-    type = TokenType::KEYWORD;
-    value = strip(uppercase(value));
-  } else if (boost::regex_match(value, boost::regex(token::TYPE, boost::regex::icase))) {
-    type = TokenType::TYPE;
-    value = uppercase(value);
-  } else if (boost::regex_match(value, boost::regex(token::COLUMN_NAME))) {
-    type = TokenType::COLUMN_NAME;  // before NAME
-  } else if (boost::regex_match(value, boost::regex(token::NAME))) {
-    type = TokenType::NAME;
-  } else if (boost::regex_match(value, boost::regex(token::ALL_COLS))) {
-    type = TokenType::ALL_COLS;
-  } else if (boost::regex_match(value, boost::regex(token::OPERATOR))) {
-    type = TokenType::OPERATOR;
-  } else if (boost::regex_match(value, boost::regex(token::HEX))) {
-    type = TokenType::HEX;
-  } else if (boost::regex_match(value, boost::regex(token::INTEGER))) {
-    type = TokenType::INTEGER;
-  } else if (boost::regex_match(value, boost::regex(token::PUNCTUATION))) {
-    type = TokenType::PUNCTUATION;
-  } else if (boost::regex_match(value, boost::regex(token::WHITESPACE))) {
-    type = TokenType::WHITESPACE;
-  } else if (boost::regex_match(value, boost::regex(token::TERMINAL))) {
-    type = TokenType::TERMINAL;
-  } else if (!value.empty() && boost::regex_match(value, boost::regex(token::STRING))) {
-    type = TokenType::STRING;
+
+  size_t start = pos;
+  char c = sql_[pos];
+  char next = pos + 1 < sql_.size() ? sql_[pos + 1] : '\0';
+
+  if (isNameStart(c)) {
+    return scanWord(pos);
+  }
+  if (c == '0' && next == 'x' && pos + 2 < sql_.size() && isHexDigit(sql_[pos + 2])) {
+    pos += 2;
+    while (pos < sql_.size() && isHexDigit(sql_[pos])) {
+      pos++;
+    }
+    return Token{TokenType::HEX, source.substr(start, pos - start)};
   }
-  if (type == TokenType::WHITESPACE) {
-    ++next;
-    return get();
+  if (isDigit(c)) {
+    while (pos < sql_.size() && isDigit(sql_[pos])) {
+      pos++;
+    }
+    return Token{TokenType::INTEGER, source.substr(start, pos - start)};
   }
-  return Token{type, value};
+  if (c == '"' || c == '\'') {
+    size_t end = sql_.find(c, pos + 1);
+    if (end == std::string::npos) {  // unterminated string
+      pos = sql_.size();
+      return Token{TokenType::NONE, source.substr(start)};
+    }
+    pos = end + 1;
+    return Token{TokenType::STRING, source.substr(start, pos - start)};
+  }
+  if ((c == '>' || c == '<' || c == '!') && next == '=') {
+    pos += 2;
+    return Token{TokenType::OPERATOR, source.substr(start, 2)};
+  }
+
+  pos++;
+  switch (c) {
+    case '*':
+      return Token{TokenType::ALL_COLS, source.substr(start, 1)};
+    case '>':
+    case '<':
+    case '=':
+    case '(':
+    case ')':
+    case '|':
+    case '+':
+    case '-':
+    case '/':
+    case '%':
+    case '&':
+    case '~':
+      return Token{TokenType::OPERATOR, source.substr(start, 1)};
+    case ',':
+    case ':':
+    case '{':
+    case '}':
+      return Token{TokenType::PUNCTUATION, source.substr(start, 1)};
+    case ';':
+      return Token{TokenType::TERMINAL, source.substr(start, 1)};
+    case '?':
+      return Token{TokenType::PARAMETER, source.substr(start, 1)};
+    default:
+      return Token{TokenType::NONE, source.substr(start, 1)};
+  }
+}
+
+const Token SQLTokenizer::get() {
+  return current_;
 }
 
 const Token SQLTokenizer::nextToken() {
-  auto token = get();
-  if (next != boost::sregex_token_iterator()) ++next;
+  Token token = current_;
+  current_ = scan(next_);
   return token;
 }
 
 bool SQLTokenizer::hasNext() const {
-  return next != boost::sregex_token_iterator();
+  return current_.type != TokenType::TERMINAL || !current_.value.empty();
 }
 
-}  // namespace csql
\ No newline at end of file
+}  // namespace csql
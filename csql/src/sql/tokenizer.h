@@ -1,6 +1,6 @@
 #pragma once
-#include <boost/regex.hpp>
 #include <string>
+#include <string_view>
 
 #include "grammar.h"
 
@@ -10,19 +10,28 @@ std::string tokenTypeToString(TokenType type);
 
 struct Token {
   TokenType type;
-  std::string value;
+  std::string_view value;  // view into the tokenizer's source, keywords are canonical upper case
 };
 
+// Single-pass lexer over the statement text.
 class SQLTokenizer {
  public:
   SQLTokenizer(const std::string &sql);
+  SQLTokenizer(const SQLTokenizer &) = delete;
+  SQLTokenizer &operator=(const SQLTokenizer &) = delete;
 
   const Token get();
   const Token nextToken();
   bool hasNext() const;
 
  private:
-  boost::sregex_token_iterator next;
+  Token scan(size_t &pos) const;
+  Token scanWord(size_t &pos) const;
+  size_t skipWhitespace(size_t pos) const;
+  std::string_view wordAt(size_t pos) const;
+
   std::string sql_;
+  Token current_;  // token returned by get()
+  size_t next_;    // position right after current_
 };
 }  // namespace csql
@@ -0,0 +1,88 @@
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include "check.h"
+#include "csql.h"
+
+namespace {
+
+const std::string kUsers = "select id from users where true";
+
+int32_t lastId(csql::Database& db) {
+  int32_t id = 0;
+  for (auto it = db.execute(kUsers); it->hasValue(); ++(*it)) {
+    id = std::max(id, (*(*it))->get<int32_t>(0));
+  }
+  return id;
+}
+
+}  // namespace
+
+int main() {
+  csql::Database db;
+
+  db.execute(R"(
+create table users (
+  {key, autoincrement} id: int32,
+  {unique} login: string[32],
+  is_admin: bool = false
+);
+  )");
+
+  {
+    auto appender = db.appender("users", 4);
+    for (int i = 0; i < 10; i++) {
+      appender->appendDefault().append("user" + std::to_string(i)).endRow();
+    }
+    check(count(db, kUsers) == 8, "full batches are inserted as they fill up");
+    appender->flush();
+  }
+  check(count(db, kUsers) == 10, "flush() inserts the rest");
+  check(lastId(db) == 10, "defaults take AUTOINCREMENT values");
+
+  {
+    auto appender = db.appender("users");
+    bool thrown = false;
+    try {
+      appender->appendDefault().append(7);
+    } catch (const std::runtime_error&) {
+      thrown = true;
+    }
+    check(thrown, "a value of the wrong type is rejected");
+    appender->append("user10").endRow();
+    appender->appendDefault().append("user11").endRow();
+    appender->appendDefault();  // never ended
+  }
+  check(count(db, kUsers) == 12, "the destructor inserts the ended rows, not the unfinished one");
+
+  {
+    auto appender = db.appender("users");
+    appender->appendDefault().append("user3").endRow();
+    bool thrown = false;
+    try {
+      appender->flush();
+    } catch (const std::runtime_error&) {
+      thrown = true;
+    }
+    check(thrown && count(db, kUsers) == 12, "a rejected batch is reported by flush()");
+    appender->appendDefault().append("user12").append(true).endRow();
+    appender->flush();
+  }
+  check(count(db, kUsers) == 13, "the appender stays usable after a rejected batch");
+  check(lastId(db) == 13, "a rejected batch takes no AUTOINCREMENT values");
+
+  std::ostringstream errors;
+  auto* cerr = std::cerr.rdbuf(errors.rdbuf());
+  {
+    auto appender = db.appender("users");
+    appender->appendDefault().append("user3").endRow();
+  }
+  std::cerr.rdbuf(cerr);
+  check(errors.str().find("lost 1 rows of users") != std::string::npos,
+        "a batch the destructor cannot insert is reported on std::cerr");
+
+  return failed();
+}
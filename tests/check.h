@@ -0,0 +1,81 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "csql.h"
+
+// Helpers of the test programs: each check prints its outcome and a failed one makes the
+// program exit with 1, see failed().
+
+inline int& failures() {
+  static int count = 0;
+  return count;
+}
+
+inline void check(bool condition, const std::string& what) {
+  std::cout << (condition ? "ok:   " : "FAIL: ") << what << std::endl;
+  if (!condition) failures()++;
+}
+
+inline int failed() {
+  return failures() == 0 ? 0 : 1;
+}
+
+// Whether running `sql` throws std::runtime_error.
+inline bool rejected(csql::Database& db, const std::string& sql) {
+  try {
+    db.execute(sql);
+  } catch (const std::runtime_error&) {
+    return true;
+  }
+  return false;
+}
+
+inline size_t count(std::shared_ptr<csql::TableIterator> rows) {
+  size_t count = 0;
+  for (; rows->hasValue(); ++(*rows)) {
+    count++;
+  }
+  return count;
+}
+
+inline size_t count(csql::Database& db, const std::string& sql) {
+  return count(db.execute(sql));
+}
+
+// The rows as printed by operator<<, sorted, to compare results whatever the order of the rows.
+inline std::vector<std::string> rows(std::shared_ptr<csql::TableIterator> it) {
+  std::vector<std::string> rows;
+  for (; it->hasValue(); ++(*it)) {
+    std::ostringstream row;
+    row << *(*(*it));
+    rows.push_back(row.str());
+  }
+  std::sort(rows.begin(), rows.end());
+  return rows;
+}
+
+inline std::vector<std::string> rows(csql::Database& db, const std::string& sql) {
+  return rows(db.execute(sql));
+}
+
+inline bool contains(const std::string& text, const std::string& part) {
+  return text.find(part) != std::string::npos;
+}
+
+// QueryPlan::explain() without the estimates and actuals: the steps, indented by depth.
+inline std::string shape(const std::string& explain) {
+  std::string shape;
+  std::istringstream lines(explain);
+  for (std::string line; std::getline(lines, line);) {
+    shape += line.substr(0, line.find("  (")) + "\n";
+  }
+  return shape;
+}
@@ -0,0 +1,82 @@
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "check.h"
+#include "csql.h"
+
+// A subexpression of the select list repeated by the filter below it is computed by the filter
+// and read back from the row memo by the select list.
+
+namespace {
+
+// The first column of the rows, which is an int32, sorted.
+std::vector<int32_t> values(std::shared_ptr<csql::TableIterator> it) {
+  std::vector<int32_t> values;
+  for (; it->hasValue(); ++(*it)) {
+    values.push_back((*(*it))->get<int32_t>(0));
+  }
+  std::sort(values.begin(), values.end());
+  return values;
+}
+
+// v * 3 + 1 over the rows of `nums` whose value of it is above `above`.
+std::vector<int32_t> expected(int32_t above) {
+  std::vector<int32_t> values;
+  for (int32_t i = 0; i < 200; i++) {
+    int32_t value = i % 50 * 3 + 1;
+    if (value > above) values.push_back(value);
+  }
+  std::sort(values.begin(), values.end());
+  return values;
+}
+
+// The allocations EXPLAIN ANALYZE reports for the top step of `sql`, the Eval.
+uint64_t allocations(csql::Database& db, const std::string& sql) {
+  std::string line = db.profile(sql)->explain();
+  line = line.substr(0, line.find('\n'));
+  size_t end = line.rfind(" allocations");
+  size_t start = line.rfind(' ', end - 1) + 1;
+  return std::stoull(line.substr(start, end - start));
+}
+
+}  // namespace
+
+int main() {
+  csql::Database db;
+  db.execute("create table nums ({key, autoincrement} id: int32, v: int32)");
+  std::string insert = "insert ";
+  for (int i = 0; i < 200; i++) {
+    insert += (i ? ", (v = " : "(v = ") + std::to_string(i % 50) + ")";
+  }
+  db.execute(insert + " to nums");
+
+  std::string shared = "select (v * 3 + 1) as a from nums where (v * 3 + 1) > 10";
+  std::string apart = "select (v * 3 + 1) as a from nums where (1 + v * 3) > 10";
+  check(values(db.execute(shared)) == expected(10) && values(db.execute(apart)) == expected(10),
+        "a shared subexpression gives the values of one computed apart");
+  check(allocations(db, shared) + expected(10).size() <= allocations(db, apart),
+        "... computing it once per row, not once more for the select list");
+
+  // Parameters are bound into copies of the plan's expressions when it is executed, which keep
+  // the slots of the shared ones.
+  auto above = db.prepare("select (v * 3 + 1) as a from nums where (v * 3 + 1) > ?");
+  bool rebound = true;
+  for (int32_t bound : {10, 100, 0, 100}) {
+    above->bind(0, bound);
+    rebound = rebound && values(above->execute()) == expected(bound);
+  }
+  check(rebound, "a shared subexpression is right for every value bound next to it");
+
+  auto either = db.prepare("select (v * 3 + 1) as a from nums where ? or (v * 3 + 1) > 100");
+  either->bind(0, true);
+  check(values(either->execute()) == expected(INT32_MIN), "a parameter deciding the filter");
+  either->bind(0, false);
+  check(values(either->execute()) == expected(100), "... or leaving it to the shared one");
+  either->bind(0, true);
+  check(values(either->execute()) == expected(INT32_MIN), "... and deciding it again");
+
+  return failed();
+}
@@ -0,0 +1,189 @@
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "check.h"
+#include "csql.h"
+
+namespace {
+
+const std::string kUsers = "select id from users where true";
+
+}  // namespace
+
+int main() {
+  csql::Database db;
+
+  db.execute(R"(
+create table users (
+  {key, autoincrement} id: int32,
+  {unique} login: string[32]
+);
+create table posts (
+  {key, autoincrement} id: int32,
+  user_id: int32,
+  title: string[32]
+);
+  )");
+  for (int i = 0; i < 20; i++) {
+    db.execute("insert (login = \"user" + std::to_string(i) + "\") to users");
+  }
+
+  // Rows released on another thread than the one that ran the query.
+  {
+    auto it = db.execute("select login from users where true");
+    std::thread([&] { it = nullptr; }).join();
+    db.execute(R"(insert (user_id = 1, title = "first") to posts)");
+    db.execute(R"(insert (login = "released") to users)");
+    check(count(db, kUsers) == 21, "rows released on another thread unlock the table");
+  }
+
+  // A write on the thread of an open query fails instead of waiting for itself.
+  {
+    auto it = db.execute("select login from users where true");
+    bool thrown = false;
+    try {
+      db.execute(R"(insert (login = "blocked") to users)");
+    } catch (const std::runtime_error&) {
+      thrown = true;
+    }
+    check(thrown, "a write to a table read by an open query on the thread fails");
+    check(count(db, kUsers) == 21, "the thread can still read the table");
+  }
+
+  // A write on another thread waits until the rows are released.
+  {
+    auto it = db.execute("select login from users where true");
+    std::atomic<bool> written{false};
+    std::thread writer([&] {
+      db.execute(R"(insert (login = "waited") to users)");
+      written = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    check(!written, "a write waits for the rows of an open query");
+    it = nullptr;
+    writer.join();
+    check(written && count(db, kUsers) == 22, "the write goes ahead once they are released");
+  }
+
+  // Queries, prepared statements, writes, ANALYZE, an appender and CREATE TABLE AS SELECT
+  // running at once, meant for a ThreadSanitizer build.
+  std::atomic<size_t> errors{0};
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 2; t++) {
+    threads.emplace_back([&] {
+      for (int i = 0; i < 50; i++) {
+        auto it = db.execute(
+            "select users.login, posts.title from (users join posts on users.id = "
+            "posts.user_id) where true");
+        while (it->hasValue()) ++(*it);
+      }
+    });
+  }
+  threads.emplace_back([&] {
+    auto select = db.prepare("select login from users where id = ?");
+    for (int i = 0; i < 200; i++) {
+      select->bind(0, i % 20 + 1);
+      auto it = select->execute();
+      while (it->hasValue()) ++(*it);
+    }
+  });
+  for (int t = 0; t < 2; t++) {
+    threads.emplace_back([&, t] {
+      for (int i = 0; i < 100; i++) {
+        db.execute("insert (user_id = " + std::to_string(i % 20 + 1) + ", title = \"t" +
+                   std::to_string(t) + "\") to posts");
+        if (i % 10 == 9) {
+          db.execute("delete from posts where user_id = " + std::to_string(i % 20 + 1));
+        }
+      }
+    });
+  }
+  threads.emplace_back([&] {
+    for (int i = 0; i < 20; i++) {
+      db.execute("analyze posts");
+    }
+  });
+  threads.emplace_back([&] {
+    auto appender = db.appender("posts", 16);
+    for (int i = 0; i < 100; i++) {
+      appender->appendDefault().append(i % 20 + 1).append("appended").endRow();
+    }
+    appender->flush();
+  });
+  threads.emplace_back([&] {
+    try {
+      db.execute(
+          "create table copied as (select users.login as login, posts.title as title from "
+          "(users join posts on users.id = posts.user_id) where true)");
+    } catch (const std::exception&) {
+      errors++;
+    }
+  });
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  check(errors == 0, "concurrent statements complete");
+  check(count(db, kUsers) == 22, "concurrent statements leave the tables consistent");
+
+  db.execute(R"(
+create table lefts ({key, autoincrement} id: int32, name: string[8]);
+create table rights ({key, autoincrement} id: int32, name: string[8]);
+insert (name = "a") to lefts;
+insert (name = "a") to rights;
+  )");
+
+  // Readers arriving after a waiting writer queue behind it instead of keeping it out.
+  {
+    auto it = db.execute("select id from lefts where true");
+    std::atomic<int> order{0};
+    int written = 0;
+    int read = 0;
+    std::thread writer([&] {
+      db.execute(R"(insert (name = "w") to lefts)");
+      written = ++order;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    std::thread reader([&] {
+      count(db, "select id from lefts where true");
+      read = ++order;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    check(order == 0, "a new reader waits behind a waiting writer");
+    it = nullptr;
+    writer.join();
+    reader.join();
+    check(written == 1 && read == 2, "the writer goes first once the rows are released");
+  }
+
+  // Two threads each keeping rows open while writing the other's table: the one closing the
+  // cycle fails, which lets the other go ahead.
+  {
+    std::atomic<int> opened{0};
+    std::atomic<int> deadlocks{0};
+    std::atomic<int> writes{0};
+    auto session = [&](const std::string& read, const std::string& write) {
+      auto it = db.execute(read);
+      opened++;
+      while (opened < 2) std::this_thread::yield();
+      try {
+        db.execute(write);
+        writes++;
+      } catch (const std::runtime_error& error) {
+        if (std::string(error.what()).find("Deadlock") == 0) deadlocks++;
+      }
+    };
+    std::thread first(session, "select id from lefts where true",
+                      R"(insert (name = "b") to rights)");
+    std::thread second(session, "select id from rights where true",
+                       R"(insert (name = "b") to lefts)");
+    first.join();
+    second.join();
+    check(deadlocks == 1 && writes == 1, "a statement closing a cycle of waits fails");
+  }
+
+  return failed();
+}
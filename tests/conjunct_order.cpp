@@ -0,0 +1,92 @@
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "check.h"
+#include "csql.h"
+#include "generic/row.h"
+#include "generic/table.h"
+
+namespace {
+
+using csql::storage::ConjunctOrder;
+
+std::shared_ptr<csql::Expr> where(const std::string& clause) {
+  auto result = std::make_shared<csql::SQLParserResult>();
+  if (!csql::SQLParser::parse("select id from nums where " + clause, result)) {
+    throw std::runtime_error(result->errorMsg());
+  }
+  return std::dynamic_pointer_cast<csql::SelectStatement>(result->getStatement(0))->whereClause;
+}
+
+std::vector<std::string> order(const ConjunctOrder& conjuncts) {
+  std::vector<std::string> order;
+  for (const auto& expr : conjuncts.getConjuncts()) {
+    order.push_back(expr->toString());
+  }
+  return order;
+}
+
+// Hands `n` rows of `it` to the conjuncts, returning how many they accept.
+size_t accept(ConjunctOrder& conjuncts, csql::TableIterator& it, size_t n) {
+  size_t accepted = 0;
+  for (; n > 0 && it.hasValue(); n--, ++it) {
+    accepted += conjuncts.accepts(*(*it));
+  }
+  return accepted;
+}
+
+using Order = std::vector<std::string>;
+
+}  // namespace
+
+int main() {
+  constexpr size_t kRows = 2 * ConjunctOrder::kReorderInterval;
+  csql::Database db;
+  db.execute("create table nums ({key, autoincrement} id: int32, v: int32, name: string[8])");
+  std::string insert = "insert ";
+  for (size_t i = 0; i < kRows; i++) {
+    insert += (i ? ", (v = " : "(v = ") + std::to_string(i % 50) + ", name = \"n\")";
+  }
+  db.execute(insert + " to nums");
+
+  // Written with the conjunct rejecting no row first, they swap once kReorderInterval rows
+  // have shown the second to reject every row.
+  ConjunctOrder swapped(where("v >= 0 and v > 1000"));
+  auto it = db.execute("select * from nums where true");
+  check(accept(swapped, *it, ConjunctOrder::kReorderInterval - 1) == 0 &&
+            order(swapped) == Order{"v >= 0", "v > 1000"},
+        "the conjuncts are evaluated as written at first");
+  check(accept(swapped, *it, 1) == 0 && order(swapped) == Order{"v > 1000", "v >= 0"},
+        "... and the rejecting one first after kReorderInterval rows");
+  check(accept(swapped, *it, kRows) == 0, "... which rejects the rest of the rows");
+
+  ConjunctOrder divided(where("v > 0 and 100 / v > 0 and v > 1000"));
+  it = db.execute("select * from nums where true");
+  check(accept(divided, *it, ConjunctOrder::kReorderInterval) == 0 &&
+            order(divided) == Order{"v > 0", "100 / v > 0", "v > 1000"},
+        "no conjunct moves across a division");
+
+  // Through queries, where the rows with v = 0 would raise on 100 / v.
+  check(count(db, "select id from nums where v > 1000 and 100 / v > 0") == 0,
+        "a conjunct rejecting a row leaves the next one unevaluated");
+  size_t expected = 0;
+  for (size_t i = 0; i < kRows; i++) {
+    expected += i % 50 > 0 && 100 / (i % 50) > 5;
+  }
+  check(count(db, "select id from nums where v > 0 and 100 / v > 5") == expected,
+        "... over every row, the reorders aside");
+  check(rejected(db, "select id from nums where 100 / v > 5 and v > 0"),
+        "... while one evaluated first raises");
+
+  // AND gives false for anything but two booleans, see Row::evaluate.
+  check(count(db, "select id from nums where v and v > 3") == 0, "an int32 conjunct gives false");
+  check(count(db, "select id from nums where v > 3 and name") == 0,
+        "... as does a string one");
+  check(count(db, "select id from nums where v and 100 / v > 0") == 0,
+        "... leaving the next one unevaluated");
+  check(rejected(db, "select id from nums where v"), "a where clause that is not a boolean raises");
+
+  return failed();
+}
@@ -0,0 +1,111 @@
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "check.h"
+#include "csql.h"
+
+namespace {
+
+// The plan column of EXPLAIN, whose line column numbers the lines from 0.
+std::vector<std::string> explain(csql::Database& db, const std::string& sql) {
+  std::vector<std::string> lines;
+  for (auto it = db.execute(sql); it->hasValue(); ++(*it)) {
+    if ((*(*it))->get<int32_t>(0) != static_cast<int32_t>(lines.size())) return {};
+    lines.push_back((*(*it))->get<std::string>(1));
+  }
+  return lines;
+}
+
+std::vector<std::string> split(const std::string& text) {
+  std::vector<std::string> lines;
+  for (size_t start = 0, end; start < text.size(); start = end + 1) {
+    end = text.find('\n', start);
+    lines.push_back(text.substr(start, end - start));
+  }
+  return lines;
+}
+
+// What EXPLAIN ANALYZE counted for a step, -1 for what its line leaves out.
+struct Actual {
+  long rows = -1;
+  long examined = -1;
+  long loops = -1;
+
+  bool operator==(const Actual&) const = default;
+};
+
+Actual actual(const std::string& line) {
+  Actual actual;
+  size_t at = line.find("(actual ");
+  if (at == std::string::npos) return actual;
+  std::string counts = line.substr(at);
+  if (std::sscanf(counts.c_str(), "(actual %ld rows of %ld examined, %ld loop", &actual.rows,
+                  &actual.examined, &actual.loops) != 3) {
+    actual.examined = -1;
+    std::sscanf(counts.c_str(), "(actual %ld rows, %ld loop", &actual.rows, &actual.loops);
+  }
+  return actual;
+}
+
+}  // namespace
+
+int main() {
+  csql::Database db;
+  db.execute(R"(
+create table a ({key, autoincrement} id: int32, name: string[8]);
+create table c ({key, autoincrement} id: int32, label: string[8]);
+insert (name = "a1"), (name = "a2"), (name = "a3") to a;
+insert (label = "c1"), (label = "c2"), (label = "c3"), (label = "c4") to c;
+  )");
+
+  // EXPLAIN has a row per line of the plan, with the estimates only.
+  std::string select = "select name from a where name != \"a2\"";
+  auto lines = explain(db, "explain " + select);
+  check(lines == split(db.plan(select)->explain()) && lines.size() == 3,
+        "EXPLAIN returns the plan a line per row");
+  check(lines[1] == "  Filter: name != \"a2\"  (~3 rows, 3 steps)" &&
+            actual(lines[1]) == Actual{},
+        "... each step with its estimates and no actuals");
+
+  // EXPLAIN ANALYZE runs the query: every step counts the rows it returns, out of those it read
+  // from the steps below, and how many times it was started.
+  lines = explain(db, "explain analyze " + select);
+  check(shape(lines[0] + "\n" + lines[1] + "\n" + lines[2] + "\n") ==
+            shape(db.plan(select)->explain()),
+        "EXPLAIN ANALYZE has the steps of the plan");
+  check(actual(lines[0]) == Actual{2, 2, 1} && actual(lines[1]) == Actual{2, 3, 1} &&
+            actual(lines[2]) == Actual{3, -1, 1},
+        "a filter returns 2 of the 3 rows of its table");
+  check(contains(lines[1], " ms, cpu ") && contains(lines[1], " allocations"),
+        "... timing each step and counting its allocations");
+  check(split(db.profile(select)->explain()).size() == 3 &&
+            actual(split(db.profile(select)->explain())[1]) == Actual{2, 3, 1},
+        "Database::profile counts the same");
+
+  // A nested loop starts its right side over for every left row, a hash join reads each side
+  // once.
+  lines = explain(db,
+                  "explain analyze select a.name as name, c.label as label from (a join c on "
+                  "a.id < c.id) where true");
+  check(lines.size() == 4 && contains(lines[1], "Join on a.id < c.id") &&
+            actual(lines[1]) == Actual{6, 3 + 3 * 4, 1},
+        "a nested loop examines every pair of rows");
+  check(actual(lines[2]) == Actual{3, -1, 1} && actual(lines[3]) == Actual{3 * 4, -1, 3},
+        "... reading the right side once per left row");
+  lines = explain(db,
+                  "explain analyze select a.name as name, c.label as label from (a join c on "
+                  "a.id = c.id) where true");
+  check(lines.size() == 4 && contains(lines[1], "HashJoin") &&
+            actual(lines[1]) == Actual{3, 3 + 4, 1} && actual(lines[2]).loops == 1 &&
+            actual(lines[3]).loops == 1,
+        "a hash join reads each side once");
+
+  // The rows of a range scan are counted by the scan, which reads the table itself.
+  lines = explain(db, "explain analyze select label from c where id > 1");
+  check(lines.size() == 4 && contains(lines[2], "RangeScan") &&
+            actual(lines[2]) == Actual{3, -1, 1} && actual(lines[3]) == Actual{},
+        "a range scan returns the rows of its range");
+
+  return failed();
+}
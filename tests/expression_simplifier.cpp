@@ -0,0 +1,124 @@
+#include <stdexcept>
+#include <string>
+
+#include "check.h"
+#include "csql.h"
+
+// Each WHERE clause is checked by the filter the plan keeps of it and by the rows that come
+// out, which are the ones the clause as written selects.
+
+namespace {
+
+// The predicate of the plan's filter, empty when there is none.
+std::string filter(csql::Database& db, const std::string& sql) {
+  std::string plan = shape(db.plan(sql)->explain());
+  size_t at = plan.find("Filter: ");
+  if (at == std::string::npos) return "";
+  at += 8;
+  return plan.substr(at, plan.find('\n', at) - at);
+}
+
+// The first column of the rows, which is an int32, separated by spaces.
+std::string ids(csql::Database& db, const std::string& sql) {
+  std::string ids;
+  for (auto it = db.execute(sql); it->hasValue(); ++(*it)) {
+    ids += (ids.empty() ? "" : " ") + std::to_string((*(*it))->get<int32_t>(0));
+  }
+  return ids;
+}
+
+std::string error(csql::Database& db, const std::string& sql) {
+  try {
+    count(db, sql);
+  } catch (const std::runtime_error& e) {
+    return e.what();
+  }
+  return "";
+}
+
+}  // namespace
+
+int main() {
+  csql::Database db;
+  db.execute(R"(
+create table nums ({key, autoincrement} id: int32, login: string[8], is_admin: bool);
+create table empty ({key, autoincrement} id: int32);
+insert (login = "a", is_admin = true), (login = "b", is_admin = false),
+       (login = "c", is_admin = true), (login = "d", is_admin = false),
+       (login = "e", is_admin = false), (login = "f", is_admin = true) to nums;
+  )");
+
+  // Operators over constants are folded.
+  std::string sql = "select id from nums where id = 1 + 2 * 2 - (10 / 5)";
+  check(filter(db, sql) == "id = 3" && ids(db, sql) == "3", "arithmetic is folded");
+  sql = "select id from nums where |\"abc\"| = id";
+  check(filter(db, sql) == "id = 3" && ids(db, sql) == "3", "... and so is a length");
+  sql = "select (2 * 3 + id) as x from nums where id < 3";
+  check(ids(db, sql) == "7 8", "... in the select list too");
+
+  // Division by 0 and by -1 are left to the rows, which raise for them.
+  sql = "select id from nums where id = 6 / 0";
+  check(filter(db, sql) == "id = 6 / 0" && error(db, sql) == "Division by zero",
+        "a division by 0 is not folded, the rows raise");
+  sql = "select id from empty where id = 6 / 0";
+  check(filter(db, sql) == "id = 6 / 0" && error(db, sql).empty(),
+        "... which an empty table never does");
+  sql = "select id from nums where id = 6 % 0";
+  check(filter(db, sql) == "id = 6 % 0" && error(db, sql) == "Division by zero",
+        "... and the same for the remainder");
+  sql = "select id from nums where id = (0 - 2147483647 - 1) / -1";
+  check(filter(db, sql) == "id = -2147483648 / -1" && error(db, sql) == "Integer overflow",
+        "a division by -1 is not folded, the rows raise on an overflow");
+  sql = "select id from nums where id = 0 - 6 / -1";
+  check(filter(db, sql) == "id = 0 - 6 / -1" && ids(db, sql) == "6",
+        "... and give the value otherwise");
+
+  // NOT NOT x is x only when x is a boolean: NOT turns any other value into one.
+  sql = "select id from nums where not not (id > 3)";
+  check(filter(db, sql) == "id > 3" && ids(db, sql) == "4 5 6", "NOT NOT of a comparison goes");
+  sql = "select id from nums where not not id";
+  check(filter(db, sql) == "NOT NOT id" && ids(db, sql) == "1 2 3 4 5 6",
+        "NOT NOT of an int32 stays, true for every non-zero id");
+  sql = "select id from nums where not not is_admin";
+  check(filter(db, sql) == "NOT NOT is_admin" && ids(db, sql) == "1 3 6",
+        "... as does NOT NOT of a column");
+
+  // AND and OR give false when a side is not a boolean, so the identities only hold over one.
+  sql = "select id from nums where true and id > 3";
+  check(filter(db, sql) == "id > 3" && ids(db, sql) == "4 5 6", "TRUE AND x is x");
+  sql = "select id from nums where id > 3 and true";
+  check(filter(db, sql) == "id > 3" && ids(db, sql) == "4 5 6", "x AND TRUE is x");
+  sql = "select id from nums where false or id > 3";
+  check(filter(db, sql) == "id > 3" && ids(db, sql) == "4 5 6", "FALSE OR x is x");
+  sql = "select id from nums where id > 3 or true";
+  check(filter(db, sql).empty() && ids(db, sql) == "1 2 3 4 5 6", "x OR TRUE is TRUE");
+  sql = "select id from nums where false and login";
+  check(filter(db, sql) == "false" && ids(db, sql).empty(), "FALSE AND anything is FALSE");
+  sql = "select id from nums where true and login";
+  check(filter(db, sql) == "true AND login" && ids(db, sql).empty(),
+        "TRUE AND a string stays, false for every row");
+  sql = "select id from nums where false or login";
+  check(filter(db, sql) == "false OR login" && ids(db, sql).empty(),
+        "FALSE OR a string stays, false for every row");
+  sql = "select id from nums where login or true";
+  check(filter(db, sql) == "login OR true" && ids(db, sql).empty(),
+        "a string OR TRUE stays, false for every row");
+  sql = "select id from nums where true and is_admin";
+  check(filter(db, sql) == "true AND is_admin" && ids(db, sql) == "1 3 6",
+        "TRUE AND a column stays");
+
+  // `constant op column` becomes `column op' constant`, which can bound the key.
+  sql = "select id from nums where 3 < id";
+  std::string plan = shape(db.plan(sql)->explain());
+  check(filter(db, sql) == "id > 3" && contains(plan, "RangeScan") && ids(db, sql) == "4 5 6",
+        "3 < id is id > 3, a range of the key");
+  sql = "select id from nums where \"c\" >= login";
+  check(filter(db, sql) == "login <= \"c\"" && ids(db, sql) == "1 2 3", "\"c\" >= x is x <= \"c\"");
+  sql = "select id from nums where 4 = id";
+  check(filter(db, sql) == "id = 4" && ids(db, sql) == "4", "4 = id is id = 4");
+  sql = "select id from nums where 4 != id and 2 <= id";
+  check(filter(db, sql) == "id != 4 AND id >= 2" && ids(db, sql) == "2 3 5 6",
+        "every comparison is mirrored");
+
+  return failed();
+}
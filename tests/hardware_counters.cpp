@@ -0,0 +1,73 @@
+#include <string>
+#include <vector>
+
+#include "check.h"
+#include "csql.h"
+
+namespace {
+
+using csql::HardwareCounters;
+using csql::storage::HardwareCounts;
+
+std::vector<std::string> split(const std::string& text) {
+  std::vector<std::string> lines;
+  for (size_t start = 0, end; start < text.size(); start = end + 1) {
+    end = text.find('\n', start);
+    lines.push_back(text.substr(start, end - start));
+  }
+  return lines;
+}
+
+// Whether every step of the profile of `sql` has its hardware counts, or, when `counted` is
+// false, none has.
+bool counted(csql::Database& db, const std::string& sql, bool counted) {
+  auto lines = split(db.profile(sql)->explain());
+  if (lines.empty()) return false;
+  for (const auto& line : lines) {
+    bool has = contains(line, " cycles, ") && contains(line, " instructions (IPC ") &&
+               contains(line, " LLC misses, ") && contains(line, " branch misses");
+    if (!contains(line, "(actual ") || has != counted || contains(line, "cycles") != has) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+int main() {
+  csql::Database db;
+  db.execute(R"(
+create table users ({key, autoincrement} id: int32, login: string[16], score: int32);
+insert (login = "a", score = 3), (login = "b", score = 5), (login = "c", score = 7) to users;
+  )");
+  const std::string select = "select login from users where score > 4";
+
+  // Off by default: nothing is read and profiles go without counters.
+  HardwareCounts counts;
+  check(!HardwareCounters::enabled() && !HardwareCounters::read(counts),
+        "the counters are off by default");
+  check(counted(db, select, false), "... and left out of the profile");
+
+  // Enabled, they are read where the PMU can be opened. Either way queries run as before.
+  HardwareCounters::setEnabled(true);
+  HardwareCounts first;
+  bool available = HardwareCounters::read(first);
+  check(count(db, select) == 2, "queries run with the counters enabled");
+  if (available) {
+    HardwareCounts second;
+    check(HardwareCounters::read(second) && second.cycles >= first.cycles &&
+              second.instructions > first.instructions,
+          "the counters of the thread go up as it runs");
+    check(counted(db, select, true), "every step of a profile has its counters");
+  } else {
+    check(counted(db, select, false), "without a PMU profiles go without counters");
+  }
+  check(HardwareCounters::read(counts) == available, "... the same on every read");
+
+  HardwareCounters::setEnabled(false);
+  check(!HardwareCounters::read(counts) && counted(db, select, false),
+        "disabled again, they are not read");
+
+  return failed();
+}
@@ -0,0 +1,101 @@
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "check.h"
+#include "csql.h"
+
+namespace {
+
+// A table of 100 users, score i and login "u<i>" for the i-th.
+std::unique_ptr<csql::Database> users() {
+  auto db = std::make_unique<csql::Database>();
+  db->execute(
+      "create table users ({key, autoincrement} id: int32, login: string[16], score: int32)");
+  std::string insert = "insert ";
+  for (int i = 0; i < 100; i++) {
+    insert += std::string(i ? ", " : "") + "(login = \"u" + std::to_string(i) +
+              "\", score = " + std::to_string(i) + ")";
+  }
+  db->execute(insert + " to users");
+  return db;
+}
+
+// The rows of csql_index_advice, most beneficial first.
+struct Advice {
+  std::string statement;
+  std::string kind;
+  std::vector<int32_t> counts;  // calls, rows examined and passed, steps before and after
+  int32_t benefit;
+
+  bool operator==(const Advice&) const = default;
+};
+
+std::vector<Advice> advice(csql::Database& db) {
+  std::vector<Advice> advice;
+  auto it = db.execute(
+      "select statement, kind, calls, rows_examined, rows_passed, steps_before, steps_after, "
+      "benefit from csql_index_advice where true");
+  for (; it->hasValue(); ++(*it)) {
+    auto row = *(*it);
+    advice.push_back(Advice{row->get<std::string>(0), row->get<std::string>(1),
+                            {row->get<int32_t>(2), row->get<int32_t>(3), row->get<int32_t>(4),
+                             row->get<int32_t>(5), row->get<int32_t>(6)},
+                            row->get<int32_t>(7)});
+  }
+  std::stable_sort(advice.begin(), advice.end(),
+                   [](const Advice& a, const Advice& b) { return a.benefit > b.benefit; });
+  return advice;
+}
+
+}  // namespace
+
+int main() {
+  // Equalities are served by a hash index: one probe and the row it finds instead of a scan.
+  auto db = users();
+  for (int i = 0; i < 3; i++) {
+    count(*db, "select id from users where login = \"u" + std::to_string(i * 10) + "\"");
+  }
+  check(advice(*db) == std::vector<Advice>{{"CREATE UNORDERED INDEX users_login ON users (login);",
+                                            "UNORDERED",
+                                            {3, 300, 3, 100, 1 + 1},
+                                            3 * (100 - 2)}},
+        "a full scan filtered by equality gets an UNORDERED index");
+
+  // Ranges need an ordered one: a search of log2(100) steps, then the rows in the range.
+  db = users();
+  count(*db, "select id from users where score > 95");
+  count(*db, "select id from users where score < 4");
+  check(advice(*db) == std::vector<Advice>{{"CREATE ORDERED INDEX users_score ON users (score);",
+                                            "ORDERED",
+                                            {2, 200, 8, 100, 7 + 4},
+                                            2 * (100 - 11)}},
+        "a full scan filtered by a range gets an ORDERED index");
+  count(*db, "select id from users where score = 50");
+  check(advice(*db).size() == 1 && advice(*db)[0].kind == "ORDERED" &&
+            advice(*db)[0].counts[0] == 3,
+        "... which serves the equalities on the column too");
+
+  auto select = db->prepare("select id from users where login = ?");
+  for (int i = 0; i < 5; i++) {
+    select->bind(0, "u" + std::to_string(i));
+    count(select->execute());
+  }
+  auto both = advice(*db);
+  check(both.size() == 2 && both[0].kind == "UNORDERED" && both[0].counts[0] == 5 &&
+            both[0].benefit > both[1].benefit,
+        "a parameter counts as a value, the most beneficial index coming first");
+
+  // No advice where an index saves nothing.
+  db = users();
+  count(*db, "select id from users where id > 95");
+  check(advice(*db).empty(), "the key the table is ordered by is a range scan already");
+  count(*db, "select id from users where score >= 0");
+  check(advice(*db).empty(), "a range holding every row is read faster by the scan");
+  count(*db, "select id from users where login != \"u1\"");
+  check(advice(*db).empty(), "!= is no lookup");
+
+  return failed();
+}
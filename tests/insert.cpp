@@ -0,0 +1,68 @@
+#include <algorithm>
+#include <string>
+
+#include "check.h"
+#include "csql.h"
+
+namespace {
+
+const std::string kUsers = "select id from users where true";
+
+int32_t lastId(csql::Database& db) {
+  int32_t id = 0;
+  for (auto it = db.execute(kUsers); it->hasValue(); ++(*it)) {
+    id = std::max(id, (*(*it))->get<int32_t>(0));
+  }
+  return id;
+}
+
+}  // namespace
+
+int main() {
+  csql::Database db;
+
+  db.execute(R"(
+create table users (
+  {key, autoincrement} id: int32,
+  {unique} login: string[32],
+  is_admin: bool = false
+);
+  )");
+
+  db.execute(R"(insert (login = "a"), (login = "b"), (login = "c", is_admin = true) to users)");
+  check(count(db, kUsers) == 3, "multi-row insert stores every row");
+  check(lastId(db) == 3, "multi-row insert numbers the rows in order");
+
+  check(rejected(db, R"(insert (login = "d"), (login = "d") to users)"),
+        "a value repeated in the batch is rejected");
+  check(rejected(db, R"(insert (login = "e"), (login = "a") to users)"),
+        "a value already stored is rejected");
+  check(rejected(db, R"(insert (id = 2, login = "f") to users)"), "a stored key is rejected");
+  check(count(db, kUsers) == 3, "a rejected batch stores none of its rows");
+
+  db.execute(R"(insert (login = "d"), (login = "e") to users)");
+  check(lastId(db) == 5, "a rejected batch takes no AUTOINCREMENT values");
+
+  db.execute(R"(delete from users where login = "a")");
+  db.execute(R"(insert (login = "a") to users)");
+  check(count(db, kUsers) == 5, "a deleted value can be inserted again");
+
+  db.execute("create table counters ({key, autoincrement} id: int32, name: string[8])");
+  db.execute(R"(insert (id = 2147483646, name = "a") to counters)");
+  db.execute(R"(insert (name = "b") to counters)");
+  const std::string counters = "select id from counters where id = 2147483647";
+  check(count(db, counters) == 1, "AUTOINCREMENT hands out INT32_MAX");
+  size_t used = db.memory()->current();
+  std::string error;
+  try {
+    db.execute(R"(insert (name = "c") to counters)");
+  } catch (const std::runtime_error& e) {
+    error = e.what();
+  }
+  check(error == "AUTOINCREMENT exhausted", "AUTOINCREMENT fails past INT32_MAX");
+  check(count(db, "select id from counters where true") == 2 &&
+            db.memory()->current() == used,
+        "an exhausted AUTOINCREMENT stores and charges nothing");
+
+  return failed();
+}
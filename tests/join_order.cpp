@@ -0,0 +1,178 @@
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "check.h"
+#include "csql.h"
+
+namespace {
+
+// The first two columns of every row, sorted.
+std::vector<std::string> pairs(csql::Database& db, const std::string& sql) {
+  std::vector<std::string> pairs;
+  for (auto it = db.execute(sql); it->hasValue(); ++(*it)) {
+    pairs.push_back((*(*it))->get<std::string>(0) + "/" + (*(*it))->get<std::string>(1));
+  }
+  std::sort(pairs.begin(), pairs.end());
+  return pairs;
+}
+
+// Whether planning `sql` traces `message`, which tells how its joins were ordered.
+bool traces(csql::Database& db, const std::string& sql, const std::string& message) {
+  std::vector<csql::TraceEvent> events;
+  csql::Tracer::setLevel(csql::TraceLevel::kTrace);
+  csql::Tracer::drain(events);
+  events.clear();
+  db.plan(sql);
+  csql::Tracer::setLevel(csql::TraceLevel::kOff);
+  csql::Tracer::drain(events);
+  return std::any_of(events.begin(), events.end(),
+                     [&](const csql::TraceEvent& event) { return event.message == message; });
+}
+
+// select t1.id, tN.id from a chain of `n` tables, each row joined to the same id in the next.
+std::string chain(size_t n) {
+  std::string source = "t1";
+  for (size_t i = 2; i <= n; i++) {
+    source = "(" + source + " join t" + std::to_string(i) + " on t" + std::to_string(i - 1) +
+             ".next = t" + std::to_string(i) + ".id)";
+  }
+  return "select (t1.id * 10) as first, (t" + std::to_string(n) + ".id * 10) as last from " +
+         source + " where true";
+}
+
+}  // namespace
+
+int main() {
+  csql::Database db;
+
+  db.execute(R"(
+create table a ({key, autoincrement} id: int32, name: string[8]);
+create table b ({key, autoincrement} id: int32, a_id: int32, c_id: int32);
+create table c ({key, autoincrement} id: int32, label: string[8]);
+insert (name = "a1"), (name = "a2") to a;
+  )");
+  for (int i = 0; i < 60; i++) {
+    db.execute("insert (a_id = " + std::to_string(i % 10 + 1) +
+               ", c_id = " + std::to_string(i % 40 + 1) + ") to b");
+  }
+  for (int i = 0; i < 40; i++) {
+    db.execute("insert (label = \"c" + std::to_string(i) + "\") to c");
+  }
+  db.execute("analyze a; analyze b; analyze c");
+  std::vector<std::string> expected;
+  for (int i = 0; i < 60; i++) {
+    if (i % 10 < 2) {
+      expected.push_back("a" + std::to_string(i % 10 + 1) + "/c" + std::to_string(i % 40));
+    }
+  }
+  std::sort(expected.begin(), expected.end());
+
+  // Written as c, b, a: joining b to the two rows of a first keeps the intermediate rows few.
+  std::string sql =
+      "select a.name as name, c.label as label from ((c join b on c.id = b.c_id) join a on a.id "
+      "= b.a_id) where true";
+  check(shape(db.plan(sql)->explain()) ==
+            "Eval\n"
+            "  HashJoin build right on c.id = b.c_id\n"
+            "    Project: c\n"
+            "    HashJoin build right on a.id = b.a_id\n"
+            "      Project: b\n"
+            "      Project: a\n",
+        "the join of b with the two rows of a goes first, hashing them");
+  check(pairs(db, sql) == expected, "a reordered join returns the rows of the written one");
+  check(traces(db, sql, "Join order searched over 3 relations"),
+        "three tables are ordered by dynamic programming");
+
+  // The side built into a hash table is the smaller one; without an equality between the two
+  // sides the join is a nested loop.
+  sql = "select a.name as name, b.id as id from (a join b on a.id = b.a_id) where true";
+  check(shape(db.plan(sql)->explain()) ==
+            "Eval\n"
+            "  HashJoin build left on a.id = b.a_id\n"
+            "    Project: a\n"
+            "    Project: b\n",
+        "an equi-join hashes the smaller side");
+  sql = "select a.name as name, c.label as label from (a join c on a.id < c.id) where true";
+  check(shape(db.plan(sql)->explain()) ==
+            "Eval\n"
+            "  Join on a.id < c.id\n"
+            "    Project: a\n"
+            "    Project: c\n",
+        "a join without an equality is a nested loop");
+  check(count(db, sql) == 39 + 38, "... with the rows of the condition");
+
+  // A subquery, a table joined twice or an outer join among the relations keep the written
+  // order, each inner join still getting its strategy.
+  sql =
+      "select a_name, c.label as label from ((c join b on c.id = b.c_id) join (select id as "
+      "a_key, name as a_name from a where true) on a_key = b.a_id) where true";
+  check(shape(db.plan(sql)->explain()) ==
+            "Eval\n"
+            "  HashJoin build right on a_key = b.a_id\n"
+            "    HashJoin build left on c.id = b.c_id\n"
+            "      Project: c\n"
+            "      Project: b\n"
+            "    Eval\n"
+            "      Project: a\n",
+        "a subquery keeps the written order");
+  check(traces(db, sql, "Join order kept over 3 relations"), "... without searching");
+  check(pairs(db, sql) == expected, "... and returns the same rows");
+
+  sql =
+      "select c.label as label, b.id as id from ((c join b on c.id = b.c_id) join c on c.id = "
+      "b.a_id) where true";
+  check(shape(db.plan(sql)->explain()) ==
+            "Eval\n"
+            "  HashJoin build right on c.id = b.a_id\n"
+            "    HashJoin build left on c.id = b.c_id\n"
+            "      Project: c\n"
+            "      Project: b\n"
+            "    Project: c\n",
+        "a table joined twice keeps the written order");
+  check(traces(db, sql, "Join order kept over 3 relations"), "... without searching");
+
+  sql =
+      "select a.name as name from ((c left join b on c.id = b.c_id) join a on a.id = b.a_id) "
+      "where true";
+  check(shape(db.plan(sql)->explain()) ==
+            "Eval\n"
+            "  HashJoin build right on a.id = b.a_id\n"
+            "    Join on c.id = b.c_id\n"
+            "      Project: c\n"
+            "      Project: b\n"
+            "    Project: a\n",
+        "an outer join keeps the written order");
+  check(traces(db, sql, "Join order kept over 2 relations"), "... without searching");
+
+  // Up to kMaxExhaustiveRelations tables every order is searched, above that the joins are
+  // built greedily.
+  for (int i = 1; i <= 9; i++) {
+    std::string name = "t" + std::to_string(i);
+    db.execute("create table " + name + " ({key, autoincrement} id: int32, next: int32)");
+    db.execute("insert (next = 1), (next = 2), (next = 3) to " + name);
+  }
+  auto numbers = [&](const std::string& sql) {
+    std::vector<int32_t> numbers;
+    for (auto it = db.execute(sql); it->hasValue(); ++(*it)) {
+      numbers.push_back((*(*it))->get<int32_t>(0) + (*(*it))->get<int32_t>(1));
+    }
+    std::sort(numbers.begin(), numbers.end());
+    return numbers;
+  };
+  check(traces(db, chain(8), "Join order searched over 8 relations"),
+        "eight tables are ordered by dynamic programming");
+  check(numbers(chain(8)) == std::vector<int32_t>{20, 40, 60}, "... joined right");
+  check(traces(db, chain(9), "Join order built greedily over 9 relations"),
+        "nine tables are ordered greedily");
+  check(numbers(chain(9)) == std::vector<int32_t>{20, 40, 60}, "... joined right");
+  std::string plan = db.plan(chain(9))->explain();
+  size_t joins = 0;
+  for (size_t at = plan.find("HashJoin"); at != std::string::npos;
+       at = plan.find("HashJoin", at + 1)) {
+    joins++;
+  }
+  check(joins == 8, "... each join hashing a side");
+
+  return failed();
+}
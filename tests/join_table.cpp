@@ -0,0 +1,128 @@
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "check.h"
+#include "csql.h"
+#include "generic/column.h"
+#include "generic/row.h"
+#include "generic/table.h"
+
+namespace {
+
+using csql::Expr;
+using csql::storage::JoinStrategy;
+using csql::storage::JoinTable;
+using csql::storage::StorageTable;
+
+template <typename Statement>
+std::shared_ptr<Statement> parse(const std::string& sql) {
+  auto result = std::make_shared<csql::SQLParserResult>();
+  if (!csql::SQLParser::parse(sql, result)) {
+    throw std::runtime_error(result->errorMsg());
+  }
+  return std::dynamic_pointer_cast<Statement>(result->getStatement(0));
+}
+
+std::shared_ptr<StorageTable> table(const std::string& create, const std::string& insert) {
+  auto table = StorageTable::create(parse<csql::CreateStatement>(create));
+  table->insert(parse<csql::InsertStatement>(insert));
+  return table;
+}
+
+using Refs = std::vector<std::shared_ptr<Expr>>;
+
+// The carried columns, as "table.column" for the tables they come from.
+std::vector<std::string> columns(JoinTable& join) {
+  std::vector<std::string> names;
+  for (const auto& column : join.getColumns()) {
+    for (const std::string table : {"users", "posts"}) {
+      if (column->isFrom(table)) names.push_back(table + "." + column->getName());
+    }
+  }
+  return names;
+}
+
+std::vector<std::string> logins(JoinTable& join) {
+  std::vector<std::string> logins;
+  for (auto it = join.getIterator(); it->hasValue(); ++(*it)) {
+    auto row = *(*it);
+    logins.push_back(row->get<std::string>("login") + ":" +
+                     std::to_string(row->get<int32_t>("score")));
+  }
+  std::sort(logins.begin(), logins.end());
+  return logins;
+}
+
+}  // namespace
+
+int main() {
+  auto users = table(
+      "create table users ({key, autoincrement} id: int32, login: string[16], is_admin: bool)",
+      R"(insert (login = "a", is_admin = true), (login = "b", is_admin = false) to users)");
+  auto posts = table(
+      "create table posts ({key, autoincrement} id: int32, user_id: int32, title: string[16], "
+      "score: int32)",
+      R"(insert (user_id = 1, title = "x", score = 3), (user_id = 2, title = "y", score = 5),
+                (user_id = 2, title = "z", score = 7) to posts)");
+  auto on = Expr::makeOpBinary(Expr::makeColumnRef("users", "id"), csql::kOpEquals,
+                               Expr::makeColumnRef("posts", "user_id"));
+
+  // select users.login ... on users.id = posts.user_id where posts.score > 4
+  auto required = std::make_shared<Refs>(Refs{
+      Expr::makeColumnRef("users", "login"), Expr::makeColumnRef("posts", "score"),
+      Expr::makeColumnRef("users", "id"), Expr::makeColumnRef("posts", "user_id")});
+  for (auto strategy : {JoinStrategy::kNestedLoop, JoinStrategy::kHashBuildLeft}) {
+    auto join = JoinTable::create(users, posts, on, csql::kOpInnerJoin, strategy, required);
+    check(columns(*join) ==
+              std::vector<std::string>{"users.id", "users.login", "posts.user_id", "posts.score"},
+          "only the columns of the select list, the WHERE and ON clauses are carried");
+    check(logins(*join) == std::vector<std::string>{"a:3", "b:5", "b:7"},
+          "... and read from the right side");
+  }
+
+  auto all = JoinTable::create(users, posts, on, csql::kOpInnerJoin);
+  check(all->getColumns().size() == 7, "every column is carried without a list");
+
+  auto unqualified = std::make_shared<Refs>(Refs{Expr::makeColumnRef("id")});
+  check(columns(*JoinTable::create(users, posts, on, csql::kOpInnerJoin, JoinStrategy::kNestedLoop,
+                                   unqualified)) ==
+            std::vector<std::string>{"users.id", "posts.id"},
+        "an unqualified name carries the columns of both sides");
+
+  auto unknown = std::make_shared<Refs>(
+      Refs{Expr::makeColumnRef("old", "title"), Expr::makeColumnRef("users", "score")});
+  check(columns(*JoinTable::create(users, posts, on, csql::kOpInnerJoin, JoinStrategy::kNestedLoop,
+                                   unknown)) ==
+            std::vector<std::string>{"posts.title", "posts.score"},
+        "a qualifier no column of that name comes from falls back to the name alone");
+
+  auto known = std::make_shared<Refs>(Refs{Expr::makeColumnRef("posts", "id")});
+  check(columns(*JoinTable::create(users, posts, on, csql::kOpInnerJoin, JoinStrategy::kNestedLoop,
+                                   known)) == std::vector<std::string>{"posts.id"},
+        "a qualifier leaves out the other side's column of that name");
+
+  // The same through a query, whose join carries what the select list and its ON clause read.
+  csql::Database db;
+  db.execute(R"(
+create table users ({key, autoincrement} id: int32, login: string[16], is_admin: bool);
+create table posts ({key, autoincrement} id: int32, user_id: int32, title: string[16],
+                    score: int32);
+insert (login = "a", is_admin = true), (login = "b", is_admin = false) to users;
+insert (user_id = 1, title = "x", score = 3), (user_id = 2, title = "y", score = 5),
+       (user_id = 2, title = "z", score = 7) to posts;
+  )");
+  auto it = db.execute(
+      "select users.login as login, posts.title as title from (users join posts on users.id = "
+      "posts.user_id) where posts.score > 4 and users.is_admin = false");
+  std::vector<std::string> titles;
+  for (; it->hasValue(); ++(*it)) {
+    titles.push_back((*(*it))->get<std::string>(0) + (*(*it))->get<std::string>(1));
+  }
+  std::sort(titles.begin(), titles.end());
+  check(titles == std::vector<std::string>{"by", "bz"}, "a query over pruned join rows");
+
+  return failed();
+}
@@ -0,0 +1,80 @@
+#include <memory>
+#include <string>
+
+#include "check.h"
+#include "csql.h"
+
+int main() {
+  csql::Database db;
+
+  db.execute(R"(
+create table posts (
+  {key, autoincrement} id: int32,
+  title: string[64]
+);
+  )");
+  size_t empty = db.memory()->current();
+
+  std::string insert = "insert ";
+  for (int i = 0; i < 10; i++) {
+    if (i > 0) insert += ", ";
+    insert += "(title = \"a title long enough to live on the heap " + std::to_string(i) + "\")";
+  }
+  db.execute(insert + " to posts");
+  size_t full = db.memory()->current();
+  check(full > empty, "stored rows are charged");
+
+  db.execute("delete from posts where id = 1");
+  size_t deleted = db.memory()->current();
+  check(deleted < full, "a row deleted out of a batch is freed on its own");
+
+  std::shared_ptr<csql::storage::Row> row;
+  {
+    auto it = db.execute("select * from posts where id = 2");
+    row = *(*it);
+  }
+  db.execute("delete from posts where id = 2");
+  size_t held = db.memory()->current();
+  check(held > deleted - (full - deleted), "a deleted row held by the caller is kept");
+  check(row->get<std::string>(1) == "a title long enough to live on the heap 1",
+        "a deleted row held by the caller stays readable");
+  row = nullptr;
+  check(db.memory()->current() == deleted - (full - deleted),
+        "the row is freed with its last reference");
+
+  db.execute("delete from posts where true");
+  check(db.memory()->current() == empty, "deleting every row releases every byte");
+
+  // The values of UNIQUE columns are kept in sets of their own, charged with the rows.
+  db.execute(R"(
+create table plain (login: string[32]);
+create table unique_logins ({unique} login: string[32]);
+  )");
+  std::string rows = "insert ";
+  for (int i = 0; i < 10; i++) {
+    if (i > 0) rows += ", ";
+    rows += "(login = \"a login of more than fifteen characters " + std::to_string(i) + "\")";
+  }
+  size_t before = db.memory()->current();
+  db.execute(rows + " to plain");
+  size_t plain = db.memory()->current() - before;
+  db.execute(rows + " to unique_logins");
+  size_t unique = db.memory()->current() - before - plain;
+  check(unique > plain, "the values of a UNIQUE column are charged");
+
+  size_t stored = db.memory()->current();
+  check(rejected(db, "insert (login = \"new\"), (login = \"new\") to unique_logins"),
+        "a batch repeating a UNIQUE value is rejected");
+  check(db.memory()->current() == stored, "a rejected batch leaves nothing charged");
+
+  db.execute("create table copied as (select * from unique_logins where true)");
+  size_t copied = db.memory()->current() - stored;
+  check(copied == unique, "a table created from a query is charged like the one it copies");
+
+  db.execute("delete from copied where true");
+  db.execute("delete from unique_logins where true");
+  db.execute("delete from plain where true");
+  check(db.memory()->current() == before, "deleting the rows releases their UNIQUE values");
+
+  return failed();
+}
@@ -0,0 +1,155 @@
+#include <cctype>
+#include <cstdint>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "check.h"
+#include "csql.h"
+
+namespace {
+
+using csql::storage::LatencyHistogram;
+
+// Whether a percentile of a value reported alongside `above` lies in a bucket no wider than
+// 1/kSubBuckets of it, starting at the value.
+bool bucketed(uint64_t value, uint64_t above) {
+  LatencyHistogram histogram;
+  histogram.record(value);
+  histogram.record(above);
+  uint64_t reported = histogram.percentile(0.5);
+  return reported >= value && reported - value < value / LatencyHistogram::kSubBuckets + 1;
+}
+
+bool isName(const std::string& name) {
+  if (name.empty() || std::isdigit(static_cast<unsigned char>(name[0]))) return false;
+  for (char c : name) {
+    if (!std::isalnum(static_cast<unsigned char>(c)) && c != '_' && c != ':') return false;
+  }
+  return true;
+}
+
+// Checks `text` against the Prometheus text format: every sample belongs to a family
+// introduced by # HELP and # TYPE, and carries a number. Returns the samples by name and
+// labels, empty when the text is not well formed.
+std::map<std::string, double> samples(const std::string& text) {
+  std::map<std::string, double> samples;
+  std::map<std::string, std::string> types;
+  std::istringstream lines(text);
+  for (std::string line; std::getline(lines, line);) {
+    std::istringstream words(line);
+    std::string first, name, type;
+    if (line.rfind("# HELP ", 0) == 0) {
+      words >> first >> first >> name;
+      if (!isName(name) || types.count(name)) return {};
+      types[name] = "";
+      continue;
+    }
+    if (line.rfind("# TYPE ", 0) == 0) {
+      words >> first >> first >> name >> type;
+      if (!types.count(name) || !types[name].empty()) return {};
+      if (type != "counter" && type != "gauge" && type != "summary") return {};
+      types[name] = type;
+      continue;
+    }
+    size_t space = line.rfind(' ');
+    std::string series = line.substr(0, space);
+    name = series.substr(0, series.find('{'));
+    std::string family = name;
+    for (const char* suffix : {"_sum", "_count"}) {
+      std::string base = name.substr(0, name.size() - std::string(suffix).size());
+      if (name.ends_with(suffix) && types[base] == "summary") family = base;
+    }
+    if (space == std::string::npos || !isName(name) || types[family].empty()) return {};
+    if (series != name && (series.find("=\"") == std::string::npos || series.back() != '}')) {
+      return {};
+    }
+    std::istringstream value(line.substr(space + 1));
+    double number;
+    if (!(value >> number)) return {};
+    samples[series] = number;
+  }
+  return samples;
+}
+
+}  // namespace
+
+int main() {
+  // Values below kSubBuckets have a bucket each, larger ones share one with at most
+  // 1/kSubBuckets of their value.
+  LatencyHistogram small;
+  for (uint64_t value = 0; value < LatencyHistogram::kSubBuckets; value++) {
+    small.record(value);
+  }
+  check(small.count() == 32 && small.sum() == 31 * 32 / 2 && small.max() == 31,
+        "the histogram counts, sums and keeps the largest value");
+  check(small.percentile(0.5) == 15 && small.percentile(0.9) == 28 && small.percentile(1) == 31,
+        "small values are exact");
+  bool exact = true;
+  for (uint64_t value = 32; value < 64; value++) {
+    LatencyHistogram histogram;
+    histogram.record(value);
+    histogram.record(1000);
+    exact = exact && histogram.percentile(0.5) == value;
+  }
+  check(exact, "... up to 2 * kSubBuckets");
+  LatencyHistogram pair;
+  pair.record(64);
+  pair.record(65);
+  pair.record(1000);
+  check(pair.percentile(0.3) == 65, "64 and 65 share a bucket, reported by its highest value");
+  bool bounded = true;
+  for (uint64_t value = 64; value < (uint64_t{1} << 39); value = value * 3 + 1) {
+    bounded = bounded && bucketed(value, value * 4);
+  }
+  check(bounded, "a bucket is never wider than 1/kSubBuckets of its values");
+
+  LatencyHistogram clamped;
+  clamped.record(uint64_t{1} << 41);
+  clamped.record(uint64_t{1} << 42);
+  check(clamped.max() == uint64_t{1} << 42 && clamped.percentile(0.5) < uint64_t{1} << 40,
+        "values past kMaxBits land in the last bucket");
+  check(LatencyHistogram().percentile(0.5) == 0, "an empty histogram reports 0");
+
+  // Prometheus text format.
+  csql::Database db;
+  db.execute(R"(
+create table users ({key, autoincrement} id: int32, login: string[16]);
+insert (login = "a"), (login = "b"), (login = "c") to users;
+  )");
+  for (int i = 0; i < 5; i++) {
+    count(db, "select login from users where id > " + std::to_string(i % 3));
+  }
+  auto snapshot = db.metrics();
+  std::ostringstream text;
+  snapshot.writePrometheus(text);
+  auto exported = samples(text.str());
+  check(!exported.empty(), "the export is in the Prometheus text format");
+  std::string execute = "{phase=\"execute\",statement=\"select\"}";
+  check(exported["csql_latency_seconds_count" + execute] == 5 &&
+            exported["csql_rows_returned_total"] == snapshot.rows_returned &&
+            snapshot.rows_returned == 3 + 2 + 1 + 3 + 2,
+        "... with the counts of the statements run");
+  auto quantile = [&](const std::string& quantile) {
+    return exported["csql_latency_seconds{phase=\"execute\",statement=\"select\",quantile=\"" +
+                    quantile + "\"}"];
+  };
+  double p50 = quantile("0.5");
+  double p999 = quantile("0.999");
+  check(p50 > 0 && p50 <= p999 && p999 <= exported["csql_latency_max_seconds" + execute] &&
+            exported["csql_latency_max_seconds" + execute] <=
+                exported["csql_latency_seconds_sum" + execute],
+        "... and its latencies in seconds, the quantiles ordered");
+  check(exported["csql_table_rows{table=\"users\"}"] == 3, "tables are labelled by name");
+
+  csql::MetricsSnapshot odd;
+  odd.tables.push_back({"a\"b\\c\nd", 1, 2, 3, 4});
+  std::ostringstream escaped;
+  odd.writePrometheus(escaped);
+  check(contains(escaped.str(), "csql_table_rows{table=\"a\\\"b\\\\c\\nd\"} 1") &&
+            !samples(escaped.str()).empty(),
+        "quotes, backslashes and newlines in a label are escaped");
+
+  return failed();
+}
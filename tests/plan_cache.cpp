@@ -0,0 +1,104 @@
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "check.h"
+#include "csql.h"
+
+// Statements differing only in their literals share one cached plan, which is built when a
+// statement misses the cache: the number of SELECT plans built tells hits from misses.
+
+namespace {
+
+uint64_t plans(const csql::Database& db) {
+  for (const auto& latency : db.metrics().latencies) {
+    if (latency.phase == csql::storage::MetricsPhase::kPlan && latency.type == csql::kStmtSelect) {
+      return latency.count;
+    }
+  }
+  return 0;
+}
+
+std::vector<std::string> logins(csql::Database& db, const std::string& sql) {
+  std::vector<std::string> logins;
+  for (auto it = db.execute(sql); it->hasValue(); ++(*it)) {
+    logins.push_back((*(*it))->get<std::string>(0));
+  }
+  return logins;
+}
+
+using Logins = std::vector<std::string>;
+
+const char* kCreate = R"(
+create table users ({key, autoincrement} id: int32, login: string[16], score: int32);
+insert (login = "1", score = 3), (login = "2", score = 5), (login = "3", score = 7) to users;
+)";
+
+}  // namespace
+
+int main() {
+  csql::Database db;
+  db.execute(kCreate);
+
+  // Other literals reuse the plan, bound to the values of each execution.
+  uint64_t before = plans(db);
+  check(logins(db, "select login from users where score > 4") == Logins{"2", "3"},
+        "the first execution plans the statement");
+  check(plans(db) == before + 1, "... once");
+  check(logins(db, "select login from users where score > 6") == Logins{"3"} &&
+            logins(db, "select login from users where score > 2") == Logins{"1", "2", "3"},
+        "other literals select their own rows");
+  check(plans(db) == before + 1, "... through the cached plan");
+  check(logins(db, "select  login  from users where score > 6") == Logins{"3"} &&
+            plans(db) == before + 1,
+        "the spacing of the statement does not matter");
+
+  // The literal of one key can be an int32 one time and a string the next: each execution
+  // gives the rows of the statement planned on its own.
+  csql::Database fresh;
+  fresh.execute(kCreate);
+  std::vector<std::string> sqls = {
+      "select login from users where id = 1", "select login from users where id = \"1\"",
+      "select login from users where login = \"1\"", "select login from users where login = 1"};
+  for (const auto& sql : sqls) {
+    csql::Database apart;
+    apart.execute(kCreate);
+    check(logins(fresh, sql) == logins(apart, sql), sql + " is as if it were planned for itself");
+  }
+
+  // ANALYZE makes the plans of the table stale.
+  before = plans(db);
+  db.execute("analyze users");
+  check(logins(db, "select login from users where score > 4") == Logins{"2", "3"} &&
+            plans(db) == before + 1,
+        "a statement is planned again after its table is analyzed");
+  check(logins(db, "select login from users where score > 6") == Logins{"3"} &&
+            plans(db) == before + 1,
+        "... and the new plan cached");
+
+  // An entry is taken out while its rows are read, so that executions of one key running at
+  // once never see each other's literals.
+  auto open = db.execute("select login from users where score > 6");
+  check(logins(db, "select login from users where score > 2") == Logins{"1", "2", "3"} &&
+            count(open) == 1,
+        "a statement runs while another execution of its key is being read");
+  std::atomic<size_t> wrong{0};
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([&, t] {
+      for (int i = 0; i < 200; i++) {
+        int32_t id = (t + i) % 3 + 1;
+        auto it = db.execute("select login from users where id = " + std::to_string(id));
+        if (!it->hasValue() || (*(*it))->get<std::string>(0) != std::to_string(id)) wrong++;
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  check(wrong == 0, "executions of one key on several threads each get their own rows");
+
+  return failed();
+}
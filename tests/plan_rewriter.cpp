@@ -0,0 +1,156 @@
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "check.h"
+#include "csql.h"
+#include "generic/planning/plan_rewriter.h"
+
+namespace {
+
+using csql::Expr;
+using csql::storage::PlanRewriter;
+using csql::storage::QueryPlan;
+using csql::storage::QueryType;
+using csql::storage::RewriteStep;
+
+// A step put together by hand, for plans the planner does not build itself.
+struct Step : public QueryPlan {
+  Step(QueryType type, std::shared_ptr<Expr> query, std::shared_ptr<csql::storage::Database> db,
+       std::shared_ptr<QueryPlan> left, std::shared_ptr<QueryPlan> right = nullptr)
+      : QueryPlan(type, query, db) {
+    left_ = left;
+    right_ = right;
+  }
+};
+
+std::shared_ptr<Expr> parenthesized(std::shared_ptr<Expr> expr) {
+  return Expr::makeOpUnary(csql::kOpParenthesis, expr);
+}
+
+// The plan of `sql` as QueryPlan::create builds it, before any rewrite.
+std::shared_ptr<QueryPlan> unoptimized(std::shared_ptr<csql::storage::Database> db,
+                                       const std::string& sql) {
+  auto result = std::make_shared<csql::SQLParserResult>();
+  if (!csql::SQLParser::parse(sql, result)) {
+    throw std::runtime_error(result->errorMsg());
+  }
+  auto select = std::dynamic_pointer_cast<csql::SelectStatement>(result->getStatement(0));
+  return QueryPlan::create(Expr::makeSelect(select), db);
+}
+
+struct Rewritten {
+  std::string shape;
+  std::vector<std::string> rules;  // in the order they were applied
+};
+
+Rewritten rewrite(std::shared_ptr<QueryPlan> plan) {
+  std::vector<RewriteStep> trace;
+  Rewritten result{shape(PlanRewriter(&trace).rewrite(plan)->explain()), {}};
+  for (const auto& step : trace) {
+    result.rules.push_back(step.rule);
+  }
+  return result;
+}
+
+using Rules = std::vector<std::string>;
+
+}  // namespace
+
+int main() {
+  auto db = std::make_shared<csql::storage::Database>();
+  db->execute(R"(
+create table users ({key, autoincrement} id: int32, login: string[16], is_admin: bool);
+create table posts ({key, autoincrement} id: int32, user_id: int32, title: string[16]);
+insert (login = "a", is_admin = true), (login = "b", is_admin = false),
+       (login = "c", is_admin = false) to users;
+  )");
+
+  auto rewritten = rewrite(unoptimized(db, "select id from users where login = \"a\""));
+  check(rewritten.shape ==
+                "Eval\n"
+                "  Filter: login = \"a\"\n"
+                "    Project: users\n" &&
+            rewritten.rules == Rules{"drop full scan"},
+        "a full scan hands its table through");
+
+  rewritten = rewrite(unoptimized(db, "select id from users where true"));
+  check(rewritten.shape ==
+                "Eval\n"
+                "  Project: users\n" &&
+            rewritten.rules == Rules{"drop full scan", "drop true filter"},
+        "a filter that is always true goes");
+  rewritten = rewrite(unoptimized(db, "select id from users where login or true"));
+  check(rewritten.shape ==
+                "Eval\n"
+                "  Filter: login OR true\n"
+                "    Project: users\n" &&
+            count(db->execute("select id from users where login or true")) == 0,
+        "... but not OR over a side that is not a boolean, which gives false");
+
+  rewritten = rewrite(unoptimized(db, "select * from users where true"));
+  check(rewritten.shape == "Project: users\n" &&
+            rewritten.rules == Rules{"drop full scan", "drop true filter", "drop SELECT * eval"},
+        "SELECT * goes");
+  rewritten = rewrite(unoptimized(db, "select *, id from users where true"));
+  check(rewritten.shape ==
+                "Eval\n"
+                "  Project: users\n" &&
+            rewritten.rules == Rules{"drop full scan", "drop true filter"},
+        "... but not with other columns");
+
+  // Every subquery leaves a filter over the one of the subquery below once its SELECT * goes.
+  std::string nested =
+      "select * from (select * from (select * from users where login != \"a\") where id > 1) "
+      "where is_admin = false";
+  rewritten = rewrite(unoptimized(db, nested));
+  check(rewritten.shape ==
+                "Filter: login != \"a\" AND id > 1 AND is_admin = false\n"
+                "  Project: users\n" &&
+            rewritten.rules == Rules{"drop full scan", "drop SELECT * eval", "drop full scan",
+                                     "merge filters", "drop SELECT * eval", "drop full scan",
+                                     "merge filters", "drop SELECT * eval"},
+        "filters over filters are merged, the inner predicate first");
+  check(count(db->execute(nested)) == 2, "... keeping the rows of every level");
+
+  // The parser's parentheses are gone by the time a plan is built, so these are put together
+  // by hand.
+  auto login = Expr::makeOpBinary(Expr::makeColumnRef("login"), csql::kOpEquals,
+                                  Expr::makeLiteral(std::string("\"a\"")));
+  auto users = QueryPlan::create(Expr::makeTableRef("users"), db);
+  auto filter = std::make_shared<Step>(QueryType::kStepFilter,
+                                       parenthesized(parenthesized(login)), db, users);
+  rewritten = rewrite(filter);
+  check(rewritten.shape ==
+                "Filter: login = \"a\"\n"
+                "  Project: users\n" &&
+            rewritten.rules == Rules{"collapse parentheses"},
+        "the parentheses around a filter go");
+
+  auto on = parenthesized(Expr::makeOpBinary(
+      parenthesized(parenthesized(Expr::makeColumnRef("users", "id"))), csql::kOpEquals,
+      Expr::makeColumnRef("posts", "user_id")));
+  auto posts = QueryPlan::create(Expr::makeTableRef("posts"), db);
+  auto join = std::make_shared<Step>(
+      QueryType::kStepJoin,
+      Expr::makeJoin(Expr::makeTableRef("users"), Expr::makeTableRef("posts"), on,
+                     csql::kOpInnerJoin),
+      db, users, posts);
+  rewritten = rewrite(join);
+  check(rewritten.shape ==
+                "Join on (users.id) = posts.user_id\n"
+                "  Project: users\n"
+                "  Project: posts\n" &&
+            rewritten.rules == Rules{"collapse parentheses"},
+        "nested parentheses in a join condition collapse to one pair");
+
+  // The passes, at most kMaxPasses, stop once nothing matches: the result is a fixpoint.
+  auto once = PlanRewriter().rewrite(unoptimized(db, nested));
+  std::vector<RewriteStep> trace;
+  auto twice = PlanRewriter(&trace).rewrite(once);
+  check(trace.empty() && shape(twice->explain()) == shape(once->explain()),
+        "a rewritten plan has nothing left to rewrite");
+
+  return failed();
+}
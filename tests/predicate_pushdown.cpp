@@ -0,0 +1,117 @@
+#include <string>
+
+#include "check.h"
+#include "csql.h"
+
+// Each query is checked against the same filter over its source copied into a table of its
+// own, which leaves nothing to push down.
+
+int main() {
+  csql::Database db;
+
+  db.execute(R"(
+create table users ({key, autoincrement} id: int32, login: string[16], is_admin: bool);
+create table posts ({key, autoincrement} id: int32, user_id: int32, title: string[16],
+                    score: int32);
+create table tags ({key, autoincrement} id: int32, post_id: int32, name: string[16]);
+  )");
+  for (int i = 0; i < 6; i++) {
+    db.execute("insert (login = \"u" + std::to_string(i) +
+               "\", is_admin = " + (i % 3 == 0 ? "true" : "false") + ") to users");
+  }
+  for (int i = 0; i < 20; i++) {
+    db.execute("insert (user_id = " + std::to_string(i % 6 + 1) + ", title = \"p" +
+               std::to_string(i) + "\", score = " + std::to_string(i * 7 % 10) + ") to posts");
+  }
+  for (int i = 0; i < 30; i++) {
+    db.execute("insert (post_id = " + std::to_string(i % 20 + 1) + ", name = \"t" +
+               std::to_string(i % 4) + "\") to tags");
+  }
+  db.execute(R"(
+create table user_posts as (
+  select users.id as user_id, users.login as login, users.is_admin as is_admin,
+         posts.id as post_id, posts.title as title, posts.score as score
+  from (users join posts on users.id = posts.user_id) where true
+)
+  )");
+  db.execute(R"(
+create table user_post_tags as (
+  select users.id as user_id, users.login as login, posts.title as title, tags.id as tag_id
+  from ((users join posts on users.id = posts.user_id) join tags on posts.id = tags.post_id)
+  where true
+)
+  )");
+
+  // Conjuncts over one table each go below the join.
+  std::string sql =
+      "select users.login as login, posts.title as title from (users join posts on users.id = "
+      "posts.user_id) where users.is_admin = false and posts.score > 4";
+  std::string plan = db.plan(sql)->explain();
+  check(contains(plan, "    Filter: users.is_admin = false") &&
+            contains(plan, "    Filter: posts.score > 4"),
+        "single-table conjuncts are pushed below the join");
+  auto expected =
+      rows(db, "select login, title from user_posts where is_admin = false and score > 4");
+  check(!expected.empty() && rows(db, sql) == expected, "... with the same rows");
+
+  // A conjunct over two of three tables goes into the ON condition of the join above them.
+  sql =
+      "select users.login as login, posts.title as title from ((users join posts on users.id = "
+      "posts.user_id) join tags on posts.id = tags.post_id) where users.id + tags.id > 20";
+  plan = db.plan(sql)->explain();
+  check(contains(plan, "on posts.id = tags.post_id AND users.id + tags.id > 20") &&
+            !contains(plan, "Filter"),
+        "a conjunct over two tables is pushed into the ON condition");
+  expected = rows(db, "select login, title from user_post_tags where user_id + tag_id > 20");
+  check(!expected.empty() && rows(db, sql) == expected, "... with the same rows");
+
+  // One side of the join is a subquery: its columns can not be attributed to a table.
+  sql =
+      "select users.login as login, title from (users join (select user_id, title, score from "
+      "posts where score > 2) on users.id = user_id) where users.id + score > 6 and "
+      "users.is_admin = false";
+  plan = db.plan(sql)->explain();
+  check(contains(plan, "  Filter: users.id + score > 6 AND users.is_admin = false"),
+        "a conjunct across a subquery stays above the join");
+  expected = rows(db,
+                  "select login, title from user_posts where score > 2 and user_id + score > 6 "
+                  "and is_admin = false");
+  check(!expected.empty() && rows(db, sql) == expected, "... with the same rows");
+
+  // Conjuncts on the select list of a subquery are rewritten over its source, and from there
+  // into the join.
+  sql =
+      "select login, total from (select users.login as login, (posts.score + users.id) as "
+      "total from (users join posts on users.id = posts.user_id) where true) where total > 8 "
+      "and login != \"u1\"";
+  plan = db.plan(sql)->explain();
+  check(contains(plan, "on users.id = posts.user_id AND posts.score + users.id > 8") &&
+            contains(plan, "Filter: users.login != \"u1\""),
+        "conjuncts are pushed through the select list of a subquery");
+  expected = rows(db,
+                  "select login, (score + user_id) as total from user_posts where "
+                  "(score + user_id) > 8 and login != \"u1\"");
+  check(!expected.empty() && rows(db, sql) == expected, "... with the same rows");
+
+  // Constant conjuncts are evaluated once, on top.
+  sql =
+      "select users.login as login, posts.title as title from (users join posts on users.id = "
+      "posts.user_id) where users.is_admin = false and 1 = 2";
+  plan = db.plan(sql)->explain();
+  check(contains(plan, "  Filter: false"), "a false constant stays above the join");
+  check(count(db, sql) == 0, "... and no rows come out");
+
+  auto select = db.prepare(
+      "select users.login as login, posts.title as title from (users join posts on users.id = "
+      "posts.user_id) where users.is_admin = false and ? = 1");
+  plan = select->plan()->explain();
+  check(contains(plan, "  Filter: ? = 1") && contains(plan, "    Filter: users.is_admin = false"),
+        "a parameter compared to a constant stays above the join, the rest goes below");
+  select->bind(0, 1);
+  expected = rows(db, "select login, title from user_posts where is_admin = false");
+  check(!expected.empty() && rows(select->execute()) == expected, "... with the same rows");
+  select->bind(0, 2);
+  check(count(select->execute()) == 0, "... and none once it is false");
+
+  return failed();
+}
@@ -0,0 +1,112 @@
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "check.h"
+#include "csql.h"
+
+namespace {
+
+// The message `execute` raises, empty when it does not.
+template <typename Execute>
+std::string error(Execute execute) {
+  try {
+    execute();
+  } catch (const std::runtime_error& e) {
+    return e.what();
+  }
+  return "";
+}
+
+std::vector<std::string> logins(std::shared_ptr<csql::TableIterator> it) {
+  std::vector<std::string> logins;
+  for (; it->hasValue(); ++(*it)) {
+    logins.push_back((*(*it))->get<std::string>(0));
+  }
+  return logins;
+}
+
+using Logins = std::vector<std::string>;
+
+}  // namespace
+
+int main() {
+  csql::Database db;
+  db.execute(R"(
+create table users ({key, autoincrement} id: int32, login: string[16], score: int32);
+insert (login = "a", score = 3), (login = "b", score = 5), (login = "c", score = 7) to users;
+  )");
+
+  // Bound values are kept until rebound.
+  auto select = db.prepare("select login from users where score > ? and login != ?");
+  check(select->parameterCount() == 2, "every ? is a parameter");
+  select->bind(0, 4).bind(1, "c");
+  check(logins(select->execute()) == Logins{"b"}, "the bound values select the rows");
+  check(logins(select->execute()) == Logins{"b"}, "... again on the next execution");
+  select->bind(1, "z");
+  check(logins(select->execute()) == Logins{"b", "c"}, "rebinding one keeps the other");
+
+  // Executing with a parameter left unbound or binding one that is not there raises.
+  select->clearBindings();
+  check(error([&] { select->execute(); }) == "Parameter is not bound: 0",
+        "every parameter has to be bound");
+  select->bind(0, 0);
+  check(error([&] { select->execute(); }) == "Parameter is not bound: 1",
+        "... the last one too");
+  check(error([&] { select->bind(2, 0); }) == "Parameter index out of range: 2",
+        "binding past the last parameter raises");
+  select->bind(1, "a");
+  check(logins(select->execute()) == Logins{"b", "c"}, "... leaving the bound ones alone");
+
+  // ? in INSERT and DELETE.
+  auto insert = db.prepare("insert (login = ?, score = ?) to users");
+  check(insert->parameterCount() == 2 && insert->plan() == nullptr, "an INSERT has no plan");
+  insert->bind(0, "d").bind(1, 9);
+  check(insert->execute() == nullptr, "an INSERT returns no rows");
+  insert->bind(0, "e").bind(1, 11);
+  insert->execute();
+  check(rows(db, "select login, score from users where score > 8") ==
+            rows(db, "select login, score from users where login = \"d\" or login = \"e\"") &&
+            count(db, "select login from users where score > 8") == 2,
+        "... and inserts a row with the bound values each time");
+  auto remove = db.prepare("delete from users where score = ?");
+  remove->bind(0, 11);
+  remove->execute();
+  check(count(db, "select login from users where true") == 4, "a DELETE removes the bound rows");
+
+  // The plan is built again, with the values bound then, once the row count of a table it
+  // reads drifts by more than a tenth or the table is analyzed.
+  db.execute(R"(
+create table a ({key, autoincrement} id: int32, name: string[8]);
+create table b ({key, autoincrement} id: int32, a_id: int32);
+  )");
+  for (int i = 0; i < 20; i++) {
+    db.execute("insert (name = \"n" + std::to_string(i) + "\") to a");
+  }
+  for (int i = 0; i < 30; i++) {
+    db.execute("insert (a_id = " + std::to_string(i % 3 + 1) + ") to b");
+  }
+  db.execute("analyze a; analyze b");
+  auto join = db.prepare("select a.name as name from (a join b on a.id = b.a_id) where b.id > ?");
+  auto planned = join->plan();
+  check(contains(planned->explain(), "HashJoin build right"), "the smaller side is hashed");
+  join->bind(0, 27);
+  check(logins(join->execute()) == Logins{"n0", "n1", "n2"} && join->plan() == planned,
+        "... and the plan kept while the tables are unchanged");
+  db.execute("insert (a_id = 100), (a_id = 100) to b");
+  join->execute();
+  check(join->plan() == planned, "... or change by a tenth at most");
+  for (int i = 0; i < 300; i++) {
+    db.execute("insert (a_id = 100) to b");
+  }
+  join->bind(0, 0);
+  join->execute();
+  auto grown = join->plan();
+  check(grown != planned, "a table that grew gets a new plan");
+  db.execute("analyze b");
+  check(logins(join->execute()).size() == 30 && join->plan() != grown &&
+            contains(join->plan()->explain(), "HashJoin build left"),
+        "... and once analyzed one that hashes the side now smaller");
+
+  return failed();
+}
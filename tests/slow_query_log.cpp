@@ -0,0 +1,98 @@
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "check.h"
+#include "csql.h"
+
+namespace {
+
+std::string read(const std::filesystem::path& path) {
+  std::ifstream file(path);
+  std::stringstream text;
+  text << file.rdbuf();
+  return text.str();
+}
+
+// Entries start with a line "# <time> <ms> ms, <rows> rows".
+size_t entries(const std::string& log) {
+  size_t entries = 0;
+  std::istringstream lines(log);
+  for (std::string line; std::getline(lines, line);) {
+    entries += line.starts_with("# ") && line.ends_with(" rows");
+  }
+  return entries;
+}
+
+}  // namespace
+
+int main() {
+  auto path = std::filesystem::temp_directory_path() / "csql_slow_query_log_test.log";
+  std::filesystem::remove(path);
+
+  csql::Database db;
+  db.execute(R"(
+create table users ({key, autoincrement} id: int32, login: string[16], score: int32);
+insert (login = "a", score = 3), (login = "b", score = 5), (login = "c", score = 7) to users;
+  )");
+
+  // A threshold no statement here reaches logs nothing.
+  db.setSlowQueryLog(path.string(), std::chrono::hours(1));
+  count(db, "select login from users where score > 4");
+  db.disableSlowQueryLog();
+  check(std::filesystem::exists(path) && read(path).empty(), "fast statements are not logged");
+
+  // With a threshold of 0 every statement is over it, and is written once its rows are read.
+  db.setSlowQueryLog(path.string(), std::chrono::nanoseconds(0));
+  auto select = db.prepare("select login from users where score > ? and login != ?");
+  select->bind(0, 4).bind(1, "c");
+  count(select->execute());
+  db.execute("insert (login = \"d\", score = 9) to users");
+  auto open = db.execute("select login from users where score > 8");
+  db.disableSlowQueryLog();  // drains the entries queued so far and joins the writer
+  std::string log = read(path);
+  check(entries(log) == 2, "the statements done are written by the time logging is disabled");
+  check(contains(log, " ms, 1 rows\nselect login from users where score > ? and login != ?\n"
+                      "-- parameters: 4, \"c\"\n-- plan:\nEval  (") &&
+            contains(log, "-- mermaid:\n"),
+        "a query is written with its rows, parameters and plan");
+  check(contains(log, " ms, 1 rows\ninsert (login = \"d\", score = 9) to users\n"
+                      "-- parameters: \"d\", 9\n\n"),
+        "an INSERT is written with the rows it inserted, its literals and no plan");
+  check(!contains(log, "score > 8"), "a query whose rows are still open is not done yet");
+  count(open);
+  open = nullptr;
+  check(read(path) == log, "... nor logged once logging is disabled");
+
+  // Entries queued faster than the writer appends them are all written before it stops.
+  db.setSlowQueryLog(path.string(), std::chrono::nanoseconds(0));
+  for (int i = 0; i < 500; i++) {
+    count(db, "select login from users where id = " + std::to_string(i % 4 + 1));
+  }
+  db.disableSlowQueryLog();
+  check(entries(read(path)) == 2 + 500, "disabling the log writes every queued entry");
+
+  // Disabling the log while another thread finishes statements: nothing is written after.
+  db.setSlowQueryLog(path.string(), std::chrono::nanoseconds(0));
+  std::atomic<bool> stop{false};
+  std::thread runner([&] {
+    while (!stop) {
+      count(db, "select login from users where score > 4");
+    }
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  db.disableSlowQueryLog();
+  log = read(path);
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  stop = true;
+  runner.join();
+  check(entries(log) > 2 + 500 && read(path) == log,
+        "the log is complete once disabling it returns, whatever other threads do");
+
+  std::filesystem::remove(path);
+  return failed();
+}
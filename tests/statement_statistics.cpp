@@ -0,0 +1,90 @@
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "check.h"
+#include "csql.h"
+#include "generic/plan_cache.h"
+#include "generic/statement_statistics.h"
+
+namespace {
+
+using csql::storage::PlanCache;
+using csql::storage::StatementStatistics;
+
+// calls, rows, full_scans and range_scans of the statement normalized to `text`, empty when it
+// was not recorded.
+std::vector<int32_t> usage(csql::Database& db, const std::string& text) {
+  auto it = db.execute(
+      "select calls, rows, full_scans, range_scans from csql_stat_statements where query = \"" +
+      text + "\"");
+  if (!it->hasValue()) return {};
+  auto row = *(*it);
+  return {row->get<int32_t>(0), row->get<int32_t>(1), row->get<int32_t>(2),
+          row->get<int32_t>(3)};
+}
+
+void run(std::shared_ptr<csql::TableIterator> it) {
+  if (it) count(it);
+}
+
+using Usage = std::vector<int32_t>;
+
+}  // namespace
+
+int main() {
+  csql::Database db;
+  db.execute(R"(
+create table users ({key, autoincrement} id: int32, login: string[16], score: int32);
+insert (login = "a", score = 3), (login = "b", score = 5), (login = "c", score = 7) to users;
+  )");
+
+  // Statements differing in their literals, placeholders, spacing or the case of their keywords
+  // are one statement.
+  const std::string scores = "SELECT login FROM users WHERE score > ?";
+  run(db.execute("select login from users where score > 4"));
+  run(db.execute("SELECT  login FROM users WHERE score > 6"));
+  auto prepared = db.prepare("select login from users where score > ?");
+  prepared->bind(0, 2);
+  run(prepared->execute());
+  check(PlanCache::normalize("select login from users where score > 6") == scores + " " &&
+            PlanCache::normalize("select login from users where score > ?") == scores + " ",
+        "a literal and a placeholder are both normalized to ?");
+  check(usage(db, scores) == Usage{3, 2 + 1 + 3, 3, 0},
+        "executions with literals and a prepared one are counted together");
+
+  // How the tables were read.
+  run(db.execute("select login from users where id > 1"));
+  check(usage(db, "SELECT login FROM users WHERE id > ?") == Usage{1, 2, 0, 1},
+        "a key range is a range scan");
+
+  // INSERT and DELETE count the rows they write.
+  const std::string inserts = "INSERT ( login = ? , score = ? ) TO users";
+  db.execute("insert (login = \"d\", score = 9) to users");
+  auto insert = db.prepare("insert (login = ?, score = ?) to users");
+  insert->bind(0, "e").bind(1, 11);
+  insert->execute();
+  check(usage(db, inserts) == Usage{2, 2, 0, 0}, "an INSERT counts the rows it inserts");
+  db.execute("delete from users where score > 8");
+  check(usage(db, "DELETE FROM users WHERE score > ?") == Usage{1, 2, 1, 0},
+        "a DELETE counts the rows it deletes, and the scan finding them");
+
+  // Statements the plan cache leaves alone are counted under the same normalized text.
+  db.execute("create table copied as (select login from users where score > 4)");
+  check(usage(db, "CREATE TABLE copied AS ( SELECT login FROM users WHERE score > ? )") ==
+            Usage{1, 0, 0, 0},
+        "a CREATE is counted");
+
+  // The fingerprint is that of the normalized text.
+  char expected[17];
+  std::snprintf(expected, sizeof(expected), "%016llx",
+                static_cast<unsigned long long>(
+                    StatementStatistics::fingerprint(PlanCache::normalize(scores))));
+  auto it = db.execute("select fingerprint from csql_stat_statements where query = \"" + scores +
+                       "\"");
+  check(it->hasValue() && (*(*it))->get<std::string>(0) == expected,
+        "the fingerprint column is the hash of the normalized text");
+
+  return failed();
+}
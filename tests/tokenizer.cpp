@@ -1,16 +1,109 @@
 #include <string>
+#include <utility>
+#include <vector>
 
+#include "check.h"
 #include "csql.h"
 #include "sql/parser.h"
 
-int main() {
-  csql::SQLTokenizer tokenizer(
-      "create table users ({key, autoincrement} id :int32, {unique} login: string[32] = "
-      "\"hello abc\", password_hash: bytes[8] = 0x0011223344556677, is_admin: bool = false)");
+namespace {
+
+using Tokens = std::vector<std::pair<csql::TokenType, std::string>>;
+
+Tokens tokens(const std::string& sql) {
+  csql::SQLTokenizer tokenizer(sql);
+  Tokens tokens;
   while (tokenizer.hasNext()) {
     csql::Token token = tokenizer.nextToken();
-    std::string type = csql::tokenTypeToString(token.type);
-    printf("Type: %s, Value: %s\n", type.c_str(), token.value.c_str());
+    tokens.emplace_back(token.type, std::string(token.value));
   }
-  return 0;
-}
\ No newline at end of file
+  return tokens;
+}
+
+}  // namespace
+
+int main() {
+  using csql::TokenType;
+
+  check(tokens("create table users ({key, autoincrement} id :int32, {unique} login: "
+               "string[32] = \"hello abc\", password_hash: bytes[8] = 0x0011223344556677, "
+               "is_admin: bool = false)") ==
+            Tokens{{TokenType::KEYWORD, "CREATE"},      {TokenType::KEYWORD, "TABLE"},
+                   {TokenType::NAME, "users"},          {TokenType::OPERATOR, "("},
+                   {TokenType::PUNCTUATION, "{"},       {TokenType::KEYWORD, "KEY"},
+                   {TokenType::PUNCTUATION, ","},       {TokenType::KEYWORD, "AUTOINCREMENT"},
+                   {TokenType::PUNCTUATION, "}"},       {TokenType::NAME, "id"},
+                   {TokenType::PUNCTUATION, ":"},       {TokenType::TYPE, "int32"},
+                   {TokenType::PUNCTUATION, ","},       {TokenType::PUNCTUATION, "{"},
+                   {TokenType::KEYWORD, "UNIQUE"},      {TokenType::PUNCTUATION, "}"},
+                   {TokenType::NAME, "login"},          {TokenType::PUNCTUATION, ":"},
+                   {TokenType::TYPE, "string[32]"},     {TokenType::OPERATOR, "="},
+                   {TokenType::STRING, "\"hello abc\""}, {TokenType::PUNCTUATION, ","},
+                   {TokenType::NAME, "password_hash"},  {TokenType::PUNCTUATION, ":"},
+                   {TokenType::TYPE, "bytes[8]"},       {TokenType::OPERATOR, "="},
+                   {TokenType::HEX, "0x0011223344556677"}, {TokenType::PUNCTUATION, ","},
+                   {TokenType::NAME, "is_admin"},       {TokenType::PUNCTUATION, ":"},
+                   {TokenType::TYPE, "bool"},           {TokenType::OPERATOR, "="},
+                   {TokenType::KEYWORD, "FALSE"},       {TokenType::OPERATOR, ")"}},
+        "a table definition: types keep their spelling, strings their quotes");
+
+  check(tokens("Select * From T where x Is  Null and y is not NULL") ==
+            Tokens{{TokenType::KEYWORD, "SELECT"},    {TokenType::ALL_COLS, "*"},
+                   {TokenType::KEYWORD, "FROM"},      {TokenType::NAME, "T"},
+                   {TokenType::KEYWORD, "WHERE"},     {TokenType::NAME, "x"},
+                   {TokenType::KEYWORD, "IS NULL"},   {TokenType::KEYWORD, "AND"},
+                   {TokenType::NAME, "y"},            {TokenType::KEYWORD, "IS NOT NULL"}},
+        "keywords are upper-cased and IS [NOT] NULL is one token");
+
+  check(tokens("create ordered index on t; create unordered  index on t") ==
+            Tokens{{TokenType::KEYWORD, "CREATE"},
+                   {TokenType::KEYWORD, "ORDERED INDEX"},
+                   {TokenType::KEYWORD, "ON"},
+                   {TokenType::NAME, "t"},
+                   {TokenType::TERMINAL, ";"},
+                   {TokenType::KEYWORD, "CREATE"},
+                   {TokenType::KEYWORD, "UNORDERED INDEX"},
+                   {TokenType::KEYWORD, "ON"},
+                   {TokenType::NAME, "t"}},
+        "ORDERED INDEX and UNORDERED INDEX are one token");
+
+  check(tokens("users.id >= ? and 'it''s' != 12") ==
+            Tokens{{TokenType::COLUMN_NAME, "users.id"},
+                   {TokenType::OPERATOR, ">="},
+                   {TokenType::PARAMETER, "?"},
+                   {TokenType::KEYWORD, "AND"},
+                   {TokenType::STRING, "'it'"},
+                   {TokenType::STRING, "'s'"},
+                   {TokenType::OPERATOR, "!="},
+                   {TokenType::INTEGER, "12"}},
+        "qualified names, parameters, strings and numbers");
+
+  check(tokens("0x 0xfg \"open") == Tokens{{TokenType::INTEGER, "0"},
+                                           {TokenType::NAME, "x"},
+                                           {TokenType::HEX, "0xf"},
+                                           {TokenType::NAME, "g"},
+                                           {TokenType::NONE, "\"open"}},
+        "hex needs a digit, an unterminated string is not a string");
+
+  // The statements built on those tokens.
+  csql::Database db;
+  db.execute(R"(
+create table users (
+  {key, autoincrement} id: int32,
+  login: STRING[32],
+  nickname: string[32]
+);
+insert (login = "a") to users;
+insert (login = "b", nickname = "bee") to users;
+  )");
+  check(count(db, "select id from users where nickname is null") == 1,
+        "IS NULL matches NULL values");
+  check(count(db, "select id from users where nickname is not null") == 1,
+        "IS NOT NULL matches the others");
+  check(count(db, "select (users.id * 2) as twice from users where true") == 2,
+        "* multiplies inside an expression");
+  check(rejected(db, "select users.id * 2 as twice from users where true"),
+        "select-list expressions must be in parentheses");
+
+  return failed();
+}